@@ -36,6 +36,7 @@
     .driver_name = "nt35510_panel",
     .type = OMAP_DISPLAY_TYPE_DPI,
     .phy.dpi.data_lines = 24,
+    .panel.idle_timeout_ms = 500,
     .platform_enable = NULL,
     .platform_disable = NULL,
 
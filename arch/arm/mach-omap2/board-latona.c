@@ -34,6 +34,7 @@
 #include <linux/gpio.h>
 #include <linux/bootmem.h>
 #include <linux/reboot.h>
+#include <linux/android_pmem.h>
 
 #include <asm/setup.h>
 #include <asm/mach-types.h>
@@ -155,12 +156,57 @@ static void __init __sec_omap_reserve_sdram(void)
 #endif
 }
 
+#ifdef CONFIG_ANDROID_PMEM
+/* buffers shared by the camera, omap_vout and the DSP, see
+ * get_pmem_user_phys() */
+#define LATONA_PMEM_SIZE	(16 * SZ_1M)
+
+static struct android_pmem_platform_data latona_pmem_pdata = {
+	.name = "pmem",
+	.cached = 1,
+};
+
+static struct platform_device latona_pmem_device = {
+	.name = "android_pmem",
+	.id = 0,
+	.dev = {
+		.platform_data = &latona_pmem_pdata,
+	},
+};
+
+/* like VRAM, taken from bootmem in map_io; 1M aligned so that the IOMMUs
+ * can map it with sections */
+static void __init latona_pmem_reserve(void)
+{
+	void *vaddr;
+
+	vaddr = __alloc_bootmem_nopanic(LATONA_PMEM_SIZE, SZ_1M, 0);
+	if (!vaddr) {
+		pr_err("pmem: failed to reserve %d bytes\n", LATONA_PMEM_SIZE);
+		return;
+	}
+
+	latona_pmem_pdata.start = virt_to_phys(vaddr);
+	latona_pmem_pdata.size = LATONA_PMEM_SIZE;
+}
+
+static void __init latona_pmem_init(void)
+{
+	if (latona_pmem_pdata.size)
+		platform_device_register(&latona_pmem_device);
+}
+#else
+static inline void latona_pmem_reserve(void) { }
+static inline void latona_pmem_init(void) { }
+#endif
+
 static void __init omap_board_map_io(void)
 {
 	omap2_set_globals_36xx();
 	omap34xx_map_common_io();
 
 	__sec_omap_reserve_sdram();
+	latona_pmem_reserve();
 }
 
 static struct omap_board_config_kernel omap_board_sec_config[] __initdata = {
@@ -475,6 +521,7 @@ static void __init omap_board_init(void)
 
 	omap_board_peripherals_init();
 	omap_board_display_init(OMAP_DSS_VENC_TYPE_COMPOSITE);
+	latona_pmem_init();
 	usb_uhhtll_init(&usbhs_pdata);
 	sr_class1p5_init();
 
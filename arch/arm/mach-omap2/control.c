@@ -176,19 +176,44 @@ u32 omap_ctrl_readl(u16 offset)
 	return __raw_readl(OMAP_CTRL_REGADDR(offset));
 }
 
+#if defined(CONFIG_ARCH_OMAP3) && defined(CONFIG_PM)
+/*
+ * Set whenever one of the registers kept in control_context may have
+ * been written, so omap3_control_save_context() can skip re-reading
+ * them on CORE OFF entry.  Padconf writes (which the UART and GPIO idle
+ * code do on every idle) and the PADCONF_OFF/scratchpad area are not
+ * part of that context and are ignored.  Registers which are also
+ * written behind these accessors are saved regardless.
+ */
+static int control_context_dirty = 1;
+
+static inline void omap3_control_mark_dirty(u16 offset)
+{
+	if (offset == OMAP2_CONTROL_SYSCONFIG ||
+	    (offset > OMAP343X_CONTROL_PADCONF_OFF &&
+	     offset < OMAP343X_CONTROL_MEM_WKUP))
+		control_context_dirty = 1;
+}
+#else
+static inline void omap3_control_mark_dirty(u16 offset) { }
+#endif
+
 void omap_ctrl_writeb(u8 val, u16 offset)
 {
 	__raw_writeb(val, OMAP_CTRL_REGADDR(offset));
+	omap3_control_mark_dirty(offset);
 }
 
 void omap_ctrl_writew(u16 val, u16 offset)
 {
 	__raw_writew(val, OMAP_CTRL_REGADDR(offset));
+	omap3_control_mark_dirty(offset);
 }
 
 void omap_ctrl_writel(u32 val, u16 offset)
 {
 	__raw_writel(val, OMAP_CTRL_REGADDR(offset));
+	omap3_control_mark_dirty(offset);
 }
 
 /*
@@ -368,8 +393,22 @@ void omap3_save_scratchpad_contents(void)
 
 void omap3_control_save_context(void)
 {
-	control_context.sysconfig = omap_ctrl_readl(OMAP2_CONTROL_SYSCONFIG);
+	/*
+	 * The clock framework switches the McBSP clksel bits in DEVCONF0/1
+	 * and the DSP bridge loads the IVA2 boot registers with
+	 * __raw_writel(), bypassing the dirty tracking: always save those.
+	 */
 	control_context.devconf0 = omap_ctrl_readl(OMAP2_CONTROL_DEVCONF0);
+	control_context.devconf1 = omap_ctrl_readl(OMAP343X_CONTROL_DEVCONF1);
+	control_context.iva2_bootaddr =
+			omap_ctrl_readl(OMAP343X_CONTROL_IVA2_BOOTADDR);
+	control_context.iva2_bootmod =
+			omap_ctrl_readl(OMAP343X_CONTROL_IVA2_BOOTMOD);
+
+	if (!control_context_dirty)
+		return;
+
+	control_context.sysconfig = omap_ctrl_readl(OMAP2_CONTROL_SYSCONFIG);
 	control_context.mem_dftrw0 =
 			omap_ctrl_readl(OMAP343X_CONTROL_MEM_DFTRW0);
 	control_context.mem_dftrw1 =
@@ -387,12 +426,7 @@ void omap3_control_save_context(void)
 	control_context.msuspendmux_5 =
 			omap_ctrl_readl(OMAP2_CONTROL_MSUSPENDMUX_5);
 	control_context.sec_ctrl = omap_ctrl_readl(OMAP2_CONTROL_SEC_CTRL);
-	control_context.devconf1 = omap_ctrl_readl(OMAP343X_CONTROL_DEVCONF1);
 	control_context.csirxfe = omap_ctrl_readl(OMAP343X_CONTROL_CSIRXFE);
-	control_context.iva2_bootaddr =
-			omap_ctrl_readl(OMAP343X_CONTROL_IVA2_BOOTADDR);
-	control_context.iva2_bootmod =
-			omap_ctrl_readl(OMAP343X_CONTROL_IVA2_BOOTMOD);
 	control_context.debobs_0 = omap_ctrl_readl(OMAP343X_CONTROL_DEBOBS(0));
 	control_context.debobs_1 = omap_ctrl_readl(OMAP343X_CONTROL_DEBOBS(1));
 	control_context.debobs_2 = omap_ctrl_readl(OMAP343X_CONTROL_DEBOBS(2));
@@ -419,6 +453,7 @@ void omap3_control_save_context(void)
 	control_context.sramldo4 = omap_ctrl_readl(OMAP343X_CONTROL_SRAMLDO4);
 	control_context.sramldo5 = omap_ctrl_readl(OMAP343X_CONTROL_SRAMLDO5);
 	control_context.csi = omap_ctrl_readl(OMAP343X_CONTROL_CSI);
+	control_context_dirty = 0;
 	return;
 }
 
@@ -475,6 +510,8 @@ void omap3_control_restore_context(void)
 	omap_ctrl_writel(control_context.sramldo4, OMAP343X_CONTROL_SRAMLDO4);
 	omap_ctrl_writel(control_context.sramldo5, OMAP343X_CONTROL_SRAMLDO5);
 	omap_ctrl_writel(control_context.csi, OMAP343X_CONTROL_CSI);
+	/* Registers now match the saved copy */
+	control_context_dirty = 0;
 	return;
 }
 #endif /* CONFIG_ARCH_OMAP3 && CONFIG_PM */
@@ -0,0 +1,495 @@
+/*
+ * linux/arch/arm/mach-omap2/cpuidle34xx-predict.c
+ *
+ * OMAP3 predictive cpuidle governor
+ *
+ * The deep OMAP3 C-states (MPU OFF, CORE RET/OFF) have exit latencies in
+ * the millisecond range, so picking one and then being woken early by a
+ * touch or audio interrupt costs both power and latency.  Unlike menu,
+ * which corrects the next-timer estimate with a single set of factors,
+ * this governor keeps a separate idle-length histogram for each class
+ * of wakeup source (GPTIMER, GPIO, McBSP/sDMA, mailbox, other).  The
+ * timer class is already covered by the next tick, so only the other
+ * classes are used to estimate the chance of an early wakeup before a
+ * state's target residency.
+ *
+ * Debugfs (omap3_predict/) exposes the prediction accuracy, a residency
+ * histogram per state, a ring of the most recent idle periods and a
+ * "replay" file which feeds captured periods through a private instance
+ * of the predictor, so traces can be evaluated without touching the
+ * live governor.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/cpuidle.h>
+#include <linux/pm_qos_params.h>
+#include <linux/ktime.h>
+#include <linux/tick.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+
+#include <plat/cpu.h>
+#include <plat/irqs.h>
+
+#include "pm.h"
+
+#define PREDICT_BUCKETS		16	/* log2(us) buckets, last is open */
+#define PREDICT_WEIGHT		16	/* weight of one sample */
+#define PREDICT_AGE_LIMIT	(1 << 14) /* halve history beyond this */
+#define PREDICT_TRACE_LEN	256
+
+enum {
+	PREDICT_SRC_TIMER,
+	PREDICT_SRC_GPIO,
+	PREDICT_SRC_DMA,
+	PREDICT_SRC_MAILBOX,
+	PREDICT_SRC_OTHER,
+	PREDICT_SRC_MAX,
+};
+
+static const char *predict_src_names[PREDICT_SRC_MAX] = {
+	"gptimer", "gpio", "mcbsp/dma", "mailbox", "other",
+};
+
+struct predict_src {
+	u32 hist[PREDICT_BUCKETS];
+	u32 total;
+};
+
+struct predict_data {
+	struct predict_src src[PREDICT_SRC_MAX];
+	u32 total;
+
+	/* what the last select() decided on */
+	int last_idx;
+	unsigned int expected_us;
+
+	/* accuracy of past decisions */
+	u32 correct;
+	u32 too_deep;
+	u32 too_shallow;
+	u32 bm_demoted;
+	u32 resid_hist[CPUIDLE_STATE_MAX][PREDICT_BUCKETS];
+};
+
+struct predict_trace {
+	u32 expected_us;
+	u32 residency_us;
+	s16 irq;
+	u8 state;
+};
+
+static struct predict_data predict_live;
+static struct predict_data predict_replay;
+static struct cpuidle_device *predict_dev;
+static DEFINE_SPINLOCK(predict_lock);
+
+static struct predict_trace predict_trace_buf[PREDICT_TRACE_LEN];
+static unsigned int predict_trace_head;
+
+/* Percentage of early wakeups tolerated before a state is rejected */
+static u32 predict_early_pct = 20;
+
+/* Set from omap3_enter_idle() while interrupts are still disabled */
+static int predict_wakeup_irq = -1;
+static int predict_needs_update;
+
+/* True while omap3_predict is the governor in use */
+int omap3_predict_active(void)
+{
+	return predict_dev != NULL;
+}
+
+void omap3_predict_note_wakeup(int irq)
+{
+	predict_wakeup_irq = irq;
+}
+
+static int predict_irq_to_src(int irq)
+{
+	switch (irq) {
+	case INT_24XX_GPTIMER1 ... INT_24XX_GPTIMER11:
+	case INT_34XX_GPT12_IRQ:
+		return PREDICT_SRC_TIMER;
+	case INT_34XX_GPIO_BANK1 ... INT_34XX_GPIO_BANK6:
+		return PREDICT_SRC_GPIO;
+	case INT_24XX_SDMA_IRQ0 ... INT_24XX_SDMA_IRQ3:
+	case INT_34XX_MCBSP1_IRQ:
+	case INT_34XX_MCBSP2_IRQ:
+	case INT_34XX_MCBSP3_IRQ:
+	case INT_34XX_MCBSP4_IRQ:
+	case INT_34XX_MCBSP5_IRQ:
+		return PREDICT_SRC_DMA;
+	case INT_24XX_MAIL_U0_MPU:
+		return PREDICT_SRC_MAILBOX;
+	default:
+		return PREDICT_SRC_OTHER;
+	}
+}
+
+static inline int predict_bucket(unsigned int us)
+{
+	int b = fls(us);
+
+	return b < PREDICT_BUCKETS ? b : PREDICT_BUCKETS - 1;
+}
+
+/*
+ * Weighted count of non-timer wakeups which arrived in less than @us.
+ * Only whole buckets below the one holding @us are counted, which
+ * errs on the side of going deeper.
+ */
+static u32 predict_early_weight(struct predict_data *data, unsigned int us)
+{
+	int limit = predict_bucket(us);
+	u32 sum = 0;
+	int s, b;
+
+	for (s = 0; s < PREDICT_SRC_MAX; s++) {
+		if (s == PREDICT_SRC_TIMER)
+			continue;
+		for (b = 0; b < limit; b++)
+			sum += data->src[s].hist[b];
+	}
+	return sum;
+}
+
+static void predict_age(struct predict_data *data)
+{
+	int s, b;
+
+	data->total = 0;
+	for (s = 0; s < PREDICT_SRC_MAX; s++) {
+		struct predict_src *src = &data->src[s];
+
+		src->total = 0;
+		for (b = 0; b < PREDICT_BUCKETS; b++) {
+			src->hist[b] >>= 1;
+			src->total += src->hist[b];
+		}
+		data->total += src->total;
+	}
+}
+
+static int predict_choose(struct predict_data *data,
+			  struct cpuidle_device *dev,
+			  unsigned int expected_us, int latency_req, int busy)
+{
+	int i, idx = 0;
+
+	data->expected_us = expected_us;
+	data->last_idx = 0;
+	if (!latency_req)
+		return 0;
+
+	for (i = CPUIDLE_DRIVER_STATE_START; i < dev->state_count; i++) {
+		struct cpuidle_state *s = &dev->states[i];
+		u32 early;
+
+		if (s->target_residency > expected_us)
+			break;
+		if (s->exit_latency > latency_req)
+			break;
+		/*
+		 * omap3_enter_idle_bm() would demote us to the safe state
+		 * anyway, so do not pretend we can go that deep.
+		 */
+		if (busy && (s->flags & CPUIDLE_FLAG_CHECK_BM)) {
+			data->bm_demoted++;
+			break;
+		}
+		if (data->total) {
+			early = predict_early_weight(data, s->target_residency +
+						     s->exit_latency);
+			if (early * 100 > data->total * predict_early_pct)
+				break;
+		}
+		idx = i;
+	}
+
+	data->last_idx = idx;
+	return idx;
+}
+
+static void predict_learn(struct predict_data *data,
+			  struct cpuidle_device *dev,
+			  unsigned int measured_us, int irq)
+{
+	struct predict_src *src = &data->src[predict_irq_to_src(irq)];
+	int idx = data->last_idx;
+	int b = predict_bucket(measured_us);
+
+	src->hist[b] += PREDICT_WEIGHT;
+	src->total += PREDICT_WEIGHT;
+	data->total += PREDICT_WEIGHT;
+	if (data->total > PREDICT_AGE_LIMIT)
+		predict_age(data);
+
+	data->resid_hist[idx][b]++;
+
+	if (measured_us < dev->states[idx].target_residency)
+		data->too_deep++;
+	else if (idx + 1 < dev->state_count &&
+		 measured_us >= dev->states[idx + 1].target_residency +
+				dev->states[idx + 1].exit_latency)
+		data->too_shallow++;
+	else
+		data->correct++;
+}
+
+static int predict_select(struct cpuidle_device *dev)
+{
+	int latency_req = pm_qos_request(PM_QOS_CPU_DMA_LATENCY);
+	unsigned int expected_us;
+
+	if (predict_needs_update) {
+		unsigned int measured_us = cpuidle_get_last_residency(dev);
+		struct cpuidle_state *last =
+			&dev->states[predict_live.last_idx];
+		struct predict_trace *t;
+
+		if (!(last->flags & CPUIDLE_FLAG_TIME_VALID))
+			measured_us = predict_live.expected_us;
+
+		spin_lock(&predict_lock);
+		predict_learn(&predict_live, dev, measured_us,
+			      predict_wakeup_irq);
+		t = &predict_trace_buf[predict_trace_head++ %
+				       PREDICT_TRACE_LEN];
+		t->expected_us = predict_live.expected_us;
+		t->residency_us = measured_us;
+		t->irq = predict_wakeup_irq;
+		t->state = predict_live.last_idx;
+		spin_unlock(&predict_lock);
+
+		predict_needs_update = 0;
+	}
+
+	expected_us = DIV_ROUND_UP((u32)ktime_to_ns(
+				tick_nohz_get_sleep_length()), 1000);
+
+	return predict_choose(&predict_live, dev, expected_us, latency_req,
+			      !omap3_can_sleep());
+}
+
+static void predict_reflect(struct cpuidle_device *dev)
+{
+	predict_needs_update = 1;
+}
+
+static int predict_enable_device(struct cpuidle_device *dev)
+{
+	memset(&predict_live, 0, sizeof(predict_live));
+	predict_needs_update = 0;
+	predict_dev = dev;
+	return 0;
+}
+
+static void predict_disable_device(struct cpuidle_device *dev)
+{
+	predict_dev = NULL;
+}
+
+static struct cpuidle_governor omap3_predict_governor = {
+	.name =		"omap3_predict",
+	.rating =	30,
+	.enable =	predict_enable_device,
+	.disable =	predict_disable_device,
+	.select =	predict_select,
+	.reflect =	predict_reflect,
+	.owner =	THIS_MODULE,
+};
+
+#ifdef CONFIG_DEBUG_FS
+
+static void predict_show_data(struct seq_file *s, struct predict_data *data)
+{
+	u32 n = data->correct + data->too_deep + data->too_shallow;
+	int i, b;
+
+	seq_printf(s, "correct %u too_deep %u too_shallow %u bm_demoted %u\n",
+		   data->correct, data->too_deep, data->too_shallow,
+		   data->bm_demoted);
+	if (n)
+		seq_printf(s, "accuracy %u%%\n", data->correct * 100 / n);
+
+	for (i = 0; i < PREDICT_SRC_MAX; i++)
+		seq_printf(s, "source %-10s weight %u\n",
+			   predict_src_names[i], data->src[i].total);
+
+	seq_printf(s, "residency (log2 us buckets):\n");
+	for (i = 0; predict_dev && i < predict_dev->state_count; i++) {
+		seq_printf(s, "%-4s", predict_dev->states[i].name);
+		for (b = 0; b < PREDICT_BUCKETS; b++)
+			seq_printf(s, " %u", data->resid_hist[i][b]);
+		seq_printf(s, "\n");
+	}
+}
+
+static int predict_stats_show(struct seq_file *s, void *unused)
+{
+	struct predict_data *data = s->private;
+
+	spin_lock_irq(&predict_lock);
+	predict_show_data(s, data);
+	spin_unlock_irq(&predict_lock);
+	return 0;
+}
+
+static int predict_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, predict_stats_show, inode->i_private);
+}
+
+/*
+ * Replay: each line is "<expected_us> <residency_us> <irq>", as printed
+ * by the trace file.  Lines are run through predict_replay using the
+ * live C-state table; "reset" clears the replay instance.
+ */
+static int predict_replay_line(const char *line)
+{
+	unsigned int expected_us, residency_us;
+	int irq, ret = 0;
+
+	if (!*line)
+		return 0;
+
+	spin_lock_irq(&predict_lock);
+	if (!strncmp(line, "reset", 5)) {
+		memset(&predict_replay, 0, sizeof(predict_replay));
+	} else if (sscanf(line, "%u %u %d", &expected_us, &residency_us,
+			  &irq) == 3) {
+		predict_choose(&predict_replay, predict_dev, expected_us,
+			       PM_QOS_DEFAULT_VALUE, 0);
+		predict_learn(&predict_replay, predict_dev, residency_us, irq);
+	} else {
+		ret = -EINVAL;
+	}
+	spin_unlock_irq(&predict_lock);
+
+	return ret;
+}
+
+/*
+ * A whole trace can be written at once: it is taken a line at a time,
+ * and only the lines consumed so far are acknowledged on error.
+ */
+static ssize_t predict_replay_write(struct file *file,
+				    const char __user *ubuf,
+				    size_t count, loff_t *ppos)
+{
+	char buf[64];
+	size_t done = 0, len;
+	char *end;
+	int ret;
+
+	if (!predict_dev)
+		return -ENODEV;
+
+	while (done < count) {
+		len = min(count - done, sizeof(buf) - 1);
+		if (copy_from_user(buf, ubuf + done, len))
+			return done ? done : -EFAULT;
+		buf[len] = '\0';
+
+		end = strchr(buf, '\n');
+		if (end) {
+			*end = '\0';
+			len = end - buf + 1;
+		} else if (done + len < count) {
+			/* line longer than any valid record */
+			return done ? done : -EINVAL;
+		}
+
+		ret = predict_replay_line(buf);
+		if (ret)
+			return done ? done : ret;
+		done += len;
+	}
+
+	return done;
+}
+
+static const struct file_operations predict_stats_fops = {
+	.open		= predict_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static const struct file_operations predict_replay_fops = {
+	.open		= predict_stats_open,
+	.read		= seq_read,
+	.write		= predict_replay_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int predict_trace_show(struct seq_file *s, void *unused)
+{
+	unsigned int i, start;
+
+	spin_lock_irq(&predict_lock);
+	start = predict_trace_head > PREDICT_TRACE_LEN ?
+		predict_trace_head - PREDICT_TRACE_LEN : 0;
+	for (i = start; i < predict_trace_head; i++) {
+		struct predict_trace *t =
+			&predict_trace_buf[i % PREDICT_TRACE_LEN];
+
+		seq_printf(s, "%u %u %d C%u\n", t->expected_us,
+			   t->residency_us, t->irq, t->state + 1);
+	}
+	spin_unlock_irq(&predict_lock);
+	return 0;
+}
+
+static int predict_trace_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, predict_trace_show, NULL);
+}
+
+static const struct file_operations predict_trace_fops = {
+	.open		= predict_trace_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init predict_debugfs_init(void)
+{
+	struct dentry *d;
+
+	d = debugfs_create_dir("omap3_predict", NULL);
+	if (IS_ERR_OR_NULL(d))
+		return;
+
+	(void) debugfs_create_file("stats", S_IRUGO, d, &predict_live,
+				   &predict_stats_fops);
+	(void) debugfs_create_file("trace", S_IRUGO, d, NULL,
+				   &predict_trace_fops);
+	(void) debugfs_create_file("replay", S_IRUGO | S_IWUSR, d,
+				   &predict_replay, &predict_replay_fops);
+	(void) debugfs_create_u32("early_pct", S_IRUGO | S_IWUSR, d,
+				  &predict_early_pct);
+}
+#else
+static inline void predict_debugfs_init(void) { }
+#endif /* CONFIG_DEBUG_FS */
+
+static int __init omap3_predict_init(void)
+{
+	if (!cpu_is_omap34xx())
+		return -ENODEV;
+
+	predict_debugfs_init();
+	return cpuidle_register_governor(&omap3_predict_governor);
+}
+module_init(omap3_predict_init);
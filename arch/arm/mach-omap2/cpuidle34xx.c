@@ -160,6 +160,9 @@ static int omap3_enter_idle(struct cpuidle_device *dev,
 	}
 
 return_sleep_time:
+	/* scanning the INTC is only worth it for the predicting governor */
+	if (omap3_predict_active())
+		omap3_predict_note_wakeup(omap_irq_pending_first());
 	getnstimeofday(&ts_postidle);
 	ts_idle = timespec_sub(ts_postidle, ts_preidle);
 
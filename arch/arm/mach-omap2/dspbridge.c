@@ -42,6 +42,7 @@ static struct dspbridge_platform_data dspbridge_pdata __initdata = {
 	.cpu_set_freq	 = omap_pm_cpu_set_freq,
 	.cpu_get_freq	 = omap_pm_cpu_get_freq,
 	.dsp_get_rate_table = omap_pm_dsp_get_opp_table,
+	.set_min_bus_tput = omap_pm_set_min_bus_tput,
 #endif
 	.dsp_prm_read	= prm_read_mod_reg,
 	.dsp_prm_write	= prm_write_mod_reg,
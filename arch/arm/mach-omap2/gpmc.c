@@ -98,9 +98,16 @@ static void __iomem *gpmc_base;
 
 static struct clk *gpmc_l3_clk;
 
+/*
+ * Set whenever a GPMC register is written, so that the CORE OFF path
+ * only re-reads the GPMC context when it may have changed.
+ */
+static int gpmc_context_dirty = 1;
+
 static void gpmc_write_reg(int idx, u32 val)
 {
 	__raw_writel(val, gpmc_base + idx);
+	gpmc_context_dirty = 1;
 }
 
 static u32 gpmc_read_reg(int idx)
@@ -114,6 +121,7 @@ void gpmc_cs_write_reg(int cs, int idx, u32 val)
 
 	reg_addr = gpmc_base + GPMC_CS0 + (cs * GPMC_CS_SIZE) + idx;
 	__raw_writel(val, reg_addr);
+	gpmc_context_dirty = 1;
 }
 
 u32 gpmc_cs_read_reg(int cs, int idx)
@@ -556,6 +564,9 @@ void omap3_gpmc_save_context(void)
 {
 	int i;
 
+	if (!gpmc_context_dirty)
+		return;
+
 	gpmc_context.sysconfig = gpmc_read_reg(GPMC_SYSCONFIG);
 	gpmc_context.irqenable = gpmc_read_reg(GPMC_IRQENABLE);
 	gpmc_context.timeout_ctrl = gpmc_read_reg(GPMC_TIMEOUT_CONTROL);
@@ -582,6 +593,7 @@ void omap3_gpmc_save_context(void)
 				gpmc_cs_read_reg(i, GPMC_CS_CONFIG7);
 		}
 	}
+	gpmc_context_dirty = 0;
 }
 
 void omap3_gpmc_restore_context(void)
@@ -613,5 +625,7 @@ void omap3_gpmc_restore_context(void)
 				gpmc_context.cs_context[i].config7);
 		}
 	}
+	/* Registers now match the saved copy */
+	gpmc_context_dirty = 0;
 }
 #endif /* CONFIG_ARCH_OMAP3 */
@@ -106,6 +106,20 @@ static void omap_gpio_i2c_send_stop(OMAP_GPIO_I2C_CLIENT * client)
 	udelay(client->delay);
 }
 
+//
+// omap_gpio_i2c_send_restart
+//
+static void omap_gpio_i2c_send_restart(OMAP_GPIO_I2C_CLIENT * client)
+{
+	gpio_set_value(client->sda, GPIO_LEVEL_HIGH);
+	udelay(client->delay);
+
+	gpio_set_value(client->scl, GPIO_LEVEL_HIGH);
+	udelay(client->delay);
+
+	omap_gpio_i2c_send_start(client);
+}
+
 //
 // omap_gpio_i2c_send_byte
 // 
@@ -217,25 +231,22 @@ static unsigned char omap_gpio_i2c_poll_ack(OMAP_GPIO_I2C_CLIENT * client)
 }
 
 //
-// omap_gpio_i2c_write
+// omap_gpio_i2c_do_write
 //
-int omap_gpio_i2c_write(OMAP_GPIO_I2C_CLIENT * client, OMAP_GPIO_I2C_WR_DATA *i2c_param)
+// sends one write message after a (repeated) start condition.
+// the caller sends the stop condition, also on error.
+//
+static int omap_gpio_i2c_do_write(OMAP_GPIO_I2C_CLIENT * client, OMAP_GPIO_I2C_WR_DATA *i2c_param)
 {
 	int i = 0;
 
-	mutex_lock(&omap_gpio_i2c_mutex);
-	// send start condition
-	omap_gpio_i2c_send_start(client);
-
 	// send slave address
 	omap_gpio_i2c_send_byte(client, (client->addr << 1) | I2C_M_WR);
 
 	// receive ack/nack from slave
 	if( !omap_gpio_i2c_poll_ack(client) )
 	{
-		omap_gpio_i2c_send_stop(client);
 		printk("[omap_gpio_i2c_do_write] ack timeout while sending SA+W\n");
-		mutex_unlock(&omap_gpio_i2c_mutex);
 		return -EIO;
 	}
 
@@ -245,9 +256,7 @@ int omap_gpio_i2c_write(OMAP_GPIO_I2C_CLIENT * client, OMAP_GPIO_I2C_WR_DATA *i2
 		omap_gpio_i2c_send_byte( client, i2c_param->reg_addr[(i2c_param->reg_len-1)-i] );
 		if( !omap_gpio_i2c_poll_ack(client) )
 		{
-			omap_gpio_i2c_send_stop(client);
 			printk("[omap_gpio_i2c_do_write] ack timeout while sending RA\n");
-			mutex_unlock(&omap_gpio_i2c_mutex);
 			return -EIO;
 		}
 	}
@@ -258,23 +267,78 @@ int omap_gpio_i2c_write(OMAP_GPIO_I2C_CLIENT * client, OMAP_GPIO_I2C_WR_DATA *i2
 		omap_gpio_i2c_send_byte( client, i2c_param->wdata[i] );
 		if( !omap_gpio_i2c_poll_ack(client) )
 		{
-			omap_gpio_i2c_send_stop(client);
 			printk("[omap_gpio_i2c_do_write] ack timeout while writing DATA\n");
-			mutex_unlock(&omap_gpio_i2c_mutex);
 			return -EIO;
 		}
 	}
 
+	return 0;
+}
+
+//
+// omap_gpio_i2c_write
+//
+int omap_gpio_i2c_write(OMAP_GPIO_I2C_CLIENT * client, OMAP_GPIO_I2C_WR_DATA *i2c_param)
+{
+	int ret;
+
+	mutex_lock(&omap_gpio_i2c_mutex);
+	// send start condition
+	omap_gpio_i2c_send_start(client);
+
+	ret = omap_gpio_i2c_do_write(client, i2c_param);
+
 	// send stop condition
 	omap_gpio_i2c_send_stop(client);
 
 	mutex_unlock(&omap_gpio_i2c_mutex);
 
-	return 0;
+	return ret;
 }
 
 EXPORT_SYMBOL(omap_gpio_i2c_write);
 
+//
+// omap_gpio_i2c_write_batch
+//
+// sends num write messages as one combined transfer, like i2c_transfer()
+// does: the messages are separated by repeated starts and the bus is only
+// released after the last one. stops at the first message that is not
+// acked.
+//
+int omap_gpio_i2c_write_batch(OMAP_GPIO_I2C_CLIENT * client, OMAP_GPIO_I2C_WR_DATA *i2c_param, int num)
+{
+	int i, ret = 0;
+
+	if(client == NULL)
+	{
+		printk(KERN_ERR "[%s] client is null!\n", __func__);
+		return -EINVAL;
+	}
+
+	mutex_lock(&omap_gpio_i2c_mutex);
+
+	omap_gpio_i2c_send_start(client);
+
+	for(i = 0; i < num; i++)
+	{
+		if(i)
+			omap_gpio_i2c_send_restart(client);
+
+		ret = omap_gpio_i2c_do_write(client, &i2c_param[i]);
+		if(ret)
+			break;
+	}
+
+	omap_gpio_i2c_send_stop(client);
+
+	mutex_unlock(&omap_gpio_i2c_mutex);
+
+	return ret;
+}
+
+EXPORT_SYMBOL(omap_gpio_i2c_write_batch);
+
 //
 // omap_gpio_i2c_read
 //
@@ -64,6 +64,12 @@ struct omap3_intc_regs {
 
 static struct omap3_intc_regs intc_context[ARRAY_SIZE(irq_banks)];
 
+/*
+ * The ILRs are only programmed by omap_intc_restore_context(), so they
+ * need to be read back from the INTC once rather than on every CORE OFF.
+ */
+static int intc_ilr_saved;
+
 /* INTC bank register get/set */
 
 static void intc_bank_write_reg(u32 val, struct omap_irq_bank *bank, u16 reg)
@@ -193,6 +199,33 @@ int omap_irq_pending(void)
 	return 0;
 }
 
+/**
+ * omap_irq_pending_first - lowest numbered pending INTC interrupt
+ *
+ * Returns the number of the first interrupt found pending in the MPU
+ * INTC, or -1 if none is pending.  Meant to be called with interrupts
+ * still disabled right after wakeup, to find out which source ended
+ * the idle period.
+ */
+int omap_irq_pending_first(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(irq_banks); i++) {
+		struct omap_irq_bank *bank = irq_banks + i;
+		int irq;
+
+		for (irq = 0; irq < bank->nr_irqs; irq += 32) {
+			u32 pending = intc_bank_read_reg(bank,
+					INTC_PENDING_IRQ0 + ((irq >> 5) << 5));
+
+			if (pending)
+				return irq + __ffs(pending);
+		}
+	}
+	return -1;
+}
+
 void __init omap_init_irq(void)
 {
 	unsigned long nr_of_irqs = 0;
@@ -247,14 +280,17 @@ void omap_intc_save_context(void)
 			intc_bank_read_reg(bank, INTC_IDLE);
 		intc_context[ind].threshold =
 			intc_bank_read_reg(bank, INTC_THRESHOLD);
-		for (i = 0; i < INTCPS_NR_IRQS; i++)
-			intc_context[ind].ilr[i] =
-				intc_bank_read_reg(bank, (0x100 + 0x4*i));
+		if (!intc_ilr_saved)
+			for (i = 0; i < INTCPS_NR_IRQS; i++)
+				intc_context[ind].ilr[i] =
+					intc_bank_read_reg(bank,
+							   (0x100 + 0x4*i));
 		for (i = 0; i < INTCPS_NR_MIR_REGS; i++)
 			intc_context[ind].mir[i] =
 				intc_bank_read_reg(&irq_banks[0], INTC_MIR0 +
 				(0x20 * i));
 	}
+	intc_ilr_saved = 1;
 }
 
 void omap_intc_restore_context(void)
@@ -273,9 +309,11 @@ void omap_intc_restore_context(void)
 					bank, INTC_IDLE);
 		intc_bank_write_reg(intc_context[ind].threshold,
 					bank, INTC_THRESHOLD);
+		/* ILRs come out of OFF as zero, only rewrite the others */
 		for (i = 0; i < INTCPS_NR_IRQS; i++)
-			intc_bank_write_reg(intc_context[ind].ilr[i],
-				bank, (0x100 + 0x4*i));
+			if (intc_context[ind].ilr[i])
+				intc_bank_write_reg(intc_context[ind].ilr[i],
+					bank, (0x100 + 0x4*i));
 		for (i = 0; i < INTCPS_NR_MIR_REGS; i++)
 			intc_bank_write_reg(intc_context[ind].mir[i],
 				 &irq_banks[0], INTC_MIR0 + (0x20 * i));
@@ -667,6 +667,20 @@ static const struct file_operations debug_reg_fops = {
 	.release        = single_release,
 };
 
+#ifdef CONFIG_ARCH_OMAP3
+static int pm_dbg_context_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omap3_pm_context_stats_show, NULL);
+}
+
+static const struct file_operations pm_dbg_context_fops = {
+	.open           = pm_dbg_context_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+#endif
+
 int pm_dbg_regset_init(int reg_set)
 {
 	char name[2];
@@ -935,6 +949,11 @@ static int __init pm_dbg_init(void)
 
 	(void) debugfs_create_file("count", S_IRUGO,
 		d, (void *)DEBUG_FILE_COUNTERS, &debug_fops);
+#ifdef CONFIG_ARCH_OMAP3
+	if (cpu_is_omap34xx())
+		(void) debugfs_create_file("context_latency", S_IRUGO,
+			d, NULL, &pm_dbg_context_fops);
+#endif
 	(void) debugfs_create_file("time", S_IRUGO,
 		d, (void *)DEBUG_FILE_TIMERS, &debug_fops);
 
@@ -103,7 +103,19 @@ extern int omap2_pm_debug;
 extern void omap3_cpuidle_update_states(void);
 #endif
 
+#ifdef CONFIG_OMAP3_CPUIDLE_PREDICT
+extern int omap3_predict_active(void);
+extern void omap3_predict_note_wakeup(int irq);
+#else
+static inline int omap3_predict_active(void) { return 0; }
+static inline void omap3_predict_note_wakeup(int irq) { }
+#endif
+
+extern void omap3_secure_ram_mark_dirty(void);
+
 #if defined(CONFIG_PM_DEBUG) && defined(CONFIG_DEBUG_FS)
+struct seq_file;
+extern int omap3_pm_context_stats_show(struct seq_file *s, void *unused);
 extern void pm_dbg_update_time(struct powerdomain *pwrdm, int prev);
 extern int pm_dbg_regset_save(int reg_set);
 extern int pm_dbg_regset_init(int reg_set);
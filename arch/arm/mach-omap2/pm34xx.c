@@ -30,6 +30,8 @@
 #include <linux/clk.h>
 #include <linux/delay.h>
 #include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/seq_file.h>
 
 
 #include <linux/reboot.h>
@@ -137,9 +139,106 @@ static void omap3_disable_io_chain(void)
 				       PM_WKEN);
 }
 
+/*
+ * Per context block latency of the CORE OFF save (entry) and restore
+ * (exit) paths, exported through pm_debug/context_latency.
+ */
+enum {
+	OMAP3_CTX_PADCONF,
+	OMAP3_CTX_INTC,
+	OMAP3_CTX_GPMC,
+	OMAP3_CTX_CONTROL,
+	OMAP3_CTX_DMA,
+	OMAP3_CTX_PRCM,
+	OMAP3_CTX_MUSB,
+	OMAP3_CTX_SECURE,
+	OMAP3_CTX_SRAM,
+	OMAP3_CTX_SMS,
+	OMAP3_CTX_MAX,
+};
+
+#ifdef CONFIG_PM_DEBUG
+static const char *omap3_ctx_names[OMAP3_CTX_MAX] = {
+	"padconf", "intc", "gpmc", "control", "dma", "prcm", "musb",
+	"secure_ram", "sram", "sms",
+};
+
+struct omap3_ctx_stat {
+	u32 count;
+	u32 max_ns;
+	u64 total_ns;
+};
+
+static struct omap3_ctx_stat omap3_ctx_stats[2][OMAP3_CTX_MAX];
+
+/* Charge the time since *t to @blk and restart *t for the next block */
+static void omap3_ctx_account(int restore, int blk, ktime_t *t)
+{
+	struct omap3_ctx_stat *st = &omap3_ctx_stats[restore][blk];
+	ktime_t now = ktime_get();
+	u32 ns = (u32)ktime_to_ns(ktime_sub(now, *t));
+
+	st->count++;
+	st->total_ns += ns;
+	if (ns > st->max_ns)
+		st->max_ns = ns;
+	*t = now;
+}
+
+static inline void omap3_ctx_start(ktime_t *t)
+{
+	*t = ktime_get();
+}
+#else
+static inline void omap3_ctx_account(int restore, int blk, ktime_t *t) { }
+static inline void omap3_ctx_start(ktime_t *t) { }
+#endif /* CONFIG_PM_DEBUG */
+
+static u32 secure_ram_saves, secure_ram_skips;
+
+/*
+ * The secure RAM image only changes when secure services run.  It is
+ * saved on the first CORE OFF and then only after someone has marked it
+ * dirty, instead of calling into the ROM code on every OFF entry.
+ */
+static int secure_ram_dirty = 1;
+
+void omap3_secure_ram_mark_dirty(void)
+{
+	secure_ram_dirty = 1;
+}
+EXPORT_SYMBOL(omap3_secure_ram_mark_dirty);
+
+#ifdef CONFIG_PM_DEBUG
+int omap3_pm_context_stats_show(struct seq_file *s, void *unused)
+{
+	int dir, i;
+
+	for (dir = 0; dir < 2; dir++) {
+		seq_printf(s, "%s:\n", dir ? "restore" : "save");
+		for (i = 0; i < OMAP3_CTX_MAX; i++) {
+			struct omap3_ctx_stat *st = &omap3_ctx_stats[dir][i];
+
+			if (!st->count)
+				continue;
+			seq_printf(s, "  %-10s count %u avg %llu ns max %u ns\n",
+				   omap3_ctx_names[i], st->count,
+				   div_u64(st->total_ns, st->count),
+				   st->max_ns);
+		}
+	}
+	seq_printf(s, "secure_ram saved %u skipped %u\n",
+		   secure_ram_saves, secure_ram_skips);
+	return 0;
+}
+#endif /* CONFIG_PM_DEBUG */
+
 static void omap3_core_save_context(void)
 {
 	u32 control_padconf_off;
+	ktime_t t;
+
+	omap3_ctx_start(&t);
 
 	/* Save the padconf registers */
 	control_padconf_off = omap_ctrl_readl(OMAP343X_CONTROL_PADCONF_OFF);
@@ -156,26 +255,37 @@ static void omap3_core_save_context(void)
 	 */
 	omap_ctrl_writel(omap_ctrl_readl(OMAP343X_PADCONF_ETK_D14),
 		OMAP343X_CONTROL_MEM_WKUP + 0x2a0);
+	omap3_ctx_account(0, OMAP3_CTX_PADCONF, &t);
 
 	/* Save the Interrupt controller context */
 	omap_intc_save_context();
-	/* Save the GPMC context */
+	omap3_ctx_account(0, OMAP3_CTX_INTC, &t);
+	/* Save the GPMC context, skipped internally when unchanged */
 	omap3_gpmc_save_context();
+	omap3_ctx_account(0, OMAP3_CTX_GPMC, &t);
 	/* Save the system control module context, padconf already save above*/
 	omap3_control_save_context();
+	omap3_ctx_account(0, OMAP3_CTX_CONTROL, &t);
 	omap_dma_global_context_save();
+	omap3_ctx_account(0, OMAP3_CTX_DMA, &t);
 }
 
 static void omap3_core_restore_context(void)
 {
+	ktime_t t;
+
+	omap3_ctx_start(&t);
 	/* Restore the control module context, padconf restored by h/w */
 	omap3_control_restore_context();
+	omap3_ctx_account(1, OMAP3_CTX_CONTROL, &t);
 	/* Restore the GPMC context */
 	omap3_gpmc_restore_context();
+	omap3_ctx_account(1, OMAP3_CTX_GPMC, &t);
 	/* Restore the interrupt controller context */
 	omap_intc_restore_context();
+	omap3_ctx_account(1, OMAP3_CTX_INTC, &t);
 	omap_dma_global_context_restore();
-
+	omap3_ctx_account(1, OMAP3_CTX_DMA, &t);
 }
 /**
  * omap3_secure_copy_data_set() - set up the secure ram copy size
@@ -436,6 +546,7 @@ void omap_sram_idle(void)
 //idle current optimisation 	
 	u32 reg,cam_clks = 0;
 //idle current optimisation 	
+	ktime_t ctx_t;
 
 	if (!_omap_sram_idle)
 		return;
@@ -543,14 +654,27 @@ if(cam_in_use)
 					      OMAP3430_GR_MOD,
 					     OMAP3_PRM_VOLTCTRL_OFFSET); 
 			omap3_core_save_context();
+			omap3_ctx_start(&ctx_t);
 			omap3_prcm_save_context();
+			omap3_ctx_account(0, OMAP3_CTX_PRCM, &ctx_t);
 			/* Save MUSB context */
 			musb_context_save_restore(save_context);
-			
+			omap3_ctx_account(0, OMAP3_CTX_MUSB, &ctx_t);
+
 			/* PATCH - Off mode issue on HS device */
-			if (omap_type() != OMAP2_DEVICE_TYPE_GP)
-				omap3_save_secure_ram_context(mpu_next_state);
-			
+			if (omap_type() != OMAP2_DEVICE_TYPE_GP) {
+				if (secure_ram_dirty) {
+					omap3_save_secure_ram_context(
+							mpu_next_state);
+					secure_ram_dirty = 0;
+					secure_ram_saves++;
+				} else {
+					secure_ram_skips++;
+				}
+				omap3_ctx_account(0, OMAP3_CTX_SECURE,
+						  &ctx_t);
+			}
+
 		}
 		else if (core_next_state == PWRDM_POWER_RET) {
 			prm_set_mod_reg_bits(OMAP3430_AUTO_RET,
@@ -608,11 +732,16 @@ if(cam_in_use)
 		core_prev_state = pwrdm_read_prev_pwrst(core_pwrdm);
 		if (core_prev_state == PWRDM_POWER_OFF) {
 			omap3_core_restore_context();
+			omap3_ctx_start(&ctx_t);
 			omap3_prcm_restore_context();
+			omap3_ctx_account(1, OMAP3_CTX_PRCM, &ctx_t);
 			omap3_sram_restore_context();
+			omap3_ctx_account(1, OMAP3_CTX_SRAM, &ctx_t);
 			omap2_sms_restore_context();
+			omap3_ctx_account(1, OMAP3_CTX_SMS, &ctx_t);
 			/* Restore MUSB context */
 			musb_context_save_restore(restore_context);
+			omap3_ctx_account(1, OMAP3_CTX_MUSB, &ctx_t);
 			
 		} else {
 			musb_context_save_restore(enable_clk);
@@ -849,6 +978,9 @@ static int omap3_pm_suspend(void)
 	if (wakeup_timer_seconds || wakeup_timer_milliseconds)
 		omap2_pm_wakeup_on_timer(wakeup_timer_seconds,
 					 wakeup_timer_milliseconds);
+
+	/* Suspend is not latency critical, refresh the secure RAM image */
+	omap3_secure_ram_mark_dirty();
 #if 1 // Sleep debugging
 	printk("[omap3_pm_suspend] CM_IDLEST1_CORE : %x\n", omap_readl(0x48004A20));
 	printk("[omap3_pm_suspend] CM_IDLEST3_CORE : %x\n", omap_readl(0x48004A28));
@@ -25,6 +25,11 @@
 #include <linux/uaccess.h>
 #include <linux/kobject.h>
 #include <linux/workqueue.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <plat/opp.h>
 #include <plat/smartreflex.h>
@@ -35,6 +40,16 @@
 #define SR1P5_SAMPLING_DELAY_MS	1
 #define SR1P5_STABLE_SAMPLES	5
 #define SR1P5_MAX_TRIGGERS	5
+
+/*
+ * Converged voltages are cached per OPP and per temperature band so a
+ * band change swaps in a known-good voltage instead of recalibrating,
+ * and only uncalibrated (OPP, band) pairs run the SR loop.
+ */
+#define SR1P5_TEMP_BANDS	3
+#define SR1P5_TEMP_COLD_MAX	10	/* degC, cold band is below this */
+#define SR1P5_TEMP_HOT_MIN	50	/* degC, hot band starts here */
+#define SR1P5_TEMP_HYST		3	/* degC to leave a band again */
 #define MARGIN_STEPS
 //#define SMARTREFLEX_DEBUG
 
@@ -54,6 +69,28 @@ static unsigned long sr_margin_steps = 37500;
  */
 #define MAX_CHECK_VPTRANS_US	20
 
+/**
+ * struct sr_class1p5_stats - calibration statistics for a voltage domain
+ * @nr_calib:	completed calibrations
+ * @nr_timeout:	calibrations which gave up on an oscillating loop
+ * @nr_cached:	transitions served from an already calibrated voltage
+ * @last_us:	duration of the last calibration
+ * @max_us:	longest calibration
+ * @total_us:	sum of all calibration durations
+ * @last_conv_uv: voltage the SR loop settled at in the last calibration
+ * @last_err_uv: applied minus converged voltage of the last calibration
+ */
+struct sr_class1p5_stats {
+	u32 nr_calib;
+	u32 nr_timeout;
+	u32 nr_cached;
+	u32 last_us;
+	u32 max_us;
+	u64 total_us;
+	u32 last_conv_uv;
+	s32 last_err_uv;
+};
+
 /**
  * struct sr_class1p5_work_data - data meant to be used by calibration work
  * @work:	calibration work
@@ -62,6 +99,12 @@ static unsigned long sr_margin_steps = 37500;
  * @num_calib_triggers:	number of triggers from calibration loop
  * @num_osc_samples:	number of samples collected by isr
  * @work_active:	have we scheduled a work item?
+ * @vtable:	voltage table of @voltdm
+ * @nr_volt:	number of entries in @vtable
+ * @band_calib:	converged voltage per [opp][temperature band], 0 if unknown
+ * @calib_band:	temperature band the running calibration belongs to
+ * @calib_start: when the running calibration was started
+ * @stats:	calibration statistics
  */
 struct sr_class1p5_work_data {
 	struct delayed_work work;
@@ -70,6 +113,12 @@ struct sr_class1p5_work_data {
 	u8 num_calib_triggers;
 	u8 num_osc_samples;
 	bool work_active;
+	struct omap_volt_data *vtable;
+	int nr_volt;
+	u32 *band_calib;
+	int calib_band;
+	ktime_t calib_start;
+	struct sr_class1p5_stats stats;
 };
 
 #if CONFIG_OMAP_SR_CLASS1P5_RECALIBRATION_DELAY
@@ -91,6 +140,27 @@ static void sr_class1p5_reset_calib(struct voltagedomain *voltdm, bool reset,
 /* our instance of class 1p5 private data */
 static struct sr_class1p5_data class_1p5_data;
 
+/* current temperature band, starts in the normal band */
+static int sr1p5_band = 1;
+static int sr1p5_temp;
+static u32 sr1p5_nr_band_switch;
+
+static void sr_class1p5_band_work(struct work_struct *work);
+static DECLARE_WORK(sr1p5_band_work, sr_class1p5_band_work);
+
+static u32 *sr1p5_band_slot(struct sr_class1p5_work_data *work_data,
+			    struct omap_volt_data *vdata, int band)
+{
+	int idx;
+
+	if (!work_data->band_calib)
+		return NULL;
+	idx = vdata - work_data->vtable;
+	if (idx < 0 || idx >= work_data->nr_volt)
+		return NULL;
+	return &work_data->band_calib[idx * SR1P5_TEMP_BANDS + band];
+}
+
 static struct sr_class1p5_work_data *get_sr1p5_work(struct voltagedomain
 						    *voltdm)
 {
@@ -153,6 +223,33 @@ static int sr_class1p5_notify(struct voltagedomain *voltdm, u32 status)
 	return 0;
 }
 
+/**
+ * sr_class1p5_account() - record a finished calibration
+ * @work_data:	work data of the domain which just calibrated
+ *
+ * Updates the convergence statistics and stores the calibrated voltage
+ * in the cache slot of the band the calibration was started in.
+ */
+static void sr_class1p5_account(struct sr_class1p5_work_data *work_data)
+{
+	struct sr_class1p5_stats *st = &work_data->stats;
+	struct omap_volt_data *vdata = work_data->vdata;
+	u32 *slot;
+	s64 us;
+
+	us = ktime_us_delta(ktime_get(), work_data->calib_start);
+	st->nr_calib++;
+	st->last_us = us;
+	st->total_us += us;
+	if (st->last_us > st->max_us)
+		st->max_us = st->last_us;
+	st->last_err_uv = vdata->volt_calibrated - st->last_conv_uv;
+
+	slot = sr1p5_band_slot(work_data, vdata, work_data->calib_band);
+	if (slot)
+		*slot = vdata->volt_calibrated;
+}
+
 /**
  * do_calibrate() - work which actually does the calibration
  * @work: pointer to the work
@@ -220,6 +317,7 @@ static void do_calibrate(struct work_struct *work)
 	if (work_data->num_calib_triggers == SR1P5_MAX_TRIGGERS) {
 		pr_warning("%s: %s recalib timeout!\n", __func__,
 			   work_data->voltdm->name);
+		work_data->stats.nr_timeout++;
 		goto oscillating_calib;
 	}
 
@@ -250,6 +348,7 @@ done_calib:
 	omap_vp_disable(voltdm);
 	sr_disable(voltdm);
 
+	work_data->stats.last_conv_uv = u_volt_safe;
 	volt_data->volt_calibrated = u_volt_safe;
 	/* Setup my dynamic voltage for the next calibration for this opp */
 	volt_data->volt_dynamic_nominal = omap_get_dyn_nominal(volt_data);
@@ -289,6 +388,8 @@ done_calib:
 	volt_data->volt_dynamic_nominal, volt_data->volt_nominal);
 	#endif
 #endif
+	sr_class1p5_account(work_data);
+
 	if (volt_data->volt_calibrated != u_volt_current) {
 	
 			printk("%s:%s reconfiguring to voltage %d\n",
@@ -369,16 +470,18 @@ static int sr_class1p5_enable(struct voltagedomain *voltdm,
 		return -EINVAL;
 	}
 
-	/* if already calibrated, nothing to do here.. */
-	if (volt_data->volt_calibrated)
-		return 0;
-
 	work_data = get_sr1p5_work(voltdm);
-	if (unlikely(!work_data)) {
+	if (unlikely(IS_ERR_OR_NULL(work_data))) {
 		pr_err("%s: aieeee.. bad work data??\n", __func__);
 		return -EINVAL;
 	}
 
+	/* if already calibrated, nothing to do here.. */
+	if (volt_data->volt_calibrated) {
+		work_data->stats.nr_cached++;
+		return 0;
+	}
+
 	if (work_data->work_active)
 		return 0;
 
@@ -392,6 +495,8 @@ static int sr_class1p5_enable(struct voltagedomain *voltdm,
 	work_data->vdata = volt_data;
 	work_data->work_active = true;
 	work_data->num_calib_triggers = 0;
+	work_data->calib_band = sr1p5_band;
+	work_data->calib_start = ktime_get();
 	/* program the workqueue and leave it to calibrate offline.. */
 	schedule_delayed_work(&work_data->work,
 			      msecs_to_jiffies(SR1P5_SAMPLING_DELAY_MS *
@@ -486,6 +591,10 @@ static void sr_class1p5_reset_calib(struct voltagedomain *voltdm, bool reset,
 		sr_class1p5_disable(voltdm, work_data->vdata, 0);
 
 	omap_voltage_calib_reset(voltdm);
+	/* aging invalidates the converged voltages of every band */
+	if (work_data->band_calib)
+		memset(work_data->band_calib, 0, work_data->nr_volt *
+		       SR1P5_TEMP_BANDS * sizeof(u32));
 
 	/*
 	 * I should now reset the voltages to my nominal to be safe
@@ -504,6 +613,166 @@ static void sr_class1p5_reset_calib(struct voltagedomain *voltdm, bool reset,
 		sr_class1p5_enable(voltdm, work_data->vdata);
 }
 
+/**
+ * sr_class1p5_band_work() - switch calibrated voltages to a new band
+ * @work:	the band switch work
+ *
+ * Loads the cached converged voltages of the current temperature band
+ * into the voltage tables.  If the active OPP has a cached voltage for
+ * the new band we jump straight to it, else we go back to nominal and
+ * recalibrate the active OPP; other OPPs calibrate on first use.
+ */
+static void sr_class1p5_band_work(struct work_struct *work)
+{
+	struct sr_class1p5_work_data *work_data;
+	struct voltagedomain *voltdm;
+	struct omap_volt_data *cur;
+	unsigned long old_volt;
+	int idx, i, band;
+
+	for (idx = 0; idx < MAX_VDDS; idx++) {
+		work_data = &class_1p5_data.work_data[idx];
+		voltdm = work_data->voltdm;
+		if (!voltdm)
+			continue;
+
+		omap_vscale_pause(voltdm, false);
+		/* class could have been stopped while we waited */
+		if (work_data->voltdm != voltdm || !work_data->band_calib)
+			goto next;
+
+		if (work_data->work_active)
+			sr_class1p5_disable(voltdm, work_data->vdata, 0);
+
+		cur = omap_voltage_get_nom_volt(voltdm);
+		old_volt = omap_get_operation_voltage(cur);
+
+		band = sr1p5_band;
+		for (i = 0; i < work_data->nr_volt; i++) {
+			struct omap_volt_data *vdata = &work_data->vtable[i];
+
+			vdata->volt_calibrated =
+				work_data->band_calib[i * SR1P5_TEMP_BANDS +
+						      band];
+			vdata->volt_dynamic_nominal =
+				omap_get_dyn_nominal(vdata);
+		}
+
+		if (IS_ERR_OR_NULL(cur))
+			goto next;
+		if (omap_get_operation_voltage(cur) != old_volt)
+			omap_voltage_scale_vdd(voltdm, cur);
+		if (!cur->volt_calibrated && is_sr_enabled(voltdm))
+			sr_class1p5_enable(voltdm, cur);
+next:
+		omap_vscale_unpause(voltdm);
+	}
+}
+
+/**
+ * omap_sr_temp_notify() - report the current die/board temperature
+ * @temp:	temperature in degrees Celsius
+ *
+ * Called periodically by whoever monitors temperature. A band change
+ * (with SR1P5_TEMP_HYST of hysteresis) swaps in the converged voltages
+ * cached for the new band.
+ */
+void omap_sr_temp_notify(int temp)
+{
+	int band = sr1p5_band;
+
+	sr1p5_temp = temp;
+
+	if (band == 0 && temp >= SR1P5_TEMP_COLD_MAX + SR1P5_TEMP_HYST)
+		band = 1;
+	else if (band == 2 && temp <= SR1P5_TEMP_HOT_MIN - SR1P5_TEMP_HYST)
+		band = 1;
+	if (band == 1) {
+		if (temp < SR1P5_TEMP_COLD_MAX)
+			band = 0;
+		else if (temp >= SR1P5_TEMP_HOT_MIN)
+			band = 2;
+	}
+
+	if (band == sr1p5_band)
+		return;
+
+	sr1p5_band = band;
+	sr1p5_nr_band_switch++;
+	schedule_work(&sr1p5_band_work);
+}
+
+#ifdef CONFIG_PM_DEBUG
+static int sr_class1p5_stats_show(struct seq_file *s, void *unused)
+{
+	static const char * const band_names[SR1P5_TEMP_BANDS] = {
+		"cold", "normal", "hot",
+	};
+	struct sr_class1p5_work_data *work_data;
+	struct sr_class1p5_stats *st;
+	int idx, i, b;
+
+	seq_printf(s, "temp %dC band %s switches %u\n", sr1p5_temp,
+		   band_names[sr1p5_band], sr1p5_nr_band_switch);
+
+	for (idx = 0; idx < MAX_VDDS; idx++) {
+		work_data = &class_1p5_data.work_data[idx];
+		if (!work_data->voltdm)
+			continue;
+		st = &work_data->stats;
+
+		seq_printf(s, "\nvdd_%s: calib %u timeout %u cached %u\n",
+			   work_data->voltdm->name, st->nr_calib,
+			   st->nr_timeout, st->nr_cached);
+		seq_printf(s, "  converge us: last %u max %u avg %llu\n",
+			   st->last_us, st->max_us, st->nr_calib ?
+			   div_u64(st->total_us, st->nr_calib) : 0);
+		seq_printf(s, "  last converged %u uV, applied error %d uV\n",
+			   st->last_conv_uv, st->last_err_uv);
+
+		if (!work_data->band_calib)
+			continue;
+		seq_printf(s, "  %10s", "nominal");
+		for (b = 0; b < SR1P5_TEMP_BANDS; b++)
+			seq_printf(s, " %10s", band_names[b]);
+		seq_printf(s, "\n");
+		for (i = 0; i < work_data->nr_volt; i++) {
+			seq_printf(s, "  %10u",
+				   work_data->vtable[i].volt_nominal);
+			for (b = 0; b < SR1P5_TEMP_BANDS; b++)
+				seq_printf(s, " %10u", work_data->band_calib[
+					   i * SR1P5_TEMP_BANDS + b]);
+			seq_printf(s, "\n");
+		}
+	}
+	return 0;
+}
+
+static int sr_class1p5_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sr_class1p5_stats_show, inode->i_private);
+}
+
+static const struct file_operations sr_class1p5_stats_fops = {
+	.open		= sr_class1p5_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void sr_class1p5_debugfs_init(void)
+{
+	static struct dentry *d;
+
+	if (d || IS_ERR_OR_NULL(sr_dbg_dir))
+		return;
+	d = debugfs_create_file("class1p5_stats", S_IRUGO, sr_dbg_dir,
+				NULL, &sr_class1p5_stats_fops);
+}
+#else
+static inline void sr_class1p5_debugfs_init(void) { }
+#endif
+
 /**
  * sr_class1p5_start() - class 1p5 init
  * @voltdm:		sr voltage domain
@@ -545,6 +814,17 @@ static int sr_class1p5_start(struct voltagedomain *voltdm,
 	}
 	work_data->voltdm = voltdm;
 	INIT_DELAYED_WORK_DEFERRABLE(&work_data->work, do_calibrate);
+
+	work_data->nr_volt = omap_voltage_get_volttable(voltdm,
+							&work_data->vtable);
+	if (work_data->nr_volt > 0)
+		work_data->band_calib = kzalloc(work_data->nr_volt *
+				SR1P5_TEMP_BANDS * sizeof(u32), GFP_KERNEL);
+	if (!work_data->band_calib)
+		pr_warning("%s: %s: no per-band voltage cache\n", __func__,
+			   voltdm->name);
+
+	sr_class1p5_debugfs_init();
 	return 0;
 }
 
@@ -582,6 +862,7 @@ static int sr_class1p5_stop(struct voltagedomain *voltdm,
 	sr_class1p5_reset_calib(voltdm, true, false);
 
 	/* reset all data for this work data */
+	kfree(work_data->band_calib);
 	memset(work_data, 0, sizeof(*work_data));
 
 	return 0;
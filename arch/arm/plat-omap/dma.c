@@ -566,6 +566,26 @@ void omap_free_dma(int lch)
 }
 EXPORT_SYMBOL(omap_free_dma);
 
+/**
+ * omap_dma_free_lch_count - number of logical channels not requested
+ *
+ * Only a hint: channels may be requested or freed right after it returns.
+ */
+int omap_dma_free_lch_count(void)
+{
+	unsigned long flags;
+	int ch, count = 0;
+
+	spin_lock_irqsave(&dma_chan_lock, flags);
+	for (ch = 0; ch < dma_chan_count; ch++)
+		if (dma_chan[ch].dev_id == -1)
+			count++;
+	spin_unlock_irqrestore(&dma_chan_lock, flags);
+
+	return count;
+}
+EXPORT_SYMBOL(omap_dma_free_lch_count);
+
 /**
  * @brief omap_dma_set_prio_lch : Set channel wise priority settings
  *
@@ -65,6 +65,7 @@ struct dspbridge_platform_data {
 	void (*cpu_set_freq) (unsigned long f);
 	unsigned long (*cpu_get_freq) (void);
 	struct omap_opp *(*dsp_get_rate_table)(void);
+	int (*set_min_bus_tput)(struct device *dev, u8 agent_id, long r);
 	u8 mpu_min_speed;
 	u8 mpu_max_speed;
 	struct dsp_shm_freq_table *dsp_freq_table;
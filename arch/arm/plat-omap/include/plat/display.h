@@ -533,6 +533,24 @@ struct omap_overlay_manager_info {
 	bool alpha_enabled;
 };
 
+/*
+ * A set of overlay and manager changes taken into use together at one
+ * vsync. ovl_info[n] is used for each overlay id n set in ovl_mask, and
+ * mgr_info if set_mgr_info is true. The structure must stay untouched
+ * until callback has been called, from interrupt context, with err 0
+ * once the changes are on screen, or an error if they were dropped.
+ */
+struct omap_dss_commit {
+	u32 ovl_mask;
+	struct omap_overlay_info ovl_info[4];
+
+	bool set_mgr_info;
+	struct omap_overlay_manager_info mgr_info;
+
+	void (*callback)(struct omap_dss_commit *commit, int err);
+	void *data;
+};
+
 struct omap_overlay_manager {
 	struct kobject kobj;
 	struct list_head list;
@@ -566,6 +584,14 @@ struct omap_overlay_manager {
 	int (*wait_for_go)(struct omap_overlay_manager *mgr);
 	int (*wait_for_vsync)(struct omap_overlay_manager *mgr);
 
+	/* apply without waiting, at most two commits are queued */
+	int (*queue_commit)(struct omap_overlay_manager *mgr,
+			struct omap_dss_commit *commit);
+
+	/* auto update displays: tell that the area was redrawn in place */
+	int (*mark_dirty)(struct omap_overlay_manager *mgr,
+			u16 x, u16 y, u16 w, u16 h);
+
 	int (*enable)(struct omap_overlay_manager *mgr);
 	int (*disable)(struct omap_overlay_manager *mgr);
 };
@@ -687,6 +713,10 @@ struct omap_dss_device {
 		struct s3d_disp_info s3d_info;
 		u32 width_in_mm;
 		u32 height_in_mm;
+
+		/* ms without a new frame before driver->set_idle() is
+		 * called, 0 keeps the panel at full rate */
+		u32 idle_timeout_ms;
 	} panel;
 
 	struct {
@@ -759,6 +789,9 @@ struct omap_dss_driver {
 	int (*enable_te)(struct omap_dss_device *dssdev, bool enable);
 	int (*get_te)(struct omap_dss_device *dssdev);
 
+	/* refresh the panel at a lower rate while the content is static */
+	int (*set_idle)(struct omap_dss_device *dssdev, bool idle);
+
 	u8 (*get_rotate)(struct omap_dss_device *dssdev);
 	int (*set_rotate)(struct omap_dss_device *dssdev, u8 rotate);
 
@@ -911,6 +944,7 @@ void dpi_set_timings(struct omap_dss_device *dssdev,
 			struct omap_video_timings *timings);
 int dpi_check_timings(struct omap_dss_device *dssdev,
 			struct omap_video_timings *timings);
+int dpi_set_idle_pixel_clock(struct omap_dss_device *dssdev, int pixel_clock);
 
 int omapdss_sdi_display_enable(struct omap_dss_device *dssdev);
 void omapdss_sdi_display_disable(struct omap_dss_device *dssdev);
@@ -82,6 +82,7 @@ struct dmm_map_object {
 	u32	num_usr_pgs;
 	struct gen_pool	*gen_pool;
 	struct page	**pages;
+	struct file	*pmem_file;	/* held while a pmem buffer is mapped */
 	struct device_dma_map_info	dma_info;
 };
 
@@ -33,4 +33,5 @@ typedef struct __OMAP_GPIO_I2C_CLIENT {
 extern OMAP_GPIO_I2C_CLIENT * omap_gpio_i2c_init(int /*sda*/, int /*scl*/, int/*addr*/, int/*bps*/);
 extern void omap_gpio_i2c_deinit(OMAP_GPIO_I2C_CLIENT *);
 extern int omap_gpio_i2c_write(OMAP_GPIO_I2C_CLIENT *, OMAP_GPIO_I2C_WR_DATA *);
+extern int omap_gpio_i2c_write_batch(OMAP_GPIO_I2C_CLIENT *, OMAP_GPIO_I2C_WR_DATA *, int /*num*/);
 extern int omap_gpio_i2c_read(OMAP_GPIO_I2C_CLIENT *, OMAP_GPIO_I2C_RD_DATA *);
@@ -138,7 +138,10 @@ int omap_pm_set_max_mpu_wakeup_lat(struct pm_qos_request_list **qos_request,
  *
  * Multiple calls to omap_pm_set_min_bus_tput() will replace the
  * previous rate value for this device.  To remove the interconnect
- * throughput restriction for this device, call with r = -1.
+ * throughput restriction for this device, call with r = -1 (r = 0 is
+ * accepted as a synonym).  Increases take effect immediately; the L3
+ * rate is only lowered after the aggregate demand has stayed low for a
+ * short hysteresis period.
  *
  * Returns -EINVAL for an invalid argument, -ERANGE if the constraint
  * is not satisfiable, or 0 upon success.
@@ -316,4 +316,11 @@ static inline bool is_sr_enabled(struct voltagedomain *voltdm)
 	return false;
 }
 #endif
+
+#ifdef CONFIG_OMAP_SMARTREFLEX_CLASS1P5
+/* Temperature input (degC) for the class 1.5 per-band voltage cache */
+void omap_sr_temp_notify(int temp);
+#else
+static inline void omap_sr_temp_notify(int temp) {}
+#endif
 #endif
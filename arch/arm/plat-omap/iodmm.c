@@ -32,6 +32,8 @@
 #include <linux/kernel.h>
 #include <linux/genalloc.h>
 #include <linux/eventfd.h>
+#include <linux/file.h>
+#include <linux/android_pmem.h>
 
 #include <linux/sched.h>
 #include <asm/cacheflush.h>
@@ -230,6 +232,8 @@ static void remove_mapping_information(struct iodmm_struct *obj,
 			if (map_obj->gen_pool != NULL)
 				gen_pool_free(map_obj->gen_pool, da, size);
 			list_del(&map_obj->link);
+			if (map_obj->pmem_file)
+				fput(map_obj->pmem_file);
 			kfree(map_obj->dma_info.sg);
 			kfree(map_obj->pages);
 			kfree(map_obj);
@@ -736,6 +740,43 @@ static int user_to_device_map(struct iommu *mmu, u32 uva, u32 da, u32 size,
 	return res;
 }
 
+/*
+ * Maps a physically contiguous range using the largest pages that both
+ * da and pa are aligned to, so that big buffers cost few TLB entries.
+ */
+static void contig_to_device_map(struct iommu *mmu, u32 da, u32 pa,
+				 size_t bytes)
+{
+	struct iotlb_entry e;
+	u32 all_bits;
+	u32 pg_size[] = {SZ_16M, SZ_1M, SZ_64K, SZ_4K};
+	int size_flag[] = {MMU_CAM_PGSZ_16M, MMU_CAM_PGSZ_1M,
+				MMU_CAM_PGSZ_64K, MMU_CAM_PGSZ_4K};
+	int i;
+
+	while (bytes) {
+		/*
+		 * To find the max. page size with which both PA & VA are
+		 * aligned
+		 */
+		all_bits = pa | da;
+		for (i = 0; i < 4; i++) {
+			if ((bytes >= pg_size[i]) && ((all_bits &
+						(pg_size[i] - 1)) == 0)) {
+				iotlb_init_entry(&e, da, pa,
+						size_flag[i] |
+						MMU_RAM_ENDIAN_LITTLE |
+						MMU_RAM_ELSZ_32);
+				iopgtable_store_entry(mmu, &e);
+				bytes -= pg_size[i];
+				da += pg_size[i];
+				pa += pg_size[i];
+				break;
+			}
+		}
+	}
+}
+
 /**
  * phys_to_device_map() - maps physical addr
  * to device virtual address
@@ -752,15 +793,9 @@ static int phys_to_device_map(struct iodmm_struct *obj,
 				int pool_id, u32 *mapped_addr,
 				u32 pa, size_t bytes, u32 flags)
 {
-	struct iotlb_entry e;
 	struct dmm_map_object *dmm_obj;
 	int da;
-	u32 all_bits;
 	int err = 0;
-	u32 pg_size[] = {SZ_16M, SZ_1M, SZ_64K, SZ_4K};
-	int size_flag[] = {MMU_CAM_PGSZ_16M, MMU_CAM_PGSZ_1M,
-				MMU_CAM_PGSZ_64K, MMU_CAM_PGSZ_4K};
-	int i;
 	struct gen_pool *gen_pool;
 
 	if (!bytes) {
@@ -791,27 +826,7 @@ static int phys_to_device_map(struct iodmm_struct *obj,
 		goto err_add_map;
 	}
 
-	while (bytes) {
-		/*
-		 * To find the max. page size with which both PA & VA are
-		 * aligned
-		 */
-		all_bits = pa | da;
-		for (i = 0; i < 4; i++) {
-			if ((bytes >= pg_size[i]) && ((all_bits &
-						(pg_size[i] - 1)) == 0)) {
-				iotlb_init_entry(&e, da, pa,
-						size_flag[i] |
-						MMU_RAM_ENDIAN_LITTLE |
-						MMU_RAM_ELSZ_32);
-				iopgtable_store_entry(obj->iovmm->iommu, &e);
-				bytes -= pg_size[i];
-				da += pg_size[i];
-				pa += pg_size[i];
-				break;
-			}
-		}
-	}
+	contig_to_device_map(obj->iovmm->iommu, da, pa, bytes);
 	return 0;
 
 err_add_map:
@@ -840,6 +855,7 @@ int dmm_user(struct iodmm_struct *obj, void __user *args)
 	struct vm_area_struct *vma;
 	struct mm_struct *mm = current->mm;
 	u32 io_addr;
+	unsigned long pmem_addr;
 	struct  dmm_map_info map_info;
 	struct iotlb_entry e;
 
@@ -933,6 +949,20 @@ int dmm_user(struct iodmm_struct *obj, void __user *args)
 
 	*map_info.da = tmp_addr;
 
+	/*
+	 * pmem buffers (shared with the camera or the display) are
+	 * contiguous, so map them with large pages.  Nothing is pinned and
+	 * dmm_obj->pages stays empty, the reference on the pmem file keeps
+	 * the allocation until the buffer is unmapped.
+	 */
+	if (!get_pmem_user_phys(vma, addr_align, size_align, &pmem_addr,
+				&dmm_obj->pmem_file)) {
+		contig_to_device_map(iovmm_obj->iommu, da_align, pmem_addr,
+				     size_align);
+		err = 0;
+		goto exit;
+	}
+
 	/* Mapping the IO buffers */
 	if (vma->vm_flags & VM_IO) {
 		num_of_pages = size_align/PAGE_SIZE;
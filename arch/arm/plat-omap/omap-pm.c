@@ -21,6 +21,10 @@
 #include <linux/err.h>
 #include <linux/slab.h>
 #include <linux/list.h>
+#include <linux/workqueue.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <asm/div64.h>
 
 /* Interface documentation is in mach/omap-pm.h */
 #include <plat/omap-pm.h>
@@ -61,6 +65,25 @@ static struct interconnect_tput {
 
 } *bus_tput, *mpu_tput;
 
+/*
+ * L3 bandwidth governor.  Throughput requests are summed in KiB/s and
+ * turned into an L3 rate assuming L3_BYTES_PER_CYCLE bytes per L3 clock
+ * at l3_util_pct percent of peak.  Raising the L3 OPP is immediate;
+ * lowering it is deferred by l3_down_delay_ms so that short
+ * request/release pairs (per-frame ISP or SGX activity) do not bounce
+ * VDD2 and its SmartReflex loop up and down.
+ */
+#define L3_BYTES_PER_CYCLE	4
+
+static unsigned int l3_util_pct = 80;
+static unsigned int l3_down_delay_ms = 300;
+static unsigned long l3_cur_rate;
+static unsigned long l3_pending_rate;
+static u32 l3_nr_raise, l3_nr_lower, l3_nr_skip, l3_nr_deferred;
+
+static void l3_lower_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(l3_lower_work, l3_lower_work_fn);
+
 /* Used to represent a user of a interconnect throughput */
 struct users {
 	/* Device pointer used to uniquely identify the user */
@@ -288,13 +311,84 @@ int omap_pm_set_max_mpu_wakeup_lat(struct pm_qos_request_list **qos_request,
 }
 
 
-int omap_pm_set_min_bus_tput(struct device *dev, u8 agent_id, long r)
+/*
+ * l3_tput_to_rate - map an aggregated throughput in KiB/s to the L3
+ * OPP rate that carries it with the configured headroom.  Returns 0 if
+ * the L3 OPP table is not available.
+ */
+static unsigned long l3_tput_to_rate(struct device *l3_dev,
+		unsigned long level)
 {
+	unsigned long min_rate = 0, max_rate = ULONG_MAX, rate;
+	unsigned int pct = clamp(l3_util_pct, 10U, 100U);
+	u64 want;
 
+	if (IS_ERR(opp_find_freq_ceil(l3_dev, &min_rate)) ||
+	    IS_ERR(opp_find_freq_floor(l3_dev, &max_rate)))
+		return 0;
+
+	want = (u64)level * 1000 * 100;
+	do_div(want, L3_BYTES_PER_CYCLE * pct);
+
+	if (want <= min_rate)
+		return min_rate;
+	if (want >= max_rate)
+		return max_rate;
+
+	rate = want;
+	if (IS_ERR(opp_find_freq_ceil(l3_dev, &rate)))
+		return max_rate;
+	return rate;
+}
+
+/* Must be called with bus_tput_mutex held */
+static int l3_commit_rate(struct device *l3_dev, unsigned long rate)
+{
+	static struct device dummy_l3_dev;
 	int ret;
+
+	if (rate == l3_cur_rate) {
+		l3_nr_skip++;
+		return 0;
+	}
+
+	ret = omap_device_set_rate(&dummy_l3_dev, l3_dev, rate);
+	if (ret) {
+		pr_err("Unable to change level for interconnect bandwidth "
+			"to %ld\n", rate);
+		return ret;
+	}
+
+	if (rate > l3_cur_rate)
+		l3_nr_raise++;
+	else
+		l3_nr_lower++;
+	l3_cur_rate = rate;
+	return 0;
+}
+
+static void l3_lower_work_fn(struct work_struct *work)
+{
+	struct device *l3_dev = omap2_get_l3_device();
+
+	mutex_lock(&bus_tput_mutex);
+	if (l3_dev && l3_pending_rate && l3_pending_rate < l3_cur_rate)
+		l3_commit_rate(l3_dev, l3_pending_rate);
+	l3_pending_rate = 0;
+	mutex_unlock(&bus_tput_mutex);
+}
+
+/*
+ * A request of -1 (or 0, which several drivers use to mean "done")
+ * releases the device's constraint.
+ */
+int omap_pm_set_min_bus_tput(struct device *dev, u8 agent_id, long r)
+{
+
+	int ret = 0;
 	struct device *l3_dev;
-	static struct device dummy_l3_dev;
 	unsigned long target_level = 0;
+	unsigned long rate;
 
 	if (!dev || (agent_id != OCP_INITIATOR_AGENT &&
 	    agent_id != OCP_TARGET_AGENT)) {
@@ -310,10 +404,17 @@ int omap_pm_set_min_bus_tput(struct device *dev, u8 agent_id, long r)
 		ret = -EINVAL;
 		goto unlock;
 	}
-	if (r == -1) {
+	if (r <= 0) {
 		pr_debug("OMAP PM: remove min bus tput constraint for: "
 			"interconnect dev %s for agent_id %d\n", dev_name(dev),
 				agent_id);
+		mutex_lock(&bus_tput->throughput_mutex);
+		if (!user_lookup(dev, bus_tput)) {
+			/* Nothing to release, the L3 level is unchanged */
+			mutex_unlock(&bus_tput->throughput_mutex);
+			goto unlock;
+		}
+		mutex_unlock(&bus_tput->throughput_mutex);
 		target_level = remove_req_tput(dev, bus_tput);
 	} else {
 		pr_debug("OMAP PM: add min bus tput constraint for: "
@@ -322,13 +423,24 @@ int omap_pm_set_min_bus_tput(struct device *dev, u8 agent_id, long r)
 		target_level = add_req_tput(dev, r, bus_tput);
 	}
 
-	/* Convert the throughput(in KiB/s) into Hz. */
-	target_level = (target_level * 1000)/4;
-	ret = omap_device_set_rate(&dummy_l3_dev, l3_dev, target_level);
+	rate = l3_tput_to_rate(l3_dev, target_level);
+	if (!rate) {
+		ret = -ENODEV;
+		goto unlock;
+	}
 
-	if (ret)
-		pr_err("Unable to change level for interconnect bandwidth to %ld\n",
-			target_level);
+	if (rate >= l3_cur_rate || !l3_down_delay_ms) {
+		/* Raise now and forget any pending lower request */
+		l3_pending_rate = 0;
+		cancel_delayed_work(&l3_lower_work);
+		ret = l3_commit_rate(l3_dev, rate);
+	} else {
+		l3_pending_rate = rate;
+		l3_nr_deferred++;
+		cancel_delayed_work(&l3_lower_work);
+		schedule_delayed_work(&l3_lower_work,
+				msecs_to_jiffies(l3_down_delay_ms));
+	}
 unlock:
 	mutex_unlock(&bus_tput_mutex);
 	return ret;
@@ -739,6 +851,59 @@ int omap_pm_get_dev_context_loss_count(struct device *dev)
 }
 
 
+#ifdef CONFIG_DEBUG_FS
+static int l3_bw_show(struct seq_file *s, void *unused)
+{
+	struct users *usr;
+
+	mutex_lock(&bus_tput_mutex);
+	seq_printf(s, "l3 rate %lu Hz pending %lu Hz\n",
+		   l3_cur_rate, l3_pending_rate);
+	seq_printf(s, "raise %u lower %u deferred %u skip %u\n",
+		   l3_nr_raise, l3_nr_lower, l3_nr_deferred, l3_nr_skip);
+	if (bus_tput) {
+		mutex_lock(&bus_tput->throughput_mutex);
+		seq_printf(s, "total %lu KiB/s, %u users\n",
+			   bus_tput->target_level, bus_tput->no_of_users);
+		list_for_each_entry(usr, &bus_tput->users_list, node)
+			seq_printf(s, "  %-24s %u KiB/s\n",
+				   dev_name(usr->dev), usr->level);
+		mutex_unlock(&bus_tput->throughput_mutex);
+	}
+	mutex_unlock(&bus_tput_mutex);
+	return 0;
+}
+
+static int l3_bw_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, l3_bw_show, inode->i_private);
+}
+
+static const struct file_operations l3_bw_fops = {
+	.open		= l3_bw_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init omap_pm_debugfs_init(void)
+{
+	struct dentry *d;
+
+	d = debugfs_create_dir("omap_pm", NULL);
+	if (IS_ERR_OR_NULL(d))
+		return 0;
+
+	debugfs_create_file("l3_bw", S_IRUGO, d, NULL, &l3_bw_fops);
+	debugfs_create_u32("l3_util_pct", S_IRUGO | S_IWUSR, d,
+			   &l3_util_pct);
+	debugfs_create_u32("l3_down_delay_ms", S_IRUGO | S_IWUSR, d,
+			   &l3_down_delay_ms);
+	return 0;
+}
+late_initcall(omap_pm_debugfs_init);
+#endif
+
 /* Should be called before clk framework init */
 int __init omap_pm_if_early_init()
 {
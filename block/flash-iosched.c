@@ -0,0 +1,587 @@
+/*
+ *  Flash i/o scheduler.
+ *
+ *  Deadline based scheduler for eMMC/moviNAND style devices, derived
+ *  from the deadline scheduler.  There is no seek penalty to avoid on
+ *  flash, so requests are never held back waiting for a better one:
+ *  reads are served in fifo order, foreground reads ahead of background
+ *  ones, and writes are dispatched in sector order in batches that stay
+ *  within one erase block so the device can program it in one go.
+ *
+ *  See Documentation/block/flash-iosched.txt
+ */
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/blkdev.h>
+#include <linux/elevator.h>
+#include <linux/bio.h>
+#include <linux/ioprio.h>
+#include <linux/iocontext.h>
+#include <linux/sched.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/init.h>
+#include <linux/compiler.h>
+#include <linux/rbtree.h>
+
+static const int fg_read_expire = HZ / 8;	/* max time before a foreground read is submitted. */
+static const int bg_read_expire = HZ / 2;	/* ditto for background reads */
+static const int sync_write_expire = HZ / 2;	/* fsync and O_SYNC writes */
+static const int async_write_expire = 5 * HZ;	/* writeback, these limits are SOFT! */
+static const int writes_starved = 4;	/* max times reads can starve a write */
+static const int write_batch = 32;	/* max writes in one erase block batch */
+static const int erase_block_kb = 512;	/* erase block size writes are batched to */
+static const int fg_ioprio = IOPRIO_NORM;	/* lowest BE priority that is foreground */
+
+/*
+ * Request classes, each with its own fifo and expire time.
+ */
+enum {
+	FLASH_FG_READ = 0,
+	FLASH_BG_READ,
+	FLASH_SYNC_WRITE,
+	FLASH_ASYNC_WRITE,
+	FLASH_NR_CLASSES,
+};
+
+struct flash_data {
+	/*
+	 * run time data
+	 */
+
+	/*
+	 * requests are present on both sort_list (for merging and write
+	 * batching) and on the fifo of their class
+	 */
+	struct rb_root sort_list[2];
+	struct list_head fifo_list[FLASH_NR_CLASSES];
+
+	/*
+	 * current write batch: next write in sort order and the erase
+	 * block it has to stay in
+	 */
+	struct request *next_write;
+	sector_t batch_block;
+	unsigned int batching;		/* number of writes in this batch */
+	unsigned int starved;		/* times reads have starved writes */
+
+	/*
+	 * settings that change how the i/o scheduler behaves
+	 */
+	int fifo_expire[FLASH_NR_CLASSES];
+	int writes_starved;
+	int write_batch;
+	int erase_block_kb;
+	int fg_ioprio;
+	int front_merges;
+};
+
+static inline int flash_rq_class(struct request *rq)
+{
+	return (long)rq->elevator_private;
+}
+
+static inline struct rb_root *
+flash_rb_root(struct flash_data *fd, struct request *rq)
+{
+	return &fd->sort_list[rq_data_dir(rq)];
+}
+
+/*
+ * get the request after `rq' in sector-sorted order
+ */
+static inline struct request *
+flash_latter_request(struct request *rq)
+{
+	struct rb_node *node = rb_next(&rq->rb_node);
+
+	if (node)
+		return rb_entry_rq(node);
+
+	return NULL;
+}
+
+/*
+ * erase block number of the first sector of rq
+ */
+static inline sector_t
+flash_erase_block(struct flash_data *fd, struct request *rq)
+{
+	sector_t block = blk_rq_pos(rq);
+
+	sector_div(block, fd->erase_block_kb << 1);
+	return block;
+}
+
+/*
+ * Reads from RT tasks and from BE tasks at or above fg_ioprio are
+ * foreground.  Tasks without an explicit io priority get one from
+ * their nice level, so backgrounded (niced) apps fall below it.
+ */
+static int flash_read_is_fg(struct flash_data *fd, struct request *rq)
+{
+	struct io_context *ioc = current->io_context;
+	int ioprio = req_get_ioprio(rq);
+	int class, data;
+
+	if (!ioprio_valid(ioprio) && ioc)
+		ioprio = ioc->ioprio;
+
+	if (ioprio_valid(ioprio)) {
+		class = IOPRIO_PRIO_CLASS(ioprio);
+		data = IOPRIO_PRIO_DATA(ioprio);
+	} else {
+		class = task_nice_ioclass(current);
+		data = task_nice_ioprio(current);
+	}
+
+	switch (class) {
+	case IOPRIO_CLASS_RT:
+		return 1;
+	case IOPRIO_CLASS_IDLE:
+		return 0;
+	default:
+		return data <= fd->fg_ioprio;
+	}
+}
+
+static void flash_move_to_dispatch(struct flash_data *, struct request *);
+
+static void
+flash_add_rq_rb(struct flash_data *fd, struct request *rq)
+{
+	struct rb_root *root = flash_rb_root(fd, rq);
+	struct request *__alias;
+
+	while (unlikely(__alias = elv_rb_add(root, rq)))
+		flash_move_to_dispatch(fd, __alias);
+}
+
+static inline void
+flash_del_rq_rb(struct flash_data *fd, struct request *rq)
+{
+	if (fd->next_write == rq)
+		fd->next_write = flash_latter_request(rq);
+
+	elv_rb_del(flash_rb_root(fd, rq), rq);
+}
+
+/*
+ * add rq to rbtree and the fifo of its class
+ */
+static void
+flash_add_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	long class;
+
+	if (rq_data_dir(rq) == READ)
+		class = flash_read_is_fg(fd, rq) ? FLASH_FG_READ : FLASH_BG_READ;
+	else
+		class = rq_is_sync(rq) ? FLASH_SYNC_WRITE : FLASH_ASYNC_WRITE;
+	rq->elevator_private = (void *)class;
+
+	flash_add_rq_rb(fd, rq);
+
+	/*
+	 * set expire time and add to fifo list
+	 */
+	rq_set_fifo_time(rq, jiffies + fd->fifo_expire[class]);
+	list_add_tail(&rq->queuelist, &fd->fifo_list[class]);
+}
+
+/*
+ * remove rq from rbtree and fifo.
+ */
+static void flash_remove_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	rq_fifo_clear(rq);
+	flash_del_rq_rb(fd, rq);
+}
+
+static int
+flash_merge(struct request_queue *q, struct request **req, struct bio *bio)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	struct request *__rq;
+
+	/*
+	 * check for front merge
+	 */
+	if (fd->front_merges) {
+		sector_t sector = bio->bi_sector + bio_sectors(bio);
+
+		__rq = elv_rb_find(&fd->sort_list[bio_data_dir(bio)], sector);
+		if (__rq) {
+			BUG_ON(sector != blk_rq_pos(__rq));
+
+			if (elv_rq_merge_ok(__rq, bio)) {
+				*req = __rq;
+				return ELEVATOR_FRONT_MERGE;
+			}
+		}
+	}
+
+	return ELEVATOR_NO_MERGE;
+}
+
+static void flash_merged_request(struct request_queue *q,
+				 struct request *req, int type)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	/*
+	 * if the merge was a front merge, we need to reposition request
+	 */
+	if (type == ELEVATOR_FRONT_MERGE) {
+		elv_rb_del(flash_rb_root(fd, req), req);
+		flash_add_rq_rb(fd, req);
+	}
+}
+
+static void
+flash_merged_requests(struct request_queue *q, struct request *req,
+		      struct request *next)
+{
+	/*
+	 * if next expires before rq and sits in the same fifo, assign its
+	 * expire time to rq and move into next position (next will be
+	 * deleted) in fifo
+	 */
+	if (!list_empty(&req->queuelist) && !list_empty(&next->queuelist) &&
+	    flash_rq_class(req) == flash_rq_class(next)) {
+		if (time_before(rq_fifo_time(next), rq_fifo_time(req))) {
+			list_move(&req->queuelist, &next->queuelist);
+			rq_set_fifo_time(req, rq_fifo_time(next));
+		}
+	}
+
+	/*
+	 * kill knowledge of next, this one is a goner
+	 */
+	flash_remove_request(q, next);
+}
+
+/*
+ * move request from sort list and fifo to dispatch queue.
+ */
+static void
+flash_move_to_dispatch(struct flash_data *fd, struct request *rq)
+{
+	struct request_queue *q = rq->q;
+
+	flash_remove_request(q, rq);
+	elv_dispatch_add_tail(q, rq);
+}
+
+/*
+ * returns the head of the class fifo if its deadline has passed
+ */
+static inline struct request *
+flash_expired_request(struct flash_data *fd, int class)
+{
+	struct request *rq;
+
+	if (list_empty(&fd->fifo_list[class]))
+		return NULL;
+
+	rq = rq_entry_fifo(fd->fifo_list[class].next);
+	if (time_after(jiffies, rq_fifo_time(rq)))
+		return rq;
+
+	return NULL;
+}
+
+static inline struct request *
+flash_fifo_head(struct flash_data *fd, int class)
+{
+	if (list_empty(&fd->fifo_list[class]))
+		return NULL;
+
+	return rq_entry_fifo(fd->fifo_list[class].next);
+}
+
+static inline int flash_writes_pending(struct flash_data *fd)
+{
+	return !list_empty(&fd->fifo_list[FLASH_SYNC_WRITE]) ||
+		!list_empty(&fd->fifo_list[FLASH_ASYNC_WRITE]);
+}
+
+static void flash_dispatch_write(struct flash_data *fd, struct request *rq)
+{
+	fd->next_write = flash_latter_request(rq);
+	fd->batching++;
+	flash_move_to_dispatch(fd, rq);
+}
+
+/*
+ * Start a write batch in the erase block of rq.  The batch begins at the
+ * lowest queued write of that erase block so the block is written front
+ * to back.
+ */
+static void flash_start_write_batch(struct flash_data *fd, struct request *rq)
+{
+	sector_t block = flash_erase_block(fd, rq);
+	struct rb_node *node;
+
+	while ((node = rb_prev(&rq->rb_node)) &&
+	       flash_erase_block(fd, rb_entry_rq(node)) == block)
+		rq = rb_entry_rq(node);
+
+	fd->batch_block = block;
+	fd->batching = 0;
+	fd->starved = 0;
+	flash_dispatch_write(fd, rq);
+}
+
+/*
+ * a batch continues while the next write in sector order stays in the
+ * same erase block
+ */
+static inline struct request *flash_batch_next(struct flash_data *fd)
+{
+	struct request *rq = fd->next_write;
+
+	if (!rq || fd->batching >= fd->write_batch)
+		return NULL;
+	if (flash_erase_block(fd, rq) != fd->batch_block)
+		return NULL;
+
+	return rq;
+}
+
+static void flash_dispatch_read(struct flash_data *fd, struct request *rq)
+{
+	if (flash_writes_pending(fd))
+		fd->starved++;
+	flash_move_to_dispatch(fd, rq);
+}
+
+/*
+ * flash_dispatch_requests selects the next request: expired foreground
+ * reads first, then the rest of the current write batch until write_batch
+ * runs out, then expired writes and background reads, then foreground
+ * reads, background reads and finally a new write batch.  Reads may
+ * starve writes only writes_starved times in a row.
+ */
+static int flash_dispatch_requests(struct request_queue *q, int force)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	struct request *rq;
+
+	if ((rq = flash_expired_request(fd, FLASH_FG_READ))) {
+		flash_dispatch_read(fd, rq);
+		return 1;
+	}
+
+	if ((rq = flash_batch_next(fd))) {
+		flash_dispatch_write(fd, rq);
+		return 1;
+	}
+
+	if ((rq = flash_expired_request(fd, FLASH_SYNC_WRITE)) ||
+	    (rq = flash_expired_request(fd, FLASH_ASYNC_WRITE))) {
+		flash_start_write_batch(fd, rq);
+		return 1;
+	}
+
+	if ((rq = flash_expired_request(fd, FLASH_BG_READ))) {
+		flash_dispatch_read(fd, rq);
+		return 1;
+	}
+
+	if (flash_writes_pending(fd) && fd->starved >= fd->writes_starved)
+		goto new_write_batch;
+
+	if ((rq = flash_fifo_head(fd, FLASH_FG_READ))) {
+		flash_dispatch_read(fd, rq);
+		return 1;
+	}
+
+	if ((rq = flash_fifo_head(fd, FLASH_BG_READ))) {
+		flash_dispatch_read(fd, rq);
+		return 1;
+	}
+
+new_write_batch:
+	if ((rq = flash_fifo_head(fd, FLASH_SYNC_WRITE)) ||
+	    (rq = flash_fifo_head(fd, FLASH_ASYNC_WRITE))) {
+		flash_start_write_batch(fd, rq);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int flash_queue_empty(struct request_queue *q)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	int i;
+
+	for (i = 0; i < FLASH_NR_CLASSES; i++)
+		if (!list_empty(&fd->fifo_list[i]))
+			return 0;
+
+	return 1;
+}
+
+static void flash_exit_queue(struct elevator_queue *e)
+{
+	struct flash_data *fd = e->elevator_data;
+	int i;
+
+	for (i = 0; i < FLASH_NR_CLASSES; i++)
+		BUG_ON(!list_empty(&fd->fifo_list[i]));
+
+	kfree(fd);
+}
+
+/*
+ * initialize elevator private data (flash_data).
+ */
+static void *flash_init_queue(struct request_queue *q)
+{
+	struct flash_data *fd;
+	int i;
+
+	fd = kmalloc_node(sizeof(*fd), GFP_KERNEL | __GFP_ZERO, q->node);
+	if (!fd)
+		return NULL;
+
+	for (i = 0; i < FLASH_NR_CLASSES; i++)
+		INIT_LIST_HEAD(&fd->fifo_list[i]);
+	fd->sort_list[READ] = RB_ROOT;
+	fd->sort_list[WRITE] = RB_ROOT;
+	fd->fifo_expire[FLASH_FG_READ] = fg_read_expire;
+	fd->fifo_expire[FLASH_BG_READ] = bg_read_expire;
+	fd->fifo_expire[FLASH_SYNC_WRITE] = sync_write_expire;
+	fd->fifo_expire[FLASH_ASYNC_WRITE] = async_write_expire;
+	fd->writes_starved = writes_starved;
+	fd->write_batch = write_batch;
+	fd->erase_block_kb = erase_block_kb;
+	fd->fg_ioprio = fg_ioprio;
+	fd->front_merges = 1;
+	return fd;
+}
+
+/*
+ * sysfs parts below
+ */
+
+static ssize_t
+flash_var_show(int var, char *page)
+{
+	return sprintf(page, "%d\n", var);
+}
+
+static ssize_t
+flash_var_store(int *var, const char *page, size_t count)
+{
+	char *p = (char *) page;
+
+	*var = simple_strtol(p, &p, 10);
+	return count;
+}
+
+#define SHOW_FUNCTION(__FUNC, __VAR, __CONV)				\
+static ssize_t __FUNC(struct elevator_queue *e, char *page)		\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data = __VAR;						\
+	if (__CONV)							\
+		__data = jiffies_to_msecs(__data);			\
+	return flash_var_show(__data, (page));				\
+}
+SHOW_FUNCTION(flash_fg_read_expire_show, fd->fifo_expire[FLASH_FG_READ], 1);
+SHOW_FUNCTION(flash_bg_read_expire_show, fd->fifo_expire[FLASH_BG_READ], 1);
+SHOW_FUNCTION(flash_sync_write_expire_show, fd->fifo_expire[FLASH_SYNC_WRITE], 1);
+SHOW_FUNCTION(flash_async_write_expire_show, fd->fifo_expire[FLASH_ASYNC_WRITE], 1);
+SHOW_FUNCTION(flash_writes_starved_show, fd->writes_starved, 0);
+SHOW_FUNCTION(flash_write_batch_show, fd->write_batch, 0);
+SHOW_FUNCTION(flash_erase_block_kb_show, fd->erase_block_kb, 0);
+SHOW_FUNCTION(flash_fg_ioprio_show, fd->fg_ioprio, 0);
+SHOW_FUNCTION(flash_front_merges_show, fd->front_merges, 0);
+#undef SHOW_FUNCTION
+
+#define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
+static ssize_t __FUNC(struct elevator_queue *e, const char *page, size_t count)	\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data;							\
+	int ret = flash_var_store(&__data, (page), count);		\
+	if (__data < (MIN))						\
+		__data = (MIN);						\
+	else if (__data > (MAX))					\
+		__data = (MAX);						\
+	if (__CONV)							\
+		*(__PTR) = msecs_to_jiffies(__data);			\
+	else								\
+		*(__PTR) = __data;					\
+	return ret;							\
+}
+STORE_FUNCTION(flash_fg_read_expire_store, &fd->fifo_expire[FLASH_FG_READ], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_bg_read_expire_store, &fd->fifo_expire[FLASH_BG_READ], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_sync_write_expire_store, &fd->fifo_expire[FLASH_SYNC_WRITE], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_async_write_expire_store, &fd->fifo_expire[FLASH_ASYNC_WRITE], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_writes_starved_store, &fd->writes_starved, 0, INT_MAX, 0);
+STORE_FUNCTION(flash_write_batch_store, &fd->write_batch, 1, INT_MAX, 0);
+STORE_FUNCTION(flash_erase_block_kb_store, &fd->erase_block_kb, 4, 64 * 1024, 0);
+STORE_FUNCTION(flash_fg_ioprio_store, &fd->fg_ioprio, 0, IOPRIO_BE_NR - 1, 0);
+STORE_FUNCTION(flash_front_merges_store, &fd->front_merges, 0, 1, 0);
+#undef STORE_FUNCTION
+
+#define FD_ATTR(name) \
+	__ATTR(name, S_IRUGO|S_IWUSR, flash_##name##_show, \
+				      flash_##name##_store)
+
+static struct elv_fs_entry flash_attrs[] = {
+	FD_ATTR(fg_read_expire),
+	FD_ATTR(bg_read_expire),
+	FD_ATTR(sync_write_expire),
+	FD_ATTR(async_write_expire),
+	FD_ATTR(writes_starved),
+	FD_ATTR(write_batch),
+	FD_ATTR(erase_block_kb),
+	FD_ATTR(fg_ioprio),
+	FD_ATTR(front_merges),
+	__ATTR_NULL
+};
+
+static struct elevator_type iosched_flash = {
+	.ops = {
+		.elevator_merge_fn = 		flash_merge,
+		.elevator_merged_fn =		flash_merged_request,
+		.elevator_merge_req_fn =	flash_merged_requests,
+		.elevator_dispatch_fn =		flash_dispatch_requests,
+		.elevator_add_req_fn =		flash_add_request,
+		.elevator_queue_empty_fn =	flash_queue_empty,
+		.elevator_former_req_fn =	elv_rb_former_request,
+		.elevator_latter_req_fn =	elv_rb_latter_request,
+		.elevator_init_fn =		flash_init_queue,
+		.elevator_exit_fn =		flash_exit_queue,
+	},
+
+	.elevator_attrs = flash_attrs,
+	.elevator_name = "flash",
+	.elevator_owner = THIS_MODULE,
+};
+
+static int __init flash_init(void)
+{
+	elv_register(&iosched_flash);
+
+	return 0;
+}
+
+static void __exit flash_exit(void)
+{
+	elv_unregister(&iosched_flash);
+}
+
+module_init(flash_init);
+module_exit(flash_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("flash IO scheduler");
@@ -0,0 +1,530 @@
+/*
+ *  drivers/cpufreq/cpufreq_interactive.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * 'interactive' - event driven governor for touch devices.
+ *
+ * Unlike ondemand, which samples on a fixed period whether the CPU is
+ * busy or not, this governor samples on a short deferrable timer that
+ * only runs while the CPU is awake, and jumps straight to hispeed_freq
+ * as soon as the load crosses go_hispeed_load, when the CPU leaves idle
+ * with work queued, or when an input (touch/key) event arrives.  It only
+ * steps down once the current speed has been held for min_sample_time,
+ * so a scroll does not bounce between OPPs.  Speed changes are made from
+ * a SCHED_FIFO thread through __cpufreq_driver_target(), i.e. the normal
+ * cpufreq driver (omap_target on OMAP).
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/cpufreq.h>
+#include <linux/input.h>
+#include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/kthread.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/tick.h>
+#include <linux/timer.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/cpufreq_interactive.h>
+
+struct cpufreq_interactive_cpuinfo {
+	struct timer_list cpu_timer;
+	u64 time_in_idle;
+	u64 timer_run_time;
+	struct cpufreq_policy *policy;
+	struct cpufreq_frequency_table *freq_table;
+	unsigned int target_freq;
+	unsigned int floor_freq;
+	u64 floor_validate_time;
+	int governor_enabled;
+};
+
+static DEFINE_PER_CPU(struct cpufreq_interactive_cpuinfo, cpuinfo);
+
+/* realtime thread handles frequency changes */
+static struct task_struct *speedchange_task;
+static cpumask_t speedchange_cpumask;
+static DEFINE_SPINLOCK(speedchange_cpumask_lock);
+static DEFINE_MUTEX(gov_lock);
+static int active_count;
+
+/* Hi speed to bump to from lo speed when load burst (default max) */
+static unsigned int hispeed_freq;
+
+/* Go to hi speed when CPU load at or above this value. */
+#define DEFAULT_GO_HISPEED_LOAD 85
+static unsigned long go_hispeed_load;
+
+/* Minimum time (us) to hold a speed before ramping down. */
+#define DEFAULT_MIN_SAMPLE_TIME (80 * USEC_PER_MSEC)
+static unsigned long min_sample_time;
+
+/* Sampling period (us) while the CPU is busy. */
+#define DEFAULT_TIMER_RATE (20 * USEC_PER_MSEC)
+static unsigned long timer_rate;
+
+/* Ramp to hispeed_freq on input events. */
+static unsigned int input_boost = 1;
+
+static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
+		unsigned int event);
+
+#ifndef CONFIG_CPU_FREQ_DEFAULT_GOV_INTERACTIVE
+static
+#endif
+struct cpufreq_governor cpufreq_gov_interactive = {
+	.name = "interactive",
+	.governor = cpufreq_governor_interactive,
+	.max_transition_latency = 10000000,
+	.owner = THIS_MODULE,
+};
+
+static void cpufreq_interactive_timer_resched(
+	struct cpufreq_interactive_cpuinfo *pcpu)
+{
+	mod_timer(&pcpu->cpu_timer,
+		  jiffies + usecs_to_jiffies(timer_rate));
+}
+
+/* Ask the speedchange thread to move @cpu to @new_freq. */
+static void cpufreq_interactive_queue(unsigned int cpu,
+				      struct cpufreq_interactive_cpuinfo *pcpu,
+				      unsigned int new_freq, u64 now)
+{
+	unsigned long flags;
+
+	pcpu->target_freq = new_freq;
+	pcpu->floor_freq = new_freq;
+	pcpu->floor_validate_time = now;
+
+	spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+	cpumask_set_cpu(cpu, &speedchange_cpumask);
+	spin_unlock_irqrestore(&speedchange_cpumask_lock, flags);
+	wake_up_process(speedchange_task);
+}
+
+static void cpufreq_interactive_timer(unsigned long data)
+{
+	unsigned int cpu = data;
+	struct cpufreq_interactive_cpuinfo *pcpu = &per_cpu(cpuinfo, cpu);
+	struct cpufreq_policy *policy = pcpu->policy;
+	u64 now, now_idle;
+	unsigned int delta_idle, delta_time;
+	unsigned int load, new_freq, index;
+	int stale;
+
+	if (!pcpu->governor_enabled)
+		return;
+
+	now_idle = get_cpu_idle_time_us(cpu, &now);
+	delta_idle = (unsigned int)(now_idle - pcpu->time_in_idle);
+	delta_time = (unsigned int)(now - pcpu->timer_run_time);
+	pcpu->time_in_idle = now_idle;
+	pcpu->timer_run_time = now;
+
+	/*
+	 * The timer is deferrable, so a window much longer than timer_rate
+	 * means we just came out of idle.  Its load says nothing about what
+	 * woke us; go fast right away if there is work queued, otherwise
+	 * sample again over the busy period only.
+	 */
+	stale = delta_time > 2 * timer_rate;
+	if (stale) {
+		if (nr_running() > 1 && policy->cur < hispeed_freq) {
+			trace_cpufreq_interactive_up(cpu, 100, policy->cur,
+						     hispeed_freq);
+			cpufreq_interactive_queue(cpu, pcpu, hispeed_freq, now);
+		}
+		goto rearm;
+	}
+
+	if (!delta_time || delta_idle >= delta_time)
+		load = 0;
+	else
+		load = 100 * (delta_time - delta_idle) / delta_time;
+
+	if (load >= go_hispeed_load) {
+		if (policy->cur < hispeed_freq)
+			new_freq = hispeed_freq;
+		else
+			new_freq = max(hispeed_freq, policy->max * load / 100);
+	} else {
+		new_freq = policy->max * load / 100;
+	}
+
+	if (cpufreq_frequency_table_target(policy, pcpu->freq_table,
+					   new_freq, CPUFREQ_RELATION_H,
+					   &index))
+		goto rearm;
+	new_freq = pcpu->freq_table[index].frequency;
+
+	/* Hold the current floor for min_sample_time before going down */
+	if (new_freq < pcpu->floor_freq &&
+	    now - pcpu->floor_validate_time < min_sample_time)
+		goto rearm;
+
+	if (new_freq == pcpu->target_freq) {
+		pcpu->floor_freq = new_freq;
+		pcpu->floor_validate_time = now;
+		goto rearm;
+	}
+
+	if (new_freq > pcpu->target_freq)
+		trace_cpufreq_interactive_up(cpu, load, pcpu->target_freq,
+					     new_freq);
+	else
+		trace_cpufreq_interactive_down(cpu, load, pcpu->target_freq,
+					       new_freq);
+
+	cpufreq_interactive_queue(cpu, pcpu, new_freq, now);
+
+rearm:
+	if (!timer_pending(&pcpu->cpu_timer))
+		cpufreq_interactive_timer_resched(pcpu);
+}
+
+static int cpufreq_interactive_speedchange_task(void *data)
+{
+	unsigned int cpu;
+	cpumask_t tmp_mask;
+	unsigned long flags;
+	struct cpufreq_interactive_cpuinfo *pcpu;
+
+	while (1) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+
+		if (cpumask_empty(&speedchange_cpumask)) {
+			spin_unlock_irqrestore(&speedchange_cpumask_lock,
+					       flags);
+			schedule();
+
+			if (kthread_should_stop())
+				break;
+
+			spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+		}
+
+		set_current_state(TASK_RUNNING);
+		tmp_mask = speedchange_cpumask;
+		cpumask_clear(&speedchange_cpumask);
+		spin_unlock_irqrestore(&speedchange_cpumask_lock, flags);
+
+		mutex_lock(&gov_lock);
+		for_each_cpu(cpu, &tmp_mask) {
+			pcpu = &per_cpu(cpuinfo, cpu);
+			if (!pcpu->governor_enabled)
+				continue;
+
+			__cpufreq_driver_target(pcpu->policy,
+						pcpu->target_freq,
+						CPUFREQ_RELATION_H);
+		}
+		mutex_unlock(&gov_lock);
+	}
+
+	return 0;
+}
+
+static void cpufreq_interactive_boost(void)
+{
+	unsigned int cpu;
+	u64 now = ktime_to_us(ktime_get());
+
+	for_each_online_cpu(cpu) {
+		struct cpufreq_interactive_cpuinfo *pcpu =
+			&per_cpu(cpuinfo, cpu);
+
+		if (!pcpu->governor_enabled ||
+		    pcpu->target_freq >= hispeed_freq)
+			continue;
+
+		trace_cpufreq_interactive_up(cpu, 0, pcpu->target_freq,
+					     hispeed_freq);
+		cpufreq_interactive_queue(cpu, pcpu, hispeed_freq, now);
+	}
+}
+
+/*
+ * Input boost.  Touch and key events are the earliest hint that a frame
+ * is about to be drawn, so ramp up before the load shows up.
+ */
+static void cpufreq_interactive_input_event(struct input_handle *handle,
+					    unsigned int type,
+					    unsigned int code, int value)
+{
+	if (!input_boost || !active_count)
+		return;
+	if (type != EV_ABS && type != EV_KEY)
+		return;
+
+	trace_cpufreq_interactive_boost(type, code);
+	cpufreq_interactive_boost();
+}
+
+static int cpufreq_interactive_input_connect(struct input_handler *handler,
+					     struct input_dev *dev,
+					     const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "cpufreq_interactive";
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err_free;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err_unregister;
+
+	return 0;
+
+err_unregister:
+	input_unregister_handle(handle);
+err_free:
+	kfree(handle);
+	return error;
+}
+
+static void cpufreq_interactive_input_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id cpufreq_interactive_ids[] = {
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			    BIT_MASK(ABS_MT_POSITION_X) },
+	},
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_KEYBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
+		.absbit = { [BIT_WORD(ABS_X)] = BIT_MASK(ABS_X) },
+	},
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_KEY) },
+	},
+	{ },
+};
+
+static struct input_handler cpufreq_interactive_input_handler = {
+	.event		= cpufreq_interactive_input_event,
+	.connect	= cpufreq_interactive_input_connect,
+	.disconnect	= cpufreq_interactive_input_disconnect,
+	.name		= "cpufreq_interactive",
+	.id_table	= cpufreq_interactive_ids,
+};
+
+/* cpufreq_interactive Governor Tunables */
+#define show_one(file_name, object)					\
+static ssize_t show_##file_name						\
+(struct kobject *kobj, struct attribute *attr, char *buf)		\
+{									\
+	return sprintf(buf, "%lu\n", (unsigned long)object);		\
+}
+
+#define store_one(file_name, object)					\
+static ssize_t store_##file_name					\
+(struct kobject *kobj, struct attribute *attr, const char *buf,	\
+ size_t count)								\
+{									\
+	unsigned long val;						\
+									\
+	if (strict_strtoul(buf, 0, &val))				\
+		return -EINVAL;						\
+	object = val;							\
+	return count;							\
+}
+
+show_one(hispeed_freq, hispeed_freq);
+store_one(hispeed_freq, hispeed_freq);
+show_one(go_hispeed_load, go_hispeed_load);
+store_one(go_hispeed_load, go_hispeed_load);
+show_one(min_sample_time, min_sample_time);
+store_one(min_sample_time, min_sample_time);
+show_one(timer_rate, timer_rate);
+
+static ssize_t store_timer_rate(struct kobject *kobj,
+				struct attribute *attr, const char *buf,
+				size_t count)
+{
+	unsigned long val;
+
+	if (strict_strtoul(buf, 0, &val))
+		return -EINVAL;
+	/* anything below a jiffy would re-arm the timer every tick */
+	if (val < jiffies_to_usecs(1))
+		return -EINVAL;
+	timer_rate = val;
+	return count;
+}
+
+show_one(input_boost, input_boost);
+store_one(input_boost, input_boost);
+
+define_one_global_rw(hispeed_freq);
+define_one_global_rw(go_hispeed_load);
+define_one_global_rw(min_sample_time);
+define_one_global_rw(timer_rate);
+define_one_global_rw(input_boost);
+
+static struct attribute *interactive_attributes[] = {
+	&hispeed_freq.attr,
+	&go_hispeed_load.attr,
+	&min_sample_time.attr,
+	&timer_rate.attr,
+	&input_boost.attr,
+	NULL,
+};
+
+static struct attribute_group interactive_attr_group = {
+	.attrs = interactive_attributes,
+	.name = "interactive",
+};
+
+static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
+		unsigned int event)
+{
+	int rc;
+	unsigned int j;
+	struct cpufreq_interactive_cpuinfo *pcpu;
+	struct cpufreq_frequency_table *freq_table;
+
+	switch (event) {
+	case CPUFREQ_GOV_START:
+		if (!cpu_online(policy->cpu))
+			return -EINVAL;
+
+		freq_table = cpufreq_frequency_get_table(policy->cpu);
+		if (!freq_table)
+			return -EINVAL;
+
+		mutex_lock(&gov_lock);
+		/* Tunables are global, only register them once */
+		if (!active_count) {
+			rc = sysfs_create_group(cpufreq_global_kobject,
+						&interactive_attr_group);
+			if (rc) {
+				mutex_unlock(&gov_lock);
+				return rc;
+			}
+		}
+		active_count++;
+
+		if (!hispeed_freq)
+			hispeed_freq = policy->max;
+
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(cpuinfo, j);
+			pcpu->policy = policy;
+			pcpu->target_freq = policy->cur;
+			pcpu->freq_table = freq_table;
+			pcpu->floor_freq = pcpu->target_freq;
+			pcpu->time_in_idle = get_cpu_idle_time_us(j,
+						&pcpu->timer_run_time);
+			pcpu->floor_validate_time = pcpu->timer_run_time;
+			pcpu->governor_enabled = 1;
+			pcpu->cpu_timer.expires =
+				jiffies + usecs_to_jiffies(timer_rate);
+			add_timer_on(&pcpu->cpu_timer, j);
+		}
+		mutex_unlock(&gov_lock);
+		break;
+
+	case CPUFREQ_GOV_STOP:
+		mutex_lock(&gov_lock);
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(cpuinfo, j);
+			pcpu->governor_enabled = 0;
+			del_timer_sync(&pcpu->cpu_timer);
+		}
+
+		if (!--active_count)
+			sysfs_remove_group(cpufreq_global_kobject,
+					   &interactive_attr_group);
+		mutex_unlock(&gov_lock);
+		break;
+
+	case CPUFREQ_GOV_LIMITS:
+		if (policy->max < policy->cur)
+			__cpufreq_driver_target(policy,
+					policy->max, CPUFREQ_RELATION_H);
+		else if (policy->min > policy->cur)
+			__cpufreq_driver_target(policy,
+					policy->min, CPUFREQ_RELATION_L);
+		break;
+	}
+	return 0;
+}
+
+static int __init cpufreq_interactive_init(void)
+{
+	unsigned int i;
+	struct cpufreq_interactive_cpuinfo *pcpu;
+	struct sched_param param = { .sched_priority = MAX_RT_PRIO-1 };
+	int rc;
+
+	go_hispeed_load = DEFAULT_GO_HISPEED_LOAD;
+	min_sample_time = DEFAULT_MIN_SAMPLE_TIME;
+	timer_rate = DEFAULT_TIMER_RATE;
+
+	/* Initalize per-cpu timers */
+	for_each_possible_cpu(i) {
+		pcpu = &per_cpu(cpuinfo, i);
+		init_timer_deferrable(&pcpu->cpu_timer);
+		pcpu->cpu_timer.function = cpufreq_interactive_timer;
+		pcpu->cpu_timer.data = i;
+	}
+
+	speedchange_task = kthread_create(cpufreq_interactive_speedchange_task,
+					  NULL, "cfinteractive");
+	if (IS_ERR(speedchange_task))
+		return PTR_ERR(speedchange_task);
+
+	sched_setscheduler_nocheck(speedchange_task, SCHED_FIFO, &param);
+
+	/* NB: wake up so the thread does not look hung to the freezer */
+	wake_up_process(speedchange_task);
+
+	rc = input_register_handler(&cpufreq_interactive_input_handler);
+	if (rc)
+		pr_warning("cpufreq_interactive: no input boost (%d)\n", rc);
+
+	return cpufreq_register_governor(&cpufreq_gov_interactive);
+}
+
+#ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_INTERACTIVE
+fs_initcall(cpufreq_interactive_init);
+#else
+module_init(cpufreq_interactive_init);
+#endif
+
+MODULE_DESCRIPTION("'cpufreq_interactive' - A cpufreq governor for "
+	"latency sensitive workloads");
+MODULE_LICENSE("GPL");
@@ -42,6 +42,7 @@
 #include "_tiomap_util.h"
 #include <mach-omap2/prm-regbits-34xx.h>
 #include <mach-omap2/cm-regbits-34xx.h>
+#include <plat/omap-pm.h>
 
 #ifdef CONFIG_PM
 extern s32 dsp_test_sleepstate;
@@ -75,6 +76,15 @@ int handle_constraints_set(struct wmd_dev_context *dev_context,
 	/* Set the new opp value */
 	if (pdata->dsp_set_min_opp)
 		(*pdata->dsp_set_min_opp) (opp_idx);
+
+	/*
+	 * Codec traffic scales with the DSP clock: ask the L3 governor
+	 * for about one byte per DSP cycle so VDD2 follows VDD1.
+	 */
+	if (pdata->set_min_bus_tput && pdata->dsp_freq_table)
+		(*pdata->set_min_bus_tput)(&omap_dspbridge_dev->dev,
+			OCP_INITIATOR_AGENT,
+			pdata->dsp_freq_table[opp_idx].dsp_freq);
 #endif /* #ifdef CONFIG_BRIDGE_DVFS */
 	return 0;
 }
@@ -162,6 +172,10 @@ func_cont:
 			 */
 			if (pdata->dsp_set_min_opp)
 				(*pdata->dsp_set_min_opp)(pdata->mpu_min_speed);
+			if (pdata->set_min_bus_tput)
+				(*pdata->set_min_bus_tput)(
+					&omap_dspbridge_dev->dev,
+					OCP_INITIATOR_AGENT, -1);
 
 			status = 0;
 		}
@@ -297,6 +311,10 @@ func_cont:
 			 */
 			if (pdata->dsp_set_min_opp)
 				(*pdata->dsp_set_min_opp)(pdata->mpu_min_speed);
+			if (pdata->set_min_bus_tput)
+				(*pdata->set_min_bus_tput)(
+					&omap_dspbridge_dev->dev,
+					OCP_INITIATOR_AGENT, -1);
 		}
 #endif /* CONFIG_BRIDGE_DVFS */
 	}
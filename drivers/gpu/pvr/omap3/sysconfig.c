@@ -571,6 +571,13 @@ PVRSRV_ERROR SysFinalise(IMG_VOID)
 
 	gpsSysSpecificData->bSGXInitComplete = IMG_TRUE;
 
+#if defined(SUPPORT_SGX_PREDICTIVE_POWER)
+	if (SysSGXPredictivePowerInit(gpsSysData) == PVRSRV_OK)
+	{
+		SYS_SPECIFIC_DATA_SET(&gsSysSpecificData, SYS_SPECIFIC_DATA_ENABLE_PREDICTIVE_POWER);
+	}
+#endif
+
 	return eError;
 }
 
@@ -579,6 +586,14 @@ PVRSRV_ERROR SysDeinitialise (SYS_DATA *psSysData)
 {
 	PVRSRV_ERROR eError;
 
+#if defined(SUPPORT_SGX_PREDICTIVE_POWER)
+	if (SYS_SPECIFIC_DATA_TEST(gpsSysSpecificData, SYS_SPECIFIC_DATA_ENABLE_PREDICTIVE_POWER))
+	{
+		SysSGXPredictivePowerDeinit(psSysData);
+		SYS_SPECIFIC_DATA_CLEAR(gpsSysSpecificData, SYS_SPECIFIC_DATA_ENABLE_PREDICTIVE_POWER);
+	}
+#endif
+
 #if defined(SYS_USING_INTERRUPTS)
 	if (SYS_SPECIFIC_DATA_TEST(gpsSysSpecificData, SYS_SPECIFIC_DATA_ENABLE_LISR))
 	{
@@ -902,6 +917,9 @@ PVRSRV_ERROR SysDevicePrePowerState(IMG_UINT32				ui32DeviceIndex,
 	if (eNewPowerState == PVRSRV_DEV_POWER_STATE_OFF)
 	{
 		PVR_DPF((PVR_DBG_MESSAGE, "SysDevicePrePowerState: SGX Entering state D3"));
+#if defined(SUPPORT_SGX_PREDICTIVE_POWER)
+		SysSGXPowerDown(gpsSysData);
+#endif
 		DisableSGXClocks(gpsSysData);
 	}
 #else
@@ -928,6 +946,9 @@ PVRSRV_ERROR SysDevicePostPowerState(IMG_UINT32				ui32DeviceIndex,
 	if (eCurrentPowerState == PVRSRV_DEV_POWER_STATE_OFF)
 	{
 		PVR_DPF((PVR_DBG_MESSAGE, "SysDevicePostPowerState: SGX Leaving state D3"));
+#if defined(SUPPORT_SGX_PREDICTIVE_POWER)
+		SysSGXPowerUp(gpsSysData);
+#endif
 		eError = EnableSGXClocksWrap(gpsSysData);
 	}
 #else
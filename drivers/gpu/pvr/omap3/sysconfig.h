@@ -44,6 +44,15 @@
 #define SYS_SGX_ACTIVE_POWER_LATENCY_MS		(1)
 #endif
 
+#if defined(SUPPORT_SGX_PREDICTIVE_POWER)
+#if !defined(SYS_SGX_FRAME_PERIOD_US)
+#define SYS_SGX_FRAME_PERIOD_US				(16667)
+#endif
+#define SYS_SGX_ACTIVE_POWER_LATENCY_MAX_MS	((SYS_SGX_FRAME_PERIOD_US + 999) / 1000)
+#define SYS_SGX_ACTIVE_POWER_DECAY_FRAMES	(4)
+#define SYS_SGX_PREWARM_HOLDOFF_MS			(100)
+#endif
+
 
 #define SYS_OMAP3430_SGX_REGS_SYS_PHYS_BASE  0x50000000
 
@@ -37,6 +37,10 @@
 #include <linux/spinlock.h>
 #endif
 #include <asm/atomic.h>
+#if defined(SUPPORT_SGX_PREDICTIVE_POWER)
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
+#endif
 
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2,6,26))
 #include <linux/semaphore.h>
@@ -64,6 +68,13 @@ PVRSRV_ERROR EnableSystemClocks(SYS_DATA *psSysData);
 IMG_VOID DisableSGXClocks(SYS_DATA *psSysData);
 PVRSRV_ERROR EnableSGXClocks(SYS_DATA *psSysData);
 
+#if defined(SUPPORT_SGX_PREDICTIVE_POWER)
+IMG_VOID SysSGXPowerDown(SYS_DATA *psSysData);
+IMG_VOID SysSGXPowerUp(SYS_DATA *psSysData);
+PVRSRV_ERROR SysSGXPredictivePowerInit(SYS_DATA *psSysData);
+IMG_VOID SysSGXPredictivePowerDeinit(SYS_DATA *psSysData);
+#endif
+
 #define SYS_SPECIFIC_DATA_ENABLE_SYSCLOCKS	0x00000001
 #define SYS_SPECIFIC_DATA_ENABLE_LISR		0x00000002
 #define SYS_SPECIFIC_DATA_ENABLE_MISR		0x00000004
@@ -77,6 +88,7 @@ PVRSRV_ERROR EnableSGXClocks(SYS_DATA *psSysData);
 #define	SYS_SPECIFIC_DATA_PM_UNINSTALL_LISR	0x00000200
 #define	SYS_SPECIFIC_DATA_PM_DISABLE_SYSCLOCKS	0x00000400
 #define SYS_SPECIFIC_DATA_ENABLE_OCPREGS	0x00000800
+#define SYS_SPECIFIC_DATA_ENABLE_PREDICTIVE_POWER	0x00001000
 
 #define	SYS_SPECIFIC_DATA_SET(psSysSpecData, flag) ((IMG_VOID)((psSysSpecData)->ui32SysSpecificData |= (flag)))
 
@@ -96,6 +108,21 @@ typedef struct _SYS_SPECIFIC_DATA_TAG_
 #if defined(__linux__)
 	IMG_BOOL	bSysClocksOneTimeInit;
 	atomic_t	sSGXClocksEnabled;
+#if defined(SUPPORT_SGX_PREDICTIVE_POWER)
+	IMG_UINT32	ui32ActivePowerLatencyms;
+	ktime_t		sSGXPowerOffTime;
+	ktime_t		sSGXPowerOnTime;
+	IMG_BOOL	bSGXPrewarm;
+	struct task_struct	*psSGXPrewarmTask;
+	unsigned long	ulSGXPrewarmJiffies;
+	struct work_struct	sSGXPrewarmWork;
+	IMG_UINT32	ui32SGXPowerUps;
+	IMG_UINT32	ui32SGXPrewarms;
+	IMG_UINT32	ui32SGXEarlyPowerDowns;
+	IMG_UINT32	ui32SGXPowerUpLastus;
+	IMG_UINT32	ui32SGXPowerUpMaxus;
+	IMG_UINT64	ui64SGXPowerUpTotalus;
+#endif
 #if defined(PVR_LINUX_USING_WORKQUEUES)
 	struct mutex	sPowerLock;
 #else
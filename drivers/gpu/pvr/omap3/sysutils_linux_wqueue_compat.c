@@ -30,7 +30,13 @@
 #include <linux/hardirq.h>
 #include <linux/mutex.h>
 #include <linux/platform_device.h>
+#include <linux/sched.h>
 #include <plat/omap-pm.h>
+#if defined(SUPPORT_SGX_PREDICTIVE_POWER)
+#include <linux/input.h>
+#include <linux/slab.h>
+#include <linux/math64.h>
+#endif
 
 #include "sgxdefs.h"
 #include "services_headers.h"
@@ -39,6 +45,9 @@
 #include "sysconfig.h"
 #include "sgxinfokm.h"
 #include "syslocal.h"
+#if defined(SUPPORT_SGX_PREDICTIVE_POWER)
+#include "proc.h"
+#endif
 
 #if !defined(PVR_LINUX_USING_WORKQUEUES)
 #error "PVR_LINUX_USING_WORKQUEUES must be defined"
@@ -146,7 +155,11 @@ IMG_VOID SysGetSGXTimingInformation(SGX_TIMING_INFORMATION *psTimingInfo)
 #else
 	psTimingInfo->bEnableActivePM = IMG_FALSE;
 #endif
+#if defined(SUPPORT_SGX_PREDICTIVE_POWER)
+	psTimingInfo->ui32ActivePowManLatencyms = gpsSysSpecificData->ui32ActivePowerLatencyms;
+#else
 	psTimingInfo->ui32ActivePowManLatencyms = SYS_SGX_ACTIVE_POWER_LATENCY_MS;
+#endif
 }
 
 PVRSRV_ERROR EnableSGXClocks(SYS_DATA *psSysData)
@@ -258,6 +271,277 @@ IMG_VOID DisableSGXClocks(SYS_DATA *psSysData)
 #endif
 }
 
+#if defined(SUPPORT_SGX_PREDICTIVE_POWER)
+static struct proc_dir_entry *gpsSGXPowerProcEntry;
+
+/*
+ * SGX coming back within a frame of going off means it was powered down in
+ * the gap between two frames: hold it on for longer, up to one refresh.
+ * Once it stays off for a few frames, decay back to the base latency.
+ */
+IMG_VOID SysSGXPowerDown(SYS_DATA *psSysData)
+{
+	SYS_SPECIFIC_DATA *psSysSpecData = (SYS_SPECIFIC_DATA *) psSysData->pvSysSpecificData;
+
+	psSysSpecData->sSGXPowerOffTime = ktime_get();
+}
+
+IMG_VOID SysSGXPowerUp(SYS_DATA *psSysData)
+{
+	SYS_SPECIFIC_DATA *psSysSpecData = (SYS_SPECIFIC_DATA *) psSysData->pvSysSpecificData;
+	IMG_UINT32 ui32Latencyms = psSysSpecData->ui32ActivePowerLatencyms;
+	s64 i64OffTimeus;
+
+	psSysSpecData->sSGXPowerOnTime = ktime_get();
+
+	/*
+	 * Called with the power lock held: only the prewarm work's own
+	 * power-up counts as a prewarm, not a kick that got the lock first.
+	 */
+	psSysSpecData->bSGXPrewarm = (psSysSpecData->psSGXPrewarmTask == current);
+	if (psSysSpecData->bSGXPrewarm)
+	{
+		psSysSpecData->ui32SGXPrewarms++;
+		return;
+	}
+
+	i64OffTimeus = ktime_us_delta(psSysSpecData->sSGXPowerOnTime,
+								  psSysSpecData->sSGXPowerOffTime);
+
+	if (i64OffTimeus < SYS_SGX_FRAME_PERIOD_US)
+	{
+		psSysSpecData->ui32SGXEarlyPowerDowns++;
+		ui32Latencyms = min_t(IMG_UINT32, ui32Latencyms * 2,
+							  SYS_SGX_ACTIVE_POWER_LATENCY_MAX_MS);
+	}
+	else if (i64OffTimeus > SYS_SGX_FRAME_PERIOD_US * SYS_SGX_ACTIVE_POWER_DECAY_FRAMES)
+	{
+		ui32Latencyms = max_t(IMG_UINT32, ui32Latencyms / 2,
+							  SYS_SGX_ACTIVE_POWER_LATENCY_MS);
+	}
+
+	psSysSpecData->ui32ActivePowerLatencyms = ui32Latencyms;
+}
+
+IMG_VOID SysSGXPowerUpComplete(IMG_VOID)
+{
+	SYS_SPECIFIC_DATA *psSysSpecData = gpsSysSpecificData;
+	IMG_UINT32 ui32PowerUpus;
+
+	if (psSysSpecData->bSGXPrewarm)
+	{
+		return;
+	}
+
+	ui32PowerUpus = (IMG_UINT32)ktime_us_delta(ktime_get(), psSysSpecData->sSGXPowerOnTime);
+
+	psSysSpecData->ui32SGXPowerUps++;
+	psSysSpecData->ui32SGXPowerUpLastus = ui32PowerUpus;
+	psSysSpecData->ui64SGXPowerUpTotalus += ui32PowerUpus;
+	if (ui32PowerUpus > psSysSpecData->ui32SGXPowerUpMaxus)
+	{
+		psSysSpecData->ui32SGXPowerUpMaxus = ui32PowerUpus;
+	}
+}
+
+static void SGXPrewarmWork(struct work_struct *psWork)
+{
+	SYS_SPECIFIC_DATA *psSysSpecData = container_of(psWork, SYS_SPECIFIC_DATA, sSGXPrewarmWork);
+	PVRSRV_DEVICE_NODE *psDeviceNode = psSysSpecData->psSGXDevNode;
+	SYS_DATA *psSysData;
+	PVRSRV_ERROR eError;
+
+	SysAcquireData(&psSysData);
+
+	if (psSysData->eCurrentPowerState != PVRSRV_SYS_POWER_STATE_D0 ||
+		!SYS_SPECIFIC_DATA_TEST(psSysSpecData, SYS_SPECIFIC_DATA_ENABLE_SYSCLOCKS) ||
+		atomic_read(&psSysSpecData->sSGXClocksEnabled) != 0)
+	{
+		return;
+	}
+
+	/* If no kick follows, active power management turns SGX off again. */
+	psSysSpecData->psSGXPrewarmTask = current;
+	eError = PVRSRVSetDevicePowerStateKM(psDeviceNode->sDevId.ui32DeviceIndex,
+										 PVRSRV_DEV_POWER_STATE_ON,
+										 KERNEL_ID, IMG_FALSE);
+	psSysSpecData->psSGXPrewarmTask = IMG_NULL;
+
+	if (eError != PVRSRV_OK)
+	{
+		PVR_DPF((PVR_DBG_WARNING, "SGXPrewarmWork: Couldn't power SGX on (%d)", eError));
+	}
+}
+
+static void SGXPrewarmInputEvent(struct input_handle *handle,
+								 unsigned int type,
+								 unsigned int code, int value)
+{
+	SYS_SPECIFIC_DATA *psSysSpecData = gpsSysSpecificData;
+
+	if (type != EV_ABS && type != EV_KEY)
+	{
+		return;
+	}
+
+	if (atomic_read(&psSysSpecData->sSGXClocksEnabled) != 0)
+	{
+		return;
+	}
+
+	if (time_before(jiffies, psSysSpecData->ulSGXPrewarmJiffies +
+					msecs_to_jiffies(SYS_SGX_PREWARM_HOLDOFF_MS)))
+	{
+		return;
+	}
+
+	psSysSpecData->ulSGXPrewarmJiffies = jiffies;
+	schedule_work(&psSysSpecData->sSGXPrewarmWork);
+}
+
+static int SGXPrewarmInputConnect(struct input_handler *handler,
+								  struct input_dev *dev,
+								  const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+	{
+		return -ENOMEM;
+	}
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "pvrsrvkm";
+
+	error = input_register_handle(handle);
+	if (error)
+	{
+		goto err_free;
+	}
+
+	error = input_open_device(handle);
+	if (error)
+	{
+		goto err_unregister;
+	}
+
+	return 0;
+
+err_unregister:
+	input_unregister_handle(handle);
+err_free:
+	kfree(handle);
+	return error;
+}
+
+static void SGXPrewarmInputDisconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id gasSGXPrewarmInputIds[] = {
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+				 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+					BIT_MASK(ABS_MT_POSITION_X) },
+	},
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_KEYBIT |
+				 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
+		.absbit = { [BIT_WORD(ABS_X)] = BIT_MASK(ABS_X) },
+	},
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_KEY) },
+	},
+	{ },
+};
+
+static struct input_handler gsSGXPrewarmInputHandler = {
+	.event		= SGXPrewarmInputEvent,
+	.connect	= SGXPrewarmInputConnect,
+	.disconnect	= SGXPrewarmInputDisconnect,
+	.name		= "pvrsrvkm",
+	.id_table	= gasSGXPrewarmInputIds,
+};
+
+static void ProcSeqShowSGXPower(struct seq_file *sfile, void *el)
+{
+	SYS_SPECIFIC_DATA *psSysSpecData = gpsSysSpecificData;
+	IMG_UINT32 ui32PowerUps = psSysSpecData->ui32SGXPowerUps;
+	IMG_UINT64 ui64Avgus = 0;
+
+	PVR_UNREFERENCED_PARAMETER(el);
+
+	if (ui32PowerUps != 0)
+	{
+		ui64Avgus = div_u64(psSysSpecData->ui64SGXPowerUpTotalus, ui32PowerUps);
+	}
+
+	seq_printf(sfile,
+			   "active_latency_ms %u\n"
+			   "power_ups %u\n"
+			   "prewarms %u\n"
+			   "early_power_downs %u\n"
+			   "power_up_last_us %u\n"
+			   "power_up_max_us %u\n"
+			   "power_up_avg_us %llu\n",
+			   psSysSpecData->ui32ActivePowerLatencyms,
+			   ui32PowerUps,
+			   psSysSpecData->ui32SGXPrewarms,
+			   psSysSpecData->ui32SGXEarlyPowerDowns,
+			   psSysSpecData->ui32SGXPowerUpLastus,
+			   psSysSpecData->ui32SGXPowerUpMaxus,
+			   ui64Avgus);
+}
+
+PVRSRV_ERROR SysSGXPredictivePowerInit(SYS_DATA *psSysData)
+{
+	SYS_SPECIFIC_DATA *psSysSpecData = (SYS_SPECIFIC_DATA *) psSysData->pvSysSpecificData;
+	IMG_INT res;
+
+	INIT_WORK(&psSysSpecData->sSGXPrewarmWork, SGXPrewarmWork);
+	/* jiffies starts near wrap, so a zero stamp would hold off prewarm. */
+	psSysSpecData->ulSGXPrewarmJiffies = jiffies -
+		msecs_to_jiffies(SYS_SGX_PREWARM_HOLDOFF_MS);
+
+	res = input_register_handler(&gsSGXPrewarmInputHandler);
+	if (res < 0)
+	{
+		PVR_DPF((PVR_DBG_WARNING, "SysSGXPredictivePowerInit: Couldn't register input handler (%d)", res));
+		return PVRSRV_ERROR_INIT_FAILURE;
+	}
+
+	gpsSGXPowerProcEntry = CreateProcReadEntrySeq("sgx_power", NULL, NULL,
+												  ProcSeqShowSGXPower,
+												  ProcSeq1ElementOff2Element, NULL);
+
+	return PVRSRV_OK;
+}
+
+IMG_VOID SysSGXPredictivePowerDeinit(SYS_DATA *psSysData)
+{
+	SYS_SPECIFIC_DATA *psSysSpecData = (SYS_SPECIFIC_DATA *) psSysData->pvSysSpecificData;
+
+	if (gpsSGXPowerProcEntry)
+	{
+		RemoveProcEntrySeq(gpsSGXPowerProcEntry);
+		gpsSGXPowerProcEntry = IMG_NULL;
+	}
+
+	input_unregister_handler(&gsSGXPrewarmInputHandler);
+	flush_work(&psSysSpecData->sSGXPrewarmWork);
+}
+#endif
+
 PVRSRV_ERROR EnableSystemClocks(SYS_DATA *psSysData)
 {
 	SYS_SPECIFIC_DATA *psSysSpecData = (SYS_SPECIFIC_DATA *) psSysData->pvSysSpecificData;
@@ -282,6 +566,10 @@ PVRSRV_ERROR EnableSystemClocks(SYS_DATA *psSysData)
 
 		atomic_set(&psSysSpecData->sSGXClocksEnabled, 0);
 
+#if defined(SUPPORT_SGX_PREDICTIVE_POWER)
+		psSysSpecData->ui32ActivePowerLatencyms = SYS_SGX_ACTIVE_POWER_LATENCY_MS;
+#endif
+
 		psCLK = clk_get(NULL, SGX_PARENT_CLOCK);
 		if (IS_ERR(psCLK))
 		{
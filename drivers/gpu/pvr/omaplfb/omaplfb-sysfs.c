@@ -17,6 +17,10 @@
 #include <linux/platform_device.h>
 #include <linux/device.h>
 #include <linux/uaccess.h>
+#include <linux/ktime.h>
+#include <linux/wait.h>
+
+#include <plat/display.h>
 
 #include "img_defs.h"
 #include "servicesext.h"
@@ -44,6 +48,39 @@ static ssize_t store_ignore_sync(OMAPLFB_DEVINFO *display_info,
 	return -EINVAL;
 }
 
+static ssize_t show_frame_times(OMAPLFB_DEVINFO *display_info, char *buf)
+{
+	ssize_t l = 0;
+	int i;
+
+	for (i = 0; i < OMAPLFB_FRAME_HIST_BUCKETS - 1; i++)
+		l += snprintf(buf + l, PAGE_SIZE - l, "%2d-%2d ms: %lu\n",
+			i * OMAPLFB_FRAME_HIST_STEP_MS,
+			(i + 1) * OMAPLFB_FRAME_HIST_STEP_MS,
+			display_info->frame_time_hist[i]);
+
+	l += snprintf(buf + l, PAGE_SIZE - l, "%2d+    ms: %lu\n",
+		i * OMAPLFB_FRAME_HIST_STEP_MS,
+		display_info->frame_time_hist[i]);
+
+	return l;
+}
+
+static ssize_t store_frame_times(OMAPLFB_DEVINFO *display_info,
+	const char *buf, size_t count)
+{
+	unsigned long new_value;
+
+	if (strict_strtoul(buf, 10, &new_value) || new_value != 0)
+		return -EINVAL;
+
+	memset(display_info->frame_time_hist, 0,
+		sizeof(display_info->frame_time_hist));
+	display_info->last_frame_time = ktime_set(0, 0);
+
+	return count;
+}
+
 struct omaplfb_attribute {
 	struct attribute attr;
 	ssize_t (*show)(OMAPLFB_DEVINFO *, char *);
@@ -86,11 +123,14 @@ static ssize_t omaplfb_attr_store(struct kobject *kobj, struct attribute *attr,
 
 static OMAPLFB_ATTR(ignore_sync, S_IRUGO|S_IWUSR, show_ignore_sync,
 	store_ignore_sync);
+static OMAPLFB_ATTR(frame_times, S_IRUGO|S_IWUSR, show_frame_times,
+	store_frame_times);
 
 #undef OMAPLFB_ATTR
 
 static struct attribute *omaplfb_sysfs_attrs[] = {
 	&omaplfb_attr_ignore_sync.attr,
+	&omaplfb_attr_frame_times.attr,
 	NULL
 };
 
@@ -54,7 +54,9 @@ typedef struct OMAPLFB_FLIP_ITEM_TAG
 	OMAP_BOOL        bValid;
 	OMAP_BOOL        bFlipped;
 	OMAP_BOOL        bCmdCompleted;
+	OMAP_BOOL        bQueued;	/* handed to DSS, waiting for vsync */
 	IMG_SYS_PHYADDR* sSysAddr;
+	struct omap_dss_commit sCommit;
 
 } OMAPLFB_FLIP_ITEM;
 
@@ -72,8 +74,17 @@ typedef struct PVRPDP_SWAPCHAIN_TAG
 	spinlock_t*                     psSwapChainLock;
 	void*                           pvDevInfo;
 
+	/* Flip items shared with the DSS commit callback */
+	spinlock_t                      sFlipLock;
+	unsigned long                   ulPresentIndex;
+	unsigned long                   ulCommitsPending;
+	wait_queue_head_t               sCommitWait;
+
 } OMAPLFB_SWAPCHAIN;
 
+#define OMAPLFB_FRAME_HIST_BUCKETS	16
+#define OMAPLFB_FRAME_HIST_STEP_MS	4
+
 typedef struct OMAPLFB_FBINFO_TAG
 {
 	unsigned long       ulFBSize;
@@ -110,6 +121,10 @@ typedef struct OMAPLFB_DEVINFO_TAG
 	struct kobject			kobj;
 	OMAP_BOOL			ignore_sync;
 
+	/* Time between frames reaching the screen */
+	ktime_t				last_frame_time;
+	unsigned long			frame_time_hist[OMAPLFB_FRAME_HIST_BUCKETS];
+
 }  OMAPLFB_DEVINFO;
 
 typedef enum _OMAP_ERROR_
@@ -166,6 +181,9 @@ void OMAPLFBPresentSync(OMAPLFB_DEVINFO *psDevInfo,
 OMAP_ERROR OMAPLFBGetLibFuncAddr(char *szFunctionName,
 	PFN_DC_GET_PVRJTABLE *ppfnFuncTable);
 void OMAPLFBFlip(OMAPLFB_SWAPCHAIN *psSwapChain, unsigned long aPhyAddr);
+int OMAPLFBFlipAsync(OMAPLFB_SWAPCHAIN *psSwapChain,
+	OMAPLFB_FLIP_ITEM *psFlipItem);
+void OMAPLFBFlipDone(struct omap_dss_commit *psCommit, int err);
 void omaplfb_create_sysfs(struct omaplfb_device *odev);
 void omaplfb_remove_sysfs(struct omaplfb_device *odev);
 #ifdef LDM_PLATFORM
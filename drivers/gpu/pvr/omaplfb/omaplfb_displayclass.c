@@ -48,6 +48,8 @@
 #include <linux/module.h>
 #include <linux/string.h>
 #include <linux/notifier.h>
+#include <linux/ktime.h>
+#include <linux/wait.h>
 
 #ifdef CONFIG_TILER_OMAP
 #include <mach/tiler.h>
@@ -148,6 +150,89 @@ static PVRSRV_ERROR CloseDCDevice(IMG_HANDLE hDevice)
 	return PVRSRV_OK;
 }
 
+/*
+ * Accounts a frame reaching the screen in the frame time histogram
+ * in: psDevInfo
+ */
+static void OMAPLFBFrameShown(OMAPLFB_DEVINFO *psDevInfo)
+{
+	ktime_t now = ktime_get();
+	unsigned long ulBucket;
+
+	if (psDevInfo->last_frame_time.tv64)
+	{
+		ulBucket = (unsigned long)ktime_to_ms(
+			ktime_sub(now, psDevInfo->last_frame_time)) /
+			OMAPLFB_FRAME_HIST_STEP_MS;
+		if (ulBucket >= OMAPLFB_FRAME_HIST_BUCKETS)
+			ulBucket = OMAPLFB_FRAME_HIST_BUCKETS - 1;
+		psDevInfo->frame_time_hist[ulBucket]++;
+	}
+
+	psDevInfo->last_frame_time = now;
+}
+
+/*
+ * Called by DSS in interrupt context when a flip queued with
+ * OMAPLFBFlipAsync is on screen, or was dropped.
+ * in: psCommit, err
+ */
+void OMAPLFBFlipDone(struct omap_dss_commit *psCommit, int err)
+{
+	OMAPLFB_FLIP_ITEM *psFlipItem =
+		container_of(psCommit, OMAPLFB_FLIP_ITEM, sCommit);
+	OMAPLFB_SWAPCHAIN *psSwapChain = psCommit->data;
+	OMAPLFB_DEVINFO *psDevInfo = (OMAPLFB_DEVINFO *)psSwapChain->pvDevInfo;
+	OMAP_HANDLE hCmdComplete;
+	unsigned long ulFlags;
+
+	if (!err)
+		OMAPLFBFrameShown(psDevInfo);
+
+	spin_lock_irqsave(&psSwapChain->sFlipLock, ulFlags);
+
+	/* Commits finish in order, so this is the oldest flip item */
+	hCmdComplete = psFlipItem->hCmdComplete;
+	psFlipItem->bQueued = OMAP_FALSE;
+	psFlipItem->bCmdCompleted = OMAP_TRUE;
+	psFlipItem->bValid = OMAP_FALSE;
+
+	psSwapChain->ulRemoveIndex++;
+	if (psSwapChain->ulRemoveIndex > psSwapChain->ulBufferCount - 1)
+		psSwapChain->ulRemoveIndex = 0;
+
+	spin_unlock_irqrestore(&psSwapChain->sFlipLock, ulFlags);
+
+	psSwapChain->psPVRJTable->pfnPVRSRVCmdComplete(
+		(IMG_HANDLE)hCmdComplete, IMG_TRUE);
+
+	/* There is room in DSS again, send the next frames */
+	queue_work(psDevInfo->sync_display_wq, &psDevInfo->sync_display_work);
+
+	spin_lock_irqsave(&psSwapChain->sFlipLock, ulFlags);
+	if (--psSwapChain->ulCommitsPending == 0)
+		wake_up(&psSwapChain->sCommitWait);
+	spin_unlock_irqrestore(&psSwapChain->sFlipLock, ulFlags);
+}
+
+/*
+ * Waits for the flips queued in DSS to finish
+ * in: psSwapChain
+ */
+static void WaitForQueuedFlips(OMAPLFB_SWAPCHAIN *psSwapChain)
+{
+	unsigned long ulFlags;
+
+	if (!wait_event_timeout(psSwapChain->sCommitWait,
+		psSwapChain->ulCommitsPending == 0, msecs_to_jiffies(500)))
+		WARNING_PRINTK("Timeout waiting for %lu queued flips",
+			psSwapChain->ulCommitsPending);
+
+	/* Make sure the last callback is done with the swap chain */
+	spin_lock_irqsave(&psSwapChain->sFlipLock, ulFlags);
+	spin_unlock_irqrestore(&psSwapChain->sFlipLock, ulFlags);
+}
+
 /*
  * Flushes the sync queue present in the specified swap chain.
  * in: psSwapChain
@@ -160,7 +245,9 @@ static void FlushInternalSyncQueue(OMAPLFB_SWAPCHAIN *psSwapChain)
 	OMAPLFB_FLIP_ITEM *psFlipItem;
 	unsigned long            ulMaxIndex;
 	unsigned long            i;
-	
+
+	WaitForQueuedFlips(psSwapChain);
+
 	psFlipItem = &psSwapChain->psFlipItems[psSwapChain->ulRemoveIndex];
 	ulMaxIndex = psSwapChain->ulBufferCount - 1;
 
@@ -206,6 +293,7 @@ static void FlushInternalSyncQueue(OMAPLFB_SWAPCHAIN *psSwapChain)
 
 	psSwapChain->ulInsertIndex = 0;
 	psSwapChain->ulRemoveIndex = 0;
+	psSwapChain->ulPresentIndex = 0;
 }
 
 /*
@@ -770,8 +858,12 @@ static PVRSRV_ERROR CreateDCSwapChain(IMG_HANDLE hDevice,
 	psSwapChain->psFlipItems = psFlipItems;
 	psSwapChain->ulInsertIndex = 0;
 	psSwapChain->ulRemoveIndex = 0;
+	psSwapChain->ulPresentIndex = 0;
+	psSwapChain->ulCommitsPending = 0;
 	psSwapChain->psPVRJTable = &psDevInfo->sPVRJTable;
 	psSwapChain->pvDevInfo = (void*)psDevInfo;
+	spin_lock_init(&psSwapChain->sFlipLock);
+	init_waitqueue_head(&psSwapChain->sCommitWait);
 
 	/*
 	 * Init the workqueue (single thread, freezable and real time)
@@ -815,6 +907,7 @@ static PVRSRV_ERROR CreateDCSwapChain(IMG_HANDLE hDevice,
 		psFlipItems[i].bValid = OMAP_FALSE;
 		psFlipItems[i].bFlipped = OMAP_FALSE;
 		psFlipItems[i].bCmdCompleted = OMAP_FALSE;
+		psFlipItems[i].bQueued = OMAP_FALSE;
 	}
 
 	mutex_lock(&psDevInfo->sSwapChainLockMutex);
@@ -1022,7 +1115,9 @@ static PVRSRV_ERROR SwapToDCSystem(IMG_HANDLE hDevice,
 }
 
 /*
- * Handles the synchronization with the display
+ * Handles the synchronization with the display. Frames with a swap
+ * interval of one are queued in DSS and completed by OMAPLFBFlipDone,
+ * the rest are presented here waiting for the display.
  * in: work
  */
 static void OMAPLFBSyncIHandler(struct work_struct *work)
@@ -1032,6 +1127,9 @@ static void OMAPLFBSyncIHandler(struct work_struct *work)
 	OMAPLFB_FLIP_ITEM *psFlipItem;
 	OMAPLFB_SWAPCHAIN *psSwapChain;
 	unsigned long ulMaxIndex;
+	unsigned long ulPending;
+	unsigned long ulFlags;
+	OMAP_BOOL bReady;
 
 	mutex_lock(&psDevInfo->sSwapChainLockMutex);
 
@@ -1039,13 +1137,55 @@ static void OMAPLFBSyncIHandler(struct work_struct *work)
 	if (!psSwapChain || psSwapChain->bFlushCommands)
 		goto ExitUnlock;
 
-	psFlipItem = &psSwapChain->psFlipItems[psSwapChain->ulRemoveIndex];
 	ulMaxIndex = psSwapChain->ulBufferCount - 1;
 
 	/* Iterate through the flip items and flip them if necessary */
-	while (psFlipItem->bValid) {
+	while (1) {
+		psFlipItem =
+			&psSwapChain->psFlipItems[psSwapChain->ulPresentIndex];
+
+		spin_lock_irqsave(&psSwapChain->sFlipLock, ulFlags);
+		bReady = psFlipItem->bValid && !psFlipItem->bQueued;
+		if (bReady && psFlipItem->ulSwapInterval == 1 &&
+			!psFlipItem->bFlipped)
+		{
+			psFlipItem->bQueued = OMAP_TRUE;
+			psSwapChain->ulCommitsPending++;
+		}
+		spin_unlock_irqrestore(&psSwapChain->sFlipLock, ulFlags);
+
+		if (!bReady)
+			break;
+
+		/* Queue the frame for the next vsync, don't wait for it */
+		if (psFlipItem->bQueued) {
+			if (!OMAPLFBFlipAsync(psSwapChain, psFlipItem)) {
+				psSwapChain->ulPresentIndex++;
+				if (psSwapChain->ulPresentIndex > ulMaxIndex)
+					psSwapChain->ulPresentIndex = 0;
+				continue;
+			}
+
+			spin_lock_irqsave(&psSwapChain->sFlipLock, ulFlags);
+			psFlipItem->bQueued = OMAP_FALSE;
+			psSwapChain->ulCommitsPending--;
+			spin_unlock_irqrestore(&psSwapChain->sFlipLock, ulFlags);
+		}
+
+		/*
+		 * A frame presented here must not overtake the queued ones,
+		 * the last OMAPLFBFlipDone will schedule us again
+		 */
+		spin_lock_irqsave(&psSwapChain->sFlipLock, ulFlags);
+		ulPending = psSwapChain->ulCommitsPending;
+		spin_unlock_irqrestore(&psSwapChain->sFlipLock, ulFlags);
+		if (ulPending)
+			break;
+
 		/* Update display */
 		OMAPLFBPresentSync(psDevInfo, psFlipItem);
+		if (!psFlipItem->bFlipped)
+			OMAPLFBFrameShown(psDevInfo);
 
 		psFlipItem->ulSwapInterval--;
 		psFlipItem->bFlipped = OMAP_TRUE;
@@ -1053,12 +1193,15 @@ static void OMAPLFBSyncIHandler(struct work_struct *work)
 		if (psFlipItem->ulSwapInterval == 0) {
 
 			/* Mark the flip item as completed to reuse it */
+			spin_lock_irqsave(&psSwapChain->sFlipLock, ulFlags);
 			psSwapChain->ulRemoveIndex++;
 			if (psSwapChain->ulRemoveIndex > ulMaxIndex)
 				psSwapChain->ulRemoveIndex = 0;
+			psSwapChain->ulPresentIndex = psSwapChain->ulRemoveIndex;
 
 			psFlipItem->bFlipped = OMAP_FALSE;
 			psFlipItem->bValid = OMAP_FALSE;
+			spin_unlock_irqrestore(&psSwapChain->sFlipLock, ulFlags);
 
 			psSwapChain->psPVRJTable->pfnPVRSRVCmdComplete(
 				(IMG_HANDLE)psFlipItem->hCmdComplete,
@@ -1074,9 +1217,6 @@ static void OMAPLFBSyncIHandler(struct work_struct *work)
 				&psDevInfo->sync_display_work);
 			break;
 		}
-
-		psFlipItem =
-			&psSwapChain->psFlipItems[psSwapChain->ulRemoveIndex];
 	}
 
 ExitUnlock:
@@ -1099,6 +1239,8 @@ static IMG_BOOL ProcessFlip(IMG_HANDLE  hCmdCookie,
 #if defined(SYS_USING_INTERRUPTS)
 	OMAPLFB_FLIP_ITEM* psFlipItem;
 	unsigned long ulMaxIndex;
+	unsigned long ulFlags;
+	OMAP_BOOL bQueued = OMAP_FALSE;
 #endif
 
 	if(!hCmdCookie || !pvData)
@@ -1136,6 +1278,11 @@ static IMG_BOOL ProcessFlip(IMG_HANDLE  hCmdCookie,
 		psDevInfo->ignore_sync ||
 		psSwapChain->bFlushCommands == OMAP_TRUE)
 	{
+		/*
+		 * Flips still queued in DSS would be applied over this one,
+		 * let them reach the screen first
+		 */
+		WaitForQueuedFlips(psSwapChain);
 #endif
 		OMAPLFBFlip(psSwapChain,
 			(unsigned long)psBuffer->sSysAddr.uiAddr);
@@ -1148,6 +1295,9 @@ static IMG_BOOL ProcessFlip(IMG_HANDLE  hCmdCookie,
 
 	psFlipItem = &psSwapChain->psFlipItems[psSwapChain->ulInsertIndex];
 
+	/* The DSS commit callback frees flip items behind our back */
+	spin_lock_irqsave(&psSwapChain->sFlipLock, ulFlags);
+
 	if(psFlipItem->bValid == OMAP_FALSE)
 	{
 		/* Mark the flip item as not flipped */
@@ -1168,6 +1318,13 @@ static IMG_BOOL ProcessFlip(IMG_HANDLE  hCmdCookie,
 		if(psSwapChain->ulInsertIndex > ulMaxIndex)
 			psSwapChain->ulInsertIndex = 0;
 
+		bQueued = OMAP_TRUE;
+	}
+
+	spin_unlock_irqrestore(&psSwapChain->sFlipLock, ulFlags);
+
+	if (bQueued)
+	{
 		/* Give work to the workqueue to sync with the display */
 		queue_work(psDevInfo->sync_display_wq, &psDevInfo->sync_display_work);
 
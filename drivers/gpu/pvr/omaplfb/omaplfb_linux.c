@@ -31,6 +31,8 @@
 #include <linux/version.h>
 #include <linux/module.h>
 #include <linux/fb.h>
+#include <linux/ktime.h>
+#include <linux/wait.h>
 #include <asm/io.h>
 
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,32))
@@ -228,6 +230,68 @@ static void OMAPLFBFlipNoLock(OMAPLFB_SWAPCHAIN *psSwapChain,
 	FLIP_TECHNIQUE_FRAMEBUFFER or FLIP_TECHNIQUE_OVERLAY
 #endif
 
+#if defined(FLIP_TECHNIQUE_OVERLAY)
+/*
+ * Queues the flip in DSS to be shown at the next vsync, without waiting
+ * for it. OMAPLFBFlipDone is called once the frame is on screen.
+ * Returns -EBUSY if DSS has no room for another flip.
+ * in: psSwapChain, psFlipItem
+ */
+int OMAPLFBFlipAsync(OMAPLFB_SWAPCHAIN *psSwapChain,
+	OMAPLFB_FLIP_ITEM *psFlipItem)
+{
+	OMAPLFB_DEVINFO *psDevInfo = (OMAPLFB_DEVINFO *)psSwapChain->pvDevInfo;
+	struct fb_info *framebuffer = psDevInfo->psLINFBInfo;
+	struct omapfb_info *ofbi = FB2OFB(framebuffer);
+	struct omapfb2_device *fbdev = ofbi->fbdev;
+	struct omap_dss_commit *psCommit = &psFlipItem->sCommit;
+	struct omap_overlay_manager *manager = NULL;
+	unsigned long fb_offset;
+	int i, r = -EINVAL;
+
+	fb_offset = psFlipItem->sSysAddr->uiAddr -
+		psDevInfo->sSystemBuffer.sSysAddr.uiAddr;
+
+	memset(psCommit, 0, sizeof(*psCommit));
+	psCommit->callback = OMAPLFBFlipDone;
+	psCommit->data = psSwapChain;
+
+	omapfb_lock(fbdev);
+
+	for(i = 0; i < ofbi->num_overlays ; i++)
+	{
+		struct omap_overlay *overlay = ofbi->overlays[i];
+		struct omap_overlay_info *overlay_info;
+
+		/* All the overlays have to change in one commit */
+		if (!overlay->manager ||
+			(manager && overlay->manager != manager))
+			goto out;
+		manager = overlay->manager;
+
+		overlay_info = &psCommit->ovl_info[overlay->id];
+		overlay->get_overlay_info(overlay, overlay_info);
+		overlay_info->paddr = framebuffer->fix.smem_start + fb_offset;
+		overlay_info->vaddr = framebuffer->screen_base + fb_offset;
+		psCommit->ovl_mask |= 1 << overlay->id;
+	}
+
+	if (manager && manager->queue_commit)
+		r = manager->queue_commit(manager, psCommit);
+
+out:
+	omapfb_unlock(fbdev);
+	return r;
+}
+#else
+int OMAPLFBFlipAsync(OMAPLFB_SWAPCHAIN *psSwapChain,
+	OMAPLFB_FLIP_ITEM *psFlipItem)
+{
+	/* Panning goes through fb_set_var, which can't be queued */
+	return -EINVAL;
+}
+#endif
+
 void OMAPLFBFlip(OMAPLFB_SWAPCHAIN *psSwapChain, unsigned long aPhyAddr)
 {
 	OMAPLFB_DEVINFO *psDevInfo = (OMAPLFB_DEVINFO *)psSwapChain->pvDevInfo;
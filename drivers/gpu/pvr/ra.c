@@ -126,9 +126,16 @@ struct _RA_ARENA_
 
 	
 #define FREE_TABLE_LIMIT 32
+#define FREE_TABLE_SL_SHIFT 3
+#define FREE_TABLE_SL_COUNT (1 << FREE_TABLE_SL_SHIFT)
+#define FREE_TABLE_BUCKETS (FREE_TABLE_LIMIT << FREE_TABLE_SL_SHIFT)
 
 	
-	BT *aHeadFree [FREE_TABLE_LIMIT];
+	BT *aHeadFree [FREE_TABLE_BUCKETS];
+
+	
+	IMG_UINT32 ui32FreeFLMask;
+	IMG_UINT32 aui32FreeSLMask [FREE_TABLE_LIMIT];
 
 	
 	BT *pHeadSegment;
@@ -216,6 +223,79 @@ pvr_log2 (IMG_SIZE_T n)
 	return l;
 }
 
+static IMG_UINT32
+pvr_ffs (IMG_UINT32 n)
+{
+	IMG_UINT32 l = 0;
+	PVR_ASSERT (n != 0);
+	while ((n & 1) == 0)
+	{
+		n>>=1;
+		l++;
+	}
+	return l;
+}
+
+/*
+ * Free spans are kept in FREE_TABLE_SL_COUNT lists per power of two, list
+ * (fl, sl) holding spans of 2^fl + sl * 2^(fl - FREE_TABLE_SL_SHIFT) up to
+ * the next list's base size.  A bit is set in ui32FreeFLMask and
+ * aui32FreeSLMask for every non-empty list, so finding the first list
+ * above a given size takes two bit scans whatever the fragmentation.
+ */
+static IMG_UINT32
+_FreeListBucket (IMG_SIZE_T uSize)
+{
+	IMG_UINT32 uFL = pvr_log2 (uSize);
+	IMG_UINT32 uSL = 0;
+
+	if (uFL >= FREE_TABLE_SL_SHIFT)
+		uSL = (IMG_UINT32)(uSize >> (uFL - FREE_TABLE_SL_SHIFT)) & (FREE_TABLE_SL_COUNT - 1);
+
+	return (uFL << FREE_TABLE_SL_SHIFT) | uSL;
+}
+
+static IMG_UINT32
+_FreeListFitBucket (IMG_SIZE_T uSize)
+{
+	IMG_UINT32 uFL = pvr_log2 (uSize);
+	IMG_SIZE_T uRound;
+
+	
+	uRound = ((IMG_SIZE_T)1 << ((uFL < FREE_TABLE_SL_SHIFT) ? uFL : uFL - FREE_TABLE_SL_SHIFT)) - 1;
+	if (uSize + uRound < uSize)
+		return FREE_TABLE_BUCKETS;
+
+	return _FreeListBucket (uSize + uRound);
+}
+
+static IMG_UINT32
+_FreeListFindBucket (RA_ARENA *pArena, IMG_UINT32 uBucket)
+{
+	IMG_UINT32 uFL = uBucket >> FREE_TABLE_SL_SHIFT;
+	IMG_UINT32 uSL = uBucket & (FREE_TABLE_SL_COUNT - 1);
+	IMG_UINT32 uMask;
+
+	if (uFL >= FREE_TABLE_LIMIT)
+		return FREE_TABLE_BUCKETS;
+
+	uMask = pArena->aui32FreeSLMask[uFL] & (~0U << uSL);
+	if (uMask == 0)
+	{
+		if (uFL + 1 >= FREE_TABLE_LIMIT)
+			return FREE_TABLE_BUCKETS;
+
+		uMask = pArena->ui32FreeFLMask & (~0U << (uFL + 1));
+		if (uMask == 0)
+			return FREE_TABLE_BUCKETS;
+
+		uFL = pvr_ffs (uMask);
+		uMask = pArena->aui32FreeSLMask[uFL];
+	}
+
+	return (uFL << FREE_TABLE_SL_SHIFT) | pvr_ffs (uMask);
+}
+
 static PVRSRV_ERROR
 _SegmentListInsertAfter (RA_ARENA *pArena,
 						 BT *pInsertionPoint,
@@ -264,6 +344,11 @@ _SegmentListInsert (RA_ARENA *pArena, BT *pBT)
 			pArena->pHeadSegment = pBT;
 			pBT->pPrevSegment = IMG_NULL;
 		}
+		else if (pBT->base >= pArena->pTailSegment->base)
+		{
+			
+			eError = _SegmentListInsertAfter (pArena, pArena->pTailSegment, pBT);
+		}
 		else
 		{
 
@@ -367,26 +452,39 @@ static IMG_VOID
 _FreeListInsert (RA_ARENA *pArena, BT *pBT)
 {
 	IMG_UINT32 uIndex;
-	uIndex = pvr_log2 (pBT->uSize);
+	IMG_UINT32 uFL;
+	uIndex = _FreeListBucket (pBT->uSize);
+	uFL = uIndex >> FREE_TABLE_SL_SHIFT;
 	pBT->type = btt_free;
 	pBT->pNextFree = pArena->aHeadFree [uIndex];
 	pBT->pPrevFree = IMG_NULL;
 	if (pArena->aHeadFree[uIndex] != IMG_NULL)
 		pArena->aHeadFree[uIndex]->pPrevFree = pBT;
 	pArena->aHeadFree [uIndex] = pBT;
+	pArena->aui32FreeSLMask[uFL] |= 1U << (uIndex & (FREE_TABLE_SL_COUNT - 1));
+	pArena->ui32FreeFLMask |= 1U << uFL;
 }
 
 static IMG_VOID
 _FreeListRemove (RA_ARENA *pArena, BT *pBT)
 {
 	IMG_UINT32 uIndex;
-	uIndex = pvr_log2 (pBT->uSize);
+	IMG_UINT32 uFL;
+	uIndex = _FreeListBucket (pBT->uSize);
+	uFL = uIndex >> FREE_TABLE_SL_SHIFT;
 	if (pBT->pNextFree != IMG_NULL)
 		pBT->pNextFree->pPrevFree = pBT->pPrevFree;
 	if (pBT->pPrevFree == IMG_NULL)
 		pArena->aHeadFree[uIndex] = pBT->pNextFree;
 	else
 		pBT->pPrevFree->pNextFree = pBT->pNextFree;
+
+	if (pArena->aHeadFree[uIndex] == IMG_NULL)
+	{
+		pArena->aui32FreeSLMask[uFL] &= ~(1U << (uIndex & (FREE_TABLE_SL_COUNT - 1)));
+		if (pArena->aui32FreeSLMask[uFL] == 0)
+			pArena->ui32FreeFLMask &= ~(1U << uFL);
+	}
 }
 
 static BT *
@@ -680,6 +778,55 @@ _FreeBT (RA_ARENA *pArena, BT *pBT, IMG_BOOL bFreeBackingStore)
 }
 
 
+static BT *
+_FreeListScan (RA_ARENA *pArena,
+			   IMG_UINT32 uBucket,
+			   IMG_UINT32 uEndBucket,
+			   IMG_SIZE_T uSize,
+			   IMG_UINT32 uFlags,
+			   IMG_UINT32 uAlignment,
+			   IMG_UINT32 uAlignmentOffset,
+			   IMG_UINTPTR_T *pAlignedBase)
+{
+	for (uBucket = _FreeListFindBucket (pArena, uBucket);
+		 uBucket < uEndBucket;
+		 uBucket = _FreeListFindBucket (pArena, uBucket + 1))
+	{
+		BT *pBT;
+
+		for (pBT = pArena->aHeadFree[uBucket]; pBT != IMG_NULL; pBT = pBT->pNextFree)
+		{
+			IMG_UINTPTR_T aligned_base;
+
+			if (uAlignment>1)
+				aligned_base = (pBT->base + uAlignmentOffset + uAlignment - 1) / uAlignment * uAlignment - uAlignmentOffset;
+			else
+				aligned_base = pBT->base;
+			PVR_DPF ((PVR_DBG_MESSAGE,
+					  "RA_AttemptAllocAligned: pBT-base=0x%x "
+					  "pBT-size=0x%x alignedbase=0x%x size=0x%x",
+					pBT->base, pBT->uSize, aligned_base, uSize));
+
+			if (pBT->base + pBT->uSize >= aligned_base + uSize)
+			{
+				if(!pBT->psMapping || pBT->psMapping->ui32Flags == uFlags)
+				{
+					*pAlignedBase = aligned_base;
+					return pBT;
+				}
+				else
+				{
+					PVR_DPF ((PVR_DBG_MESSAGE,
+							"AttemptAllocAligned: mismatch in flags. Import has %x, request was %x", pBT->psMapping->ui32Flags, uFlags));
+				}
+			}
+		}
+	}
+
+	return IMG_NULL;
+}
+
+
 static IMG_BOOL
 _AttemptAllocAligned (RA_ARENA *pArena,
 					  IMG_SIZE_T uSize,
@@ -689,7 +836,10 @@ _AttemptAllocAligned (RA_ARENA *pArena,
 					  IMG_UINT32 uAlignmentOffset,
 					  IMG_UINTPTR_T *base)
 {
-	IMG_UINT32 uIndex;
+	IMG_UINT32 uFitBucket;
+	IMG_UINTPTR_T aligned_base;
+	BT *pBT;
+
 	PVR_ASSERT (pArena!=IMG_NULL);
 	if (pArena == IMG_NULL)
 	{
@@ -700,142 +850,108 @@ _AttemptAllocAligned (RA_ARENA *pArena,
 	if (uAlignment>1)
 		uAlignmentOffset %= uAlignment;
 
-	
+	/*
+	 * Every span from uFitBucket up is at least uSize long, so unless it is
+	 * misaligned or has the wrong flags the first one found is taken.  Only
+	 * when none of those will do are the lists that hold spans of mixed
+	 * sizes around uSize searched.
+	 */
+	uFitBucket = _FreeListFitBucket (uSize);
 
-	uIndex = pvr_log2 (uSize);
+	pBT = _FreeListScan (pArena, uFitBucket, FREE_TABLE_BUCKETS, uSize, uFlags,
+						 uAlignment, uAlignmentOffset, &aligned_base);
+	if (pBT == IMG_NULL)
+	{
+		pBT = _FreeListScan (pArena, _FreeListBucket (uSize), uFitBucket, uSize, uFlags,
+							 uAlignment, uAlignmentOffset, &aligned_base);
+		if (pBT == IMG_NULL)
+		{
+			return IMG_FALSE;
+		}
+	}
 
-#if 0
-	
-	if (1u<<uIndex < uSize)
-		uIndex++;
-#endif
+	_FreeListRemove (pArena, pBT);
+
+	PVR_ASSERT (pBT->type == btt_free);
 
-	while (uIndex < FREE_TABLE_LIMIT && pArena->aHeadFree[uIndex]==IMG_NULL)
-		uIndex++;
+#ifdef RA_STATS
+	pArena->sStatistics.uLiveSegmentCount++;
+	pArena->sStatistics.uFreeSegmentCount--;
+	pArena->sStatistics.uFreeResourceCount-=pBT->uSize;
+#endif
 
-	while (uIndex < FREE_TABLE_LIMIT)
+	
+	if (aligned_base > pBT->base)
 	{
-		if (pArena->aHeadFree[uIndex]!=IMG_NULL)
+		BT *pNeighbour;
+		pNeighbour = _SegmentSplit (pArena, pBT, (IMG_SIZE_T)(aligned_base - pBT->base));
+		
+		if (pNeighbour==IMG_NULL)
 		{
+			PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned: Front split failed"));
 			
-			BT *pBT;
-
-			pBT = pArena->aHeadFree [uIndex];
-			while (pBT!=IMG_NULL)
-			{
-				IMG_UINTPTR_T aligned_base;
-
-				if (uAlignment>1)
-					aligned_base = (pBT->base + uAlignmentOffset + uAlignment - 1) / uAlignment * uAlignment - uAlignmentOffset;
-				else
-					aligned_base = pBT->base;
-				PVR_DPF ((PVR_DBG_MESSAGE,
-						  "RA_AttemptAllocAligned: pBT-base=0x%x "
-						  "pBT-size=0x%x alignedbase=0x%x size=0x%x",
-						pBT->base, pBT->uSize, aligned_base, uSize));
+			_FreeListInsert (pArena, pBT);
+			return IMG_FALSE;
+		}
 
-				if (pBT->base + pBT->uSize >= aligned_base + uSize)
-				{
-					if(!pBT->psMapping || pBT->psMapping->ui32Flags == uFlags)
-					{
-						_FreeListRemove (pArena, pBT);
+		_FreeListInsert (pArena, pBT);
+#ifdef RA_STATS
+		pArena->sStatistics.uFreeSegmentCount++;
+		pArena->sStatistics.uFreeResourceCount+=pBT->uSize;
+#endif
+		pBT = pNeighbour;
+	}
 
-						PVR_ASSERT (pBT->type == btt_free);
+	
+	if (pBT->uSize > uSize)
+	{
+		BT *pNeighbour;
+		pNeighbour = _SegmentSplit (pArena, pBT, uSize);
+		
+		if (pNeighbour==IMG_NULL)
+		{
+			PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned: Back split failed"));
+			
+			_FreeListInsert (pArena, pBT);
+			return IMG_FALSE;
+		}
 
+		_FreeListInsert (pArena, pNeighbour);
 #ifdef RA_STATS
-						pArena->sStatistics.uLiveSegmentCount++;
-						pArena->sStatistics.uFreeSegmentCount--;
-						pArena->sStatistics.uFreeResourceCount-=pBT->uSize;
+		pArena->sStatistics.uFreeSegmentCount++;
+		pArena->sStatistics.uFreeResourceCount+=pNeighbour->uSize;
 #endif
+	}
 
-						
-						if (aligned_base > pBT->base)
-						{
-							BT *pNeighbour;
-							pNeighbour = _SegmentSplit (pArena, pBT, (IMG_SIZE_T)(aligned_base - pBT->base));
-							
-							if (pNeighbour==IMG_NULL)
-							{
-								PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned: Front split failed"));
-								
-								_FreeListInsert (pArena, pBT);
-								return IMG_FALSE;
-							}
-
-							_FreeListInsert (pArena, pBT);
-	#ifdef RA_STATS
-							pArena->sStatistics.uFreeSegmentCount++;
-							pArena->sStatistics.uFreeResourceCount+=pBT->uSize;
-	#endif
-							pBT = pNeighbour;
-						}
-
-						
-						if (pBT->uSize > uSize)
-						{
-							BT *pNeighbour;
-							pNeighbour = _SegmentSplit (pArena, pBT, uSize);
-							
-							if (pNeighbour==IMG_NULL)
-							{
-								PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned: Back split failed"));
-								
-								_FreeListInsert (pArena, pBT);
-								return IMG_FALSE;
-							}
-
-							_FreeListInsert (pArena, pNeighbour);
-	#ifdef RA_STATS
-							pArena->sStatistics.uFreeSegmentCount++;
-							pArena->sStatistics.uFreeResourceCount+=pNeighbour->uSize;
-	#endif
-						}
-
-						pBT->type = btt_live;
+	pBT->type = btt_live;
 
 #if defined(VALIDATE_ARENA_TEST)
-						if (pBT->eResourceType == IMPORTED_RESOURCE_TYPE)
-						{
-							pBT->eResourceSpan = IMPORTED_RESOURCE_SPAN_LIVE;
-						}
-						else if (pBT->eResourceType == NON_IMPORTED_RESOURCE_TYPE)
-						{
-							pBT->eResourceSpan = RESOURCE_SPAN_LIVE;
-						}
-						else
-						{
-							PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned ERROR: pBT->eResourceType unrecognized"));
-							PVR_DBG_BREAK;
-						}
+	if (pBT->eResourceType == IMPORTED_RESOURCE_TYPE)
+	{
+		pBT->eResourceSpan = IMPORTED_RESOURCE_SPAN_LIVE;
+	}
+	else if (pBT->eResourceType == NON_IMPORTED_RESOURCE_TYPE)
+	{
+		pBT->eResourceSpan = RESOURCE_SPAN_LIVE;
+	}
+	else
+	{
+		PVR_DPF ((PVR_DBG_ERROR,"_AttemptAllocAligned ERROR: pBT->eResourceType unrecognized"));
+		PVR_DBG_BREAK;
+	}
 #endif
-						if (!HASH_Insert (pArena->pSegmentHash, pBT->base, (IMG_UINTPTR_T) pBT))
-						{
-							_FreeBT (pArena, pBT, IMG_FALSE);
-							return IMG_FALSE;
-						}
-
-						if (ppsMapping!=IMG_NULL)
-							*ppsMapping = pBT->psMapping;
-
-						*base = pBT->base;
-
-						return IMG_TRUE;
-					}
-					else
-					{
-						PVR_DPF ((PVR_DBG_MESSAGE,
-								"AttemptAllocAligned: mismatch in flags. Import has %x, request was %x", pBT->psMapping->ui32Flags, uFlags));
+	if (!HASH_Insert (pArena->pSegmentHash, pBT->base, (IMG_UINTPTR_T) pBT))
+	{
+		_FreeBT (pArena, pBT, IMG_FALSE);
+		return IMG_FALSE;
+	}
 
-					}
-				}
-				pBT = pBT->pNextFree;
-			}
+	if (ppsMapping!=IMG_NULL)
+		*ppsMapping = pBT->psMapping;
 
-		}
-		uIndex++;
-	}
+	*base = pBT->base;
 
-	return IMG_FALSE;
+	return IMG_TRUE;
 }
 
 
@@ -874,8 +990,11 @@ RA_Create (IMG_CHAR *name,
 	pArena->pImportFree = imp_free;
 	pArena->pBackingStoreFree = backingstore_free;
 	pArena->pImportHandle = pImportHandle;
-	for (i=0; i<FREE_TABLE_LIMIT; i++)
+	for (i=0; i<FREE_TABLE_BUCKETS; i++)
 		pArena->aHeadFree[i] = IMG_NULL;
+	for (i=0; i<FREE_TABLE_LIMIT; i++)
+		pArena->aui32FreeSLMask[i] = 0;
+	pArena->ui32FreeFLMask = 0;
 	pArena->pHeadSegment = IMG_NULL;
 	pArena->pTailSegment = IMG_NULL;
 	pArena->uQuantum = uQuantum;
@@ -980,8 +1099,11 @@ RA_Delete (RA_ARENA *pArena)
 	PVR_DPF ((PVR_DBG_MESSAGE,
 			  "RA_Delete: name='%s'", pArena->name));
 
-	for (uIndex=0; uIndex<FREE_TABLE_LIMIT; uIndex++)
+	for (uIndex=0; uIndex<FREE_TABLE_BUCKETS; uIndex++)
 		pArena->aHeadFree[uIndex] = IMG_NULL;
+	for (uIndex=0; uIndex<FREE_TABLE_LIMIT; uIndex++)
+		pArena->aui32FreeSLMask[uIndex] = 0;
+	pArena->ui32FreeFLMask = 0;
 
 	while (pArena->pHeadSegment != IMG_NULL)
 	{
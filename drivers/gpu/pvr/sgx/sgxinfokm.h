@@ -545,6 +545,10 @@ PVRSRV_ERROR SGXDevInitCompatCheck(PVRSRV_DEVICE_NODE *psDeviceNode);
 IMG_VOID SysGetSGXTimingInformation(SGX_TIMING_INFORMATION *psSGXTimingInfo);
 #endif
 
+#if defined(SUPPORT_SGX_PREDICTIVE_POWER)
+IMG_VOID SysSGXPowerUpComplete(IMG_VOID);
+#endif
+
 #if defined(NO_HARDWARE)
 static INLINE IMG_VOID NoHardwareGenerateEvent(PVRSRV_SGXDEV_INFO		*psDevInfo,
 												IMG_UINT32 ui32StatusRegister,
@@ -372,6 +372,10 @@ PVRSRV_ERROR SGXPostPowerState (IMG_HANDLE				hDevHandle,
 				PVR_DPF((PVR_DBG_ERROR,"SGXPostPowerState: SGXInitialise failed"));
 				return eError;
 			}
+
+#if defined(SUPPORT_SGX_PREDICTIVE_POWER)
+			SysSGXPowerUpComplete();
+#endif
 		}
 		else
 		{
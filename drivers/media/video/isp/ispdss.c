@@ -53,6 +53,8 @@ static struct {
 	struct completion compl_isr;
 	struct videobuf_queue_ops vbq_ops;
 	ispdss_callback 	callback;
+	void *callback_arg;
+	int async;
 	u32 in_buf_virt_addr[32];
 	u32 out_buf_virt_addr[32];
 	u32 num_video_buffers;
@@ -77,6 +79,9 @@ static void ispdss_isr(unsigned long status, isp_vbq_callback_ptr arg1,
 		return;
 
 	complete(&(dev_ctx.compl_isr));
+
+	if (dev_ctx.async && dev_ctx.callback)
+		dev_ctx.callback(dev_ctx.callback_arg);
 }
 
 static void ispdss_tmp_buf_free(void)
@@ -127,6 +132,33 @@ int ispdss_get_resource(void)
 	return 0;
 }
 
+/**
+ * ispdss_abort - Stop a resize that did not finish in time
+ *
+ * Disables the resizer and waits for it to go idle, so that the next
+ * ispdss_begin() or ispdss_begin_async() starts from a clean state.
+ * No callback is made for the aborted resize.
+ **/
+void ispdss_abort(void)
+{
+	struct isp_device *isp;
+	int timeout = 100;
+
+	if (dev_ctx.opened != 1)
+		return;
+
+	isp = dev_get_drvdata(dev_ctx.isp);
+
+	isp_unset_callback(dev_ctx.isp, CBK_RESZ_DONE);
+	ispresizer_enable(&isp->isp_res, 0);
+	while (ispresizer_busy(&isp->isp_res) && --timeout)
+		udelay(10);
+	if (!timeout)
+		dev_err(dev_ctx.isp, "resizer still busy after abort\n");
+
+	init_completion(&dev_ctx.compl_isr);
+}
+
 /**
  * ispdss_put_resource - Release all the resource.
  **/
@@ -153,6 +185,10 @@ void ispdss_put_resource()
 	}
 	ispdss_tmp_buf_free();
 
+	/* an asynchronous resize leaves the callback installed */
+	isp_unset_callback(dev_ctx.isp, CBK_RESZ_DONE);
+	dev_ctx.async = 0;
+
 	/* make device available */
 	dev_ctx.opened = 0;
 
@@ -194,6 +230,7 @@ int ispdss_configure(struct isp_node *pipe, ispdss_callback callback,
 		return -EINVAL;
 
 	dev_ctx.callback = callback;
+	dev_ctx.callback_arg = arg1;
 	dev_ctx.num_video_buffers = num_video_buffers;
 	dev_ctx.config_state = STATE_CONFIGURED;
 
@@ -227,7 +264,7 @@ extern int flag_720p;
 //Patch for OMAPS00237333
 int shift_var = 0;
 //Patch for OMAPS00237333
-int ispdss_begin(struct isp_node *pipe, u32 input_buffer_index,
+static int ispdss_start(struct isp_node *pipe, u32 input_buffer_index,
 		 int output_buffer_index, u32 out_off, u32 out_phy_add,
 		 u32 in_phy_add, u32 in_off)
 {
@@ -320,6 +357,21 @@ else
 //720 ISP Enable OMAPS00235346
 	ispresizer_enable(isp_res, 1);
 
+	return 0;
+}
+
+int ispdss_begin(struct isp_node *pipe, u32 input_buffer_index,
+		 int output_buffer_index, u32 out_off, u32 out_phy_add,
+		 u32 in_phy_add, u32 in_off)
+{
+	int ret;
+
+	dev_ctx.async = 0;
+	ret = ispdss_start(pipe, input_buffer_index, output_buffer_index,
+			   out_off, out_phy_add, in_phy_add, in_off);
+	if (ret)
+		return ret;
+
 	/* Wait for resizing complete event */
 	if (wait_for_completion_interruptible_timeout(
 				&dev_ctx.compl_isr, msecs_to_jiffies(500)) == 0)
@@ -332,3 +384,22 @@ else
 	return 0;
 }
 
+/**
+ * ispdss_begin_async - Start resizing without waiting for it to finish
+ *
+ * Same as ispdss_begin(), but returns as soon as the resizer has been
+ * started.  The callback given to ispdss_configure() is called from the
+ * ISP interrupt once the output buffer has been written, and only then
+ * may the next resize be started.
+ **/
+int ispdss_begin_async(struct isp_node *pipe, u32 input_buffer_index,
+		 int output_buffer_index, u32 out_off, u32 out_phy_add,
+		 u32 in_phy_add, u32 in_off)
+{
+	if (!dev_ctx.callback)
+		return -EINVAL;
+
+	dev_ctx.async = 1;
+	return ispdss_start(pipe, input_buffer_index, output_buffer_index,
+			    out_off, out_phy_add, in_phy_add, in_off);
+}
@@ -37,8 +37,11 @@
 #include <linux/platform_device.h>
 #include <linux/dma-mapping.h>
 #include <linux/irq.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/videodev2.h>
 #include <linux/slab.h>
+#include <linux/android_pmem.h>
 //Change for OMAPS00241246 
 #include <plat/clockdomain.h>
 //Change for OMAPS00241246 
@@ -148,6 +151,9 @@ static u32 video3_numbuffers = 3;
 static u32 video3_bufsize = OMAP_VOUT_MAX_BUF_SIZE;
 static u32 vid1_static_vrfb_alloc;
 static u32 vid2_static_vrfb_alloc;
+#ifdef CONFIG_OMAP3_ISP_RESIZER
+static u32 isp_rsz_queue_depth;
+#endif
 static int debug;
 
 /* Module parameters */
@@ -182,6 +188,13 @@ module_param(vid2_static_vrfb_alloc, bool, S_IRUGO);
 MODULE_PARM_DESC(vid2_static_vrfb_alloc,
 	"Static allocation of the VRFB buffer for video2 device");
 
+#ifdef CONFIG_OMAP3_ISP_RESIZER
+module_param(isp_rsz_queue_depth, uint, S_IRUGO);
+MODULE_PARM_DESC(isp_rsz_queue_depth,
+	"Frames the ISP resizer may work ahead of the display, 0 to resize "
+	"synchronously in QBUF");
+#endif
+
 module_param(debug, bool, S_IRUGO);
 MODULE_PARM_DESC(debug, "Debug level (0-1)");
 
@@ -321,17 +334,33 @@ static int omap_vout_allocate_vrfb_buffers(struct omap_vout_device *vout,
 }
 #endif
 #ifdef CONFIG_OMAP3_ISP_RESIZER
-/* This function wakes up the application once
- * the DMA transfer to VRFB space is completed by the
- * ISP resizer block
+static bool manually_updated(struct omap_vout_device *vout);
+
+/* Called from the ISP interrupt once a queued resize has finished. The
+ * frame can now be shown, and the next one can go to the resizer.
  */
 void omap_vout_isp_rsz_dma_tx_callback(void *arg)
 {
-	struct omap_vout_device *vout;
-	vout = (struct omap_vout_device *) arg;
+	struct omap_vout_device *vout = (struct omap_vout_device *) arg;
+	struct vid_rsz_queue *rq = &vout->rsz_queue;
+	unsigned long flags;
+	u32 ns;
+
+	spin_lock_irqsave(&rq->lock, flags);
+	if (rq->active >= 0) {
+		ns = ktime_to_ns(ktime_sub(ktime_get(), rq->start));
+		rq->busy_ns += ns;
+		if (ns > rq->max_ns)
+			rq->max_ns = ns;
+		rq->frames++;
+		set_bit(rq->active, &rq->ready);
+		rq->active = -1;
+		if (rq->count)
+			schedule_work(&rq->work);
+	}
+	spin_unlock_irqrestore(&rq->lock, flags);
 
-	vout->vrfb_dma_tx.tx_status = 1;
-	wake_up_interruptible(&vout->vrfb_dma_tx.wait);
+	wake_up(&rq->wait);
 }
 
 static bool need_isp_rsz(struct omap_vout_device *vout) {
@@ -399,7 +428,11 @@ static int init_isp_rsz(struct omap_vout_device *vout)
 		return ret;
 	}
 	vout->rsz_configured = 1;
-	printk(KERN_INFO "<%s> ISP resizer configured\n", __func__);
+	/* manual update displays are only refreshed from QBUF, keep those
+	 * synchronous */
+	vout->rsz_queued = isp_rsz_queue_depth && !manually_updated(vout);
+	printk(KERN_INFO "<%s> ISP resizer configured%s\n", __func__,
+			vout->rsz_queued ? ", queued" : "");
 
 	return ret;
 }
@@ -486,29 +519,36 @@ int omap_vout_try_format(struct v4l2_pix_format *pix)
  * omap_vout_uservirt_to_phys: This inline function is used to convert user
  * space virtual address to physical address.
  */
-static u32 omap_vout_uservirt_to_phys(u32 virtp)
+static u32 omap_vout_uservirt_to_phys(u32 virtp, u32 len)
 {
 	unsigned long physp = 0;
 	struct vm_area_struct *vma;
 	struct mm_struct *mm = current->mm;
 
-	vma = find_vma(mm, virtp);
 	/* For kernel direct-mapped memory, take the easy way */
-	if (virtp >= PAGE_OFFSET) {
-		physp = virt_to_phys((void *) virtp);
+	if (virtp >= PAGE_OFFSET)
+		return virt_to_phys((void *) virtp);
+
+	down_read(&mm->mmap_sem);
+	vma = find_vma(mm, virtp);
+	/* pmem buffers shared with the camera or the DSP are imported as is,
+	 * after checking the whole frame lies in the allocation.  like the
+	 * other user pointers here, the frame is only used until DQBUF */
+	if (!get_pmem_user_phys(vma, virtp, len, &physp, NULL)) {
+		up_read(&mm->mmap_sem);
 	} else if (vma && (vma->vm_flags & VM_IO) && vma->vm_pgoff) {
 		/* this will catch, kernel-allocated, mmaped-to-usermode
 		   addresses */
 		physp = (vma->vm_pgoff << PAGE_SHIFT) + (virtp - vma->vm_start);
+		up_read(&mm->mmap_sem);
 	} else {
 		/* otherwise, use get_user_pages() for general userland pages */
 		int res, nr_pages = 1;
 		struct page *pages;
-		down_read(&current->mm->mmap_sem);
 
-		res = get_user_pages(current, current->mm, virtp, nr_pages, 1,
+		res = get_user_pages(current, mm, virtp, nr_pages, 1,
 				0, &pages, NULL);
-		up_read(&current->mm->mmap_sem);
+		up_read(&mm->mmap_sem);
 
 		if (res == nr_pages) {
 			physp =  __pa(page_address(&pages[0]) +
@@ -534,14 +574,52 @@ static void omap_vout_vrfb_dma_tx_callback(int lch, u16 ch_status, void *data)
 }
 
 /*
- * Release the VRFB context once the module exits
+ * VRFB contexts come from a pool shared with omapfb.  Unless the VRFB
+ * buffers are allocated at init time, they are only held while the
+ * buffers are set up.
  */
-static void omap_vout_release_vrfb(struct omap_vout_device *vout)
+static void omap_vout_put_vrfb_ctx(struct omap_vout_device *vout)
 {
 	int i;
 
 	for (i = 0; i < VRFB_NUM_BUFS; i++)
 		omap_vrfb_release_ctx(&vout->vrfb_context[i]);
+}
+
+static int omap_vout_get_vrfb_ctx(struct omap_vout_device *vout,
+		unsigned int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (vout->vrfb_context[i].context != 0xff)
+			continue;
+		if (omap_vrfb_request_ctx(&vout->vrfb_context[i])) {
+			omap_vout_put_vrfb_ctx(vout);
+			return -EBUSY;
+		}
+	}
+	return 0;
+}
+
+static void omap_vout_vrfb_account(struct omap_vout_device *vout, u32 ns)
+{
+	struct vid_vrfb_stats *st = &vout->vrfb_stats;
+
+	if (!st->copies || ns < st->min_ns)
+		st->min_ns = ns;
+	if (ns > st->max_ns)
+		st->max_ns = ns;
+	st->total_ns += ns;
+	st->copies++;
+}
+
+/*
+ * Release the VRFB context once the module exits
+ */
+static void omap_vout_release_vrfb(struct omap_vout_device *vout)
+{
+	omap_vout_put_vrfb_ctx(vout);
 
 	if (vout->vrfb_dma_tx.req_status == DMA_CHAN_ALLOTED) {
 		vout->vrfb_dma_tx.req_status = DMA_CHAN_NOT_ALLOTED;
@@ -599,6 +677,145 @@ static inline int calc_rotation(const struct omap_vout_device *vout)
 	return dss_rotation_180_degree;
 }
 
+#ifndef CONFIG_ARCH_OMAP4
+/*
+ * Return true if the application renders straight into the VRFB
+ * view, so that no frame has to be copied by the DMA
+ */
+static inline bool omap_vout_vrfb_direct(const struct omap_vout_device *vout)
+{
+	return vout->vrfb_direct && rotation_enabled(vout) &&
+		vout->memory == V4L2_MEMORY_MMAP;
+}
+
+static inline u32 omap_vout_vrfb_stride(const struct omap_vout_device *vout)
+{
+	return MAX_PIXELS_PER_LINE * vout->bpp * vout->vrfb_bpp;
+}
+
+/* VRFB view the frames are written into */
+static inline unsigned long omap_vout_vrfb_input(
+		const struct omap_vout_device *vout, int i)
+{
+#ifdef NO_VRFB_ROT_PATCH
+	return vout->vrfb_context[i].paddr[0];
+#else
+	return vout->vrfb_context[i].paddr[calc_rotation(vout)];
+#endif
+}
+#endif
+
+#ifdef CONFIG_OMAP3_ISP_RESIZER
+/* Start the oldest queued frame if the resizer is idle */
+static void omap_vout_rsz_kick(struct omap_vout_device *vout)
+{
+	struct vid_rsz_queue *rq = &vout->rsz_queue;
+	unsigned long flags;
+	int i, ret;
+
+	spin_lock_irqsave(&rq->lock, flags);
+	if (rq->active >= 0 || !rq->count) {
+		spin_unlock_irqrestore(&rq->lock, flags);
+		return;
+	}
+	i = rq->ring[rq->head];
+	rq->head = (rq->head + 1) % VIDEO_MAX_FRAME;
+	rq->count--;
+	rq->active = i;
+	rq->start = ktime_get();
+	spin_unlock_irqrestore(&rq->lock, flags);
+
+	ret = ispdss_begin_async(&pipe, i, i,
+			MAX_PIXELS_PER_LINE * vout->bpp * vout->vrfb_bpp,
+			omap_vout_vrfb_input(vout, i),
+			vout->buf_phy_addr[i], vout->buffer_size);
+	if (!ret)
+		return;
+
+	printk(KERN_ERR "<%s> ISP Resizer Failed to resize "
+			"the buffer = %d\n", __func__, ret);
+
+	/* show the stale VRFB contents rather than stall the display */
+	spin_lock_irqsave(&rq->lock, flags);
+	rq->errors++;
+	set_bit(i, &rq->ready);
+	rq->active = -1;
+	if (rq->count)
+		schedule_work(&rq->work);
+	spin_unlock_irqrestore(&rq->lock, flags);
+	wake_up(&rq->wait);
+}
+
+static void omap_vout_rsz_work(struct work_struct *work)
+{
+	struct vid_rsz_queue *rq = container_of(work, typeof(*rq), work);
+
+	omap_vout_rsz_kick(container_of(rq, struct omap_vout_device,
+				rsz_queue));
+}
+
+static inline int omap_vout_rsz_in_flight(struct vid_rsz_queue *rq)
+{
+	return rq->count + (rq->active >= 0);
+}
+
+/* Queue a frame for the resizer, waiting while it is too far ahead */
+static int omap_vout_rsz_queue(struct omap_vout_device *vout, int i)
+{
+	struct vid_rsz_queue *rq = &vout->rsz_queue;
+	int depth = clamp_t(int, isp_rsz_queue_depth, 1, VRFB_NUM_BUFS - 1);
+	unsigned long flags;
+	long ret;
+
+	ret = wait_event_interruptible_timeout(rq->wait,
+			omap_vout_rsz_in_flight(rq) < depth,
+			msecs_to_jiffies(500));
+	if (ret < 0)
+		return ret;
+
+	/* the resizer did not finish in time, stop it before it is reused */
+	if (!ret && rq->active >= 0)
+		ispdss_abort();
+
+	spin_lock_irqsave(&rq->lock, flags);
+	if (!ret && rq->active >= 0) {
+		/* give up on that frame */
+		rq->errors++;
+		set_bit(rq->active, &rq->ready);
+		rq->active = -1;
+	}
+	clear_bit(i, &rq->ready);
+	rq->ring[(rq->head + rq->count) % VIDEO_MAX_FRAME] = i;
+	rq->count++;
+	spin_unlock_irqrestore(&rq->lock, flags);
+
+	omap_vout_rsz_kick(vout);
+	return 0;
+}
+
+/* Drop the frames not yet started and wait for, or stop, the one in the
+ * resizer. Nothing is ready any more once the resizer is released. */
+static void omap_vout_rsz_flush(struct omap_vout_device *vout)
+{
+	struct vid_rsz_queue *rq = &vout->rsz_queue;
+	unsigned long flags;
+
+	spin_lock_irqsave(&rq->lock, flags);
+	rq->count = 0;
+	spin_unlock_irqrestore(&rq->lock, flags);
+
+	cancel_work_sync(&rq->work);
+	if (!wait_event_timeout(rq->wait, rq->active < 0,
+				msecs_to_jiffies(500)))
+		ispdss_abort();
+
+	spin_lock_irqsave(&rq->lock, flags);
+	rq->active = -1;
+	rq->ready = 0;
+	spin_unlock_irqrestore(&rq->lock, flags);
+}
+#endif
+
 /*
  * Swap the overlay parameters in case of rotation is 90 or 270
  */
@@ -711,6 +928,12 @@ static int omap_vout_vrfb_buffer_setup(struct omap_vout_device *vout,
 		if (omap_vout_allocate_vrfb_buffers(vout, count, startindex))
 			return -ENOMEM;
 
+	if (omap_vout_get_vrfb_ctx(vout, *count)) {
+		v4l2_err(&vout->vid_dev->v4l2_dev,
+				"no free VRFB contexts for %d buffers\n", *count);
+		return -EBUSY;
+	}
+
 	if (vout->dss_mode == OMAP_DSS_COLOR_YUV2 ||
 			vout->dss_mode == OMAP_DSS_COLOR_UYVY)
 		yuv_mode = true;
@@ -1402,6 +1625,28 @@ static int interlace_display(struct omap_vout_device *vout, u32 irqstatus,
 	return vout->field_id;
 }
 
+/* Returns true if the next frame is still waiting for the ISP resizer,
+ * in which case the current one is shown for another refresh */
+static bool omap_vout_rsz_late(struct omap_vout_device *vout)
+{
+#ifdef CONFIG_OMAP3_ISP_RESIZER
+	struct videobuf_buffer *vb;
+
+	if (!vout->use_isp_rsz_for_downscale || !vout->rsz_queued ||
+			list_empty(&vout->dma_queue))
+		return false;
+
+	vb = list_entry(vout->dma_queue.next, struct videobuf_buffer, queue);
+	if (test_bit(vb->i, &vout->rsz_queue.ready))
+		return false;
+
+	vout->rsz_queue.late++;
+	return true;
+#else
+	return false;
+#endif
+}
+
 static int omapvid_process_frame(struct omap_vout_device *vout)
 {
 	u32 addr, uv_addr;
@@ -1589,6 +1834,8 @@ intlace:
 		/* process frame here for auto update screens */
 		if (process && next_frame(vout))
 			goto vout_isr_err;
+		if (omap_vout_rsz_late(vout))
+			goto vout_isr_err;
 		omapvid_process_frame(vout);
 	}
 
@@ -1642,11 +1889,24 @@ static int omap_vout_buffer_setup(struct videobuf_queue *q, unsigned int *count,
 	if (V4L2_MEMORY_MMAP != vout->memory)
 		return 0;
 
-	/* Now allocated the V4L2 buffers */
-	*size = PAGE_ALIGN(vout->pix.width * vout->pix.height * vout->bpp);
 	startindex = (vout->vid == OMAP_VIDEO1) ?
 		video1_numbuffers : video2_numbuffers;
 
+	/* The VRFB views are mapped instead, no V4L2 buffers needed */
+	if (omap_vout_vrfb_direct(vout)) {
+		*size = PAGE_ALIGN(vout->pix.height *
+				omap_vout_vrfb_stride(vout));
+		for (i = startindex; i < *count; i++) {
+			vout->buf_virt_addr[i] = 0;
+			vout->buf_phy_addr[i] = 0;
+		}
+		vout->buffer_allocated = *count;
+		return 0;
+	}
+
+	/* Now allocated the V4L2 buffers */
+	*size = PAGE_ALIGN(vout->pix.width * vout->pix.height * vout->bpp);
+
 	for (i = startindex; i < *count; i++) {
 		vout->buffer_size = *size;
 
@@ -1736,6 +1996,7 @@ static void omap_vout_free_allbuffers(struct omap_vout_device *vout)
 				vout->smsshado_phy_addr[i] = 0;
 			}
 		}
+		omap_vout_put_vrfb_ctx(vout);
 	}
 	vout->buffer_allocated = num_buffers;
 }
@@ -1784,6 +2045,7 @@ static int omap_vout_buffer_prepare(struct videobuf_queue *q,
 	u32 dest_element_index = 0, src_frame_index = 0;
 	u32 elem_count = 0, frame_count = 0, pixsize = 2;
 	struct videobuf_dmabuf *dmabuf = NULL;
+	ktime_t start;
 #else
 	dma_addr_t dmabuf;
 #endif
@@ -1815,7 +2077,8 @@ static int omap_vout_buffer_prepare(struct videobuf_queue *q,
 		dmabuf->vmalloc = (void *) vb->baddr;
 
 		/* Physical address */
-		dmabuf->bus_addr = (dma_addr_t) omap_vout_uservirt_to_phys(vb->baddr);
+		dmabuf->bus_addr = (dma_addr_t) omap_vout_uservirt_to_phys(vb->baddr,
+							  vout->pix.sizeimage);
 	}
 //720 ISP Enable OMAPS00235346
 	rotation = calc_rotation(vout);
@@ -1823,6 +2086,16 @@ static int omap_vout_buffer_prepare(struct videobuf_queue *q,
 	dmabuf = videobuf_to_dma(q->bufs[vb->i]);
 
 #ifdef CONFIG_OMAP3_ISP_RESIZER
+	if (vout->use_isp_rsz_for_downscale && vout->rsz_queued) {
+#ifdef NO_VRFB_ROT_PATCH
+		vout->queued_buf_addr[vb->i] = (u8 *)
+			vout->vrfb_context[vb->i].paddr[rotation];
+#else
+		vout->queued_buf_addr[vb->i] = (u8 *)
+			vout->vrfb_context[vb->i].paddr[0];
+#endif
+		return omap_vout_rsz_queue(vout, vb->i);
+	}
 	if (vout->use_isp_rsz_for_downscale) {
 		int ret = 0;
 		/*Start resizing*/
@@ -1867,6 +2140,12 @@ static int omap_vout_buffer_prepare(struct videobuf_queue *q,
 		return 0;
 	}
 
+	/* The frame is already in the VRFB view */
+	if (omap_vout_vrfb_direct(vout)) {
+		vout->vrfb_stats.direct++;
+		goto vrfb_ready;
+	}
+
 	/* If rotation is enabled, copy input buffer into VRFB
 	 * memory space using DMA. We are copying input buffer
 	 * into VRFB memory space of desired angle and DSS will
@@ -1939,14 +2218,19 @@ static int omap_vout_buffer_prepare(struct videobuf_queue *q,
 	}
 #endif
 
+	start = ktime_get();
 	omap_start_dma(tx->dma_ch);
 	interruptible_sleep_on_timeout(&tx->wait, VRFB_TX_TIMEOUT);
 
 	if (tx->tx_status == 0) {
 		omap_stop_dma(tx->dma_ch);
+		vout->vrfb_stats.timeouts++;
 		return -EINVAL;
 	}
+	omap_vout_vrfb_account(vout,
+			ktime_to_ns(ktime_sub(ktime_get(), start)));
 
+vrfb_ready:
 	/* Store buffers physical address into an array. Addresses
 	 * from this array will be used to configure DSS */
 //Patch for OMAPS00237522
@@ -2085,6 +2369,19 @@ static int omap_vout_mmap(struct file *file, struct vm_area_struct *vma)
 	vma->vm_ops = &omap_vout_vm_ops;
 	vma->vm_private_data = (void *) vout;
 #ifndef CONFIG_ARCH_OMAP4
+	if (omap_vout_vrfb_direct(vout)) {
+		/* buffers requested before switching to direct mode */
+		if (size < vout->pix.height * omap_vout_vrfb_stride(vout))
+			return -EINVAL;
+		vma->vm_flags |= VM_IO;
+		if (io_remap_pfn_range(vma, start,
+				omap_vout_vrfb_input(vout, i) >> PAGE_SHIFT,
+				size, vma->vm_page_prot))
+			return -EAGAIN;
+		vout->mmap_count++;
+		return 0;
+	}
+
 	dmabuf = videobuf_to_dma(q->bufs[i]);
 	pos = (void *)(dmabuf->bus_addr);
 
@@ -2247,8 +2544,10 @@ static int omap_vout_release(struct file *file)
 #ifdef CONFIG_OMAP3_ISP_RESIZER
 	/* Release the ISP resizer resource if not already done so */
 	if (vout->use_isp_rsz_for_downscale && vout->rsz_configured) {
+		omap_vout_rsz_flush(vout);
 		ispdss_put_resource();
 		vout->rsz_configured = 0;
+		vout->rsz_queued = 0;
 		vout->use_isp_rsz_for_downscale = 0;
 		printk(KERN_INFO "<%s> ISP resizer released\n", __func__);
 	}
@@ -2386,6 +2685,13 @@ static int vidioc_g_fmt_vid_out(struct file *file, void *fh,
 	struct omap_vout_device *vout = fh;
 
 	f->fmt.pix = vout->pix;
+#ifndef CONFIG_ARCH_OMAP4
+	if (omap_vout_vrfb_direct(vout)) {
+		f->fmt.pix.bytesperline = omap_vout_vrfb_stride(vout);
+		f->fmt.pix.sizeimage = f->fmt.pix.bytesperline *
+			f->fmt.pix.height;
+	}
+#endif
 	return 0;
 
 }
@@ -2615,7 +2921,7 @@ static int vidioc_s_fmt_vid_overlay(struct file *file, void *fh,
 
 	ret = omap_vout_new_window(&vout->crop, &vout->win, &vout->fbuf, win);
 
-	if (!ret) {
+	if (!ret) {
 		// Fixed issue that camera preview region is incorrect
 		/*Flip the x, y coordinates to back to dss coordinates*/
 		/*if (rotate_90_or_270(vout)) {
@@ -2843,6 +3149,11 @@ static int vidioc_queryctrl(struct file *file, void *fh,
 					   1,
 					   vout->vid_info.overlays[0]->id);
 		break;
+#ifndef CONFIG_ARCH_OMAP4
+	case V4L2_CID_TI_VRFB_DIRECT:
+		ret = v4l2_ctrl_query_fill(ctrl, 0, 1, 1, 0);
+		break;
+#endif
 	default:
 		ctrl->name[0] = '\0';
 		ret = -EINVAL;
@@ -2880,6 +3191,11 @@ static int vidioc_g_ctrl(struct file *file, void *fh, struct v4l2_control *ctrl)
 	case V4L2_CID_TI_DISPC_OVERLAY:
 		ctrl->value = vout->vid_info.overlays[0]->id;
 		return 0;
+#ifndef CONFIG_ARCH_OMAP4
+	case V4L2_CID_TI_VRFB_DIRECT:
+		ctrl->value = vout->vrfb_direct;
+		break;
+#endif
 	default:
 		ret = -EINVAL;
 	}
@@ -2974,6 +3290,17 @@ static int vidioc_s_ctrl(struct file *file, void *fh, struct v4l2_control *a)
 		mutex_unlock(&vout->lock);
 		return 0;
 	}
+#ifndef CONFIG_ARCH_OMAP4
+	case V4L2_CID_TI_VRFB_DIRECT:
+		/* has to be set before the buffers are requested */
+		mutex_lock(&vout->lock);
+		if (vout->streaming || vout->mmap_count)
+			ret = -EBUSY;
+		else
+			vout->vrfb_direct = !!a->value;
+		mutex_unlock(&vout->lock);
+		break;
+#endif
 	default:
 		ret = -EINVAL;
 	}
@@ -3027,7 +3354,8 @@ static int vidioc_reqbufs(struct file *file, void *fh,
 			video1_numbuffers : video2_numbuffers;
 		for (i = num_buffers; i < vout->buffer_allocated; i++) {
 			dmabuf = videobuf_to_dma(q->bufs[i]);
-			omap_vout_free_buffer((u32)dmabuf->vmalloc,
+			if (dmabuf->vmalloc)
+				omap_vout_free_buffer((u32)dmabuf->vmalloc,
 						vout->buffer_size);
 			vout->buf_virt_addr[i] = 0;
 			vout->buf_phy_addr[i] = 0;
@@ -3234,6 +3562,10 @@ static int vidioc_streamon(struct file *file, void *fh, enum v4l2_buf_type i)
 	if (ret)
 		goto streamon_err;
 
+#ifndef CONFIG_ARCH_OMAP4
+	memset(&vout->vrfb_stats, 0, sizeof(vout->vrfb_stats));
+#endif
+
 	if (list_empty(&vout->dma_queue)) {
 		ret = -EIO;
 		goto streamon_err1;
@@ -3248,6 +3580,23 @@ static int vidioc_streamon(struct file *file, void *fh, enum v4l2_buf_type i)
 	/* Get the next frame from the buffer queue */
 	vout->next_frm = vout->cur_frm = list_entry(vout->dma_queue.next,
 			struct videobuf_buffer, queue);
+#ifdef CONFIG_OMAP3_ISP_RESIZER
+	if (vout->use_isp_rsz_for_downscale && vout->rsz_queued) {
+		struct vid_rsz_queue *rq = &vout->rsz_queue;
+		unsigned long flags;
+
+		/* the first frame has to be resized before it is shown */
+		wait_event_timeout(rq->wait,
+				test_bit(vout->cur_frm->i, &rq->ready),
+				msecs_to_jiffies(500));
+
+		spin_lock_irqsave(&rq->lock, flags);
+		rq->frames = rq->late = rq->errors = 0;
+		rq->max_ns = 0;
+		rq->busy_ns = 0;
+		spin_unlock_irqrestore(&rq->lock, flags);
+	}
+#endif
 	/* Remove buffer from the buffer queue */
 	list_del(&vout->cur_frm->queue);
 	/* Mark state of the current frame to active */
@@ -3375,8 +3724,10 @@ static int vidioc_streamoff(struct file *file, void *fh, enum v4l2_buf_type i)
 #ifdef CONFIG_OMAP3_ISP_RESIZER
 	/* release resizer now */
 	if (vout->use_isp_rsz_for_downscale && vout->rsz_configured) {
+		omap_vout_rsz_flush(vout);
 		ispdss_put_resource();
 		vout->rsz_configured = 0;
+		vout->rsz_queued = 0;
 		vout->use_isp_rsz_for_downscale = 0;
 		printk(KERN_INFO "<%s> ISP resizer released\n", __func__);
 	}
@@ -3619,7 +3970,7 @@ static int __init omap_vout_setup_video_bufs(struct platform_device *pdev,
 {
 #ifndef CONFIG_ARCH_OMAP4
 	u32 numbuffers;
-	int ret = 0, i, j;
+	int ret = 0, i;
 	int image_width, image_height;
 #endif
 	struct video_device *vfd;
@@ -3662,14 +4013,20 @@ static int __init omap_vout_setup_video_bufs(struct platform_device *pdev,
 		vout->cropped_offset[i] = 0;
 	}
 
-	for (i = 0; i < VRFB_NUM_BUFS; i++) {
-		if (omap_vrfb_request_ctx(&vout->vrfb_context[i])) {
-			dev_info(&pdev->dev, ": VRFB allocation failed\n");
-			for (j = 0; j < i; j++)
-				omap_vrfb_release_ctx(&vout->vrfb_context[j]);
-			ret = -ENOMEM;
-			goto free_buffers;
-		}
+	/* Allocate VRFB buffers if selected through bootargs */
+	static_vrfb_allocation = (vid_num == 0) ?
+		vid1_static_vrfb_alloc : vid2_static_vrfb_alloc;
+
+	/* Without static allocation the contexts are only taken from the
+	 * pool when the buffers are set up */
+	for (i = 0; i < VRFB_NUM_BUFS; i++)
+		vout->vrfb_context[i].context = 0xff;
+
+	if (static_vrfb_allocation &&
+			omap_vout_get_vrfb_ctx(vout, VRFB_NUM_BUFS)) {
+		dev_info(&pdev->dev, ": VRFB allocation failed\n");
+		ret = -ENOMEM;
+		goto free_buffers;
 	}
 
 	/* Calculate VRFB memory size */
@@ -3703,10 +4060,6 @@ static int __init omap_vout_setup_video_bufs(struct platform_device *pdev,
 	}
 	init_waitqueue_head(&vout->vrfb_dma_tx.wait);
 
-	/* Allocate VRFB buffers if selected through bootargs */
-	static_vrfb_allocation = (vid_num == 0) ?
-		vid1_static_vrfb_alloc : vid2_static_vrfb_alloc;
-
 	/* statically allocated the VRFB buffer is done through
 	   commands line aruments */
 	if (static_vrfb_allocation) {
@@ -3719,8 +4072,7 @@ static int __init omap_vout_setup_video_bufs(struct platform_device *pdev,
 	return 0;
 
 release_vrfb_ctx:
-	for (j = 0; j < VRFB_NUM_BUFS; j++)
-		omap_vrfb_release_ctx(&vout->vrfb_context[j]);
+	omap_vout_put_vrfb_ctx(vout);
 
 free_buffers:
 	for (i = 0; i < numbuffers; i++) {
@@ -3736,6 +4088,44 @@ free_buffers:
 	return 0;
 }
 
+#ifndef CONFIG_ARCH_OMAP4
+static ssize_t omap_vout_vrfb_stats_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct omap_vout_device *vout = dev_get_drvdata(dev);
+	struct vid_vrfb_stats st = vout->vrfb_stats;
+	u32 avg = st.copies ? div_u64(st.total_ns, st.copies) : 0;
+
+	return snprintf(buf, PAGE_SIZE,
+			"direct %u\ncopies %u\ntimeouts %u\n"
+			"copy_us min %u avg %u max %u\n",
+			st.direct, st.copies, st.timeouts,
+			st.min_ns / 1000, avg / 1000, st.max_ns / 1000);
+}
+
+static DEVICE_ATTR(vrfb_stats, S_IRUGO, omap_vout_vrfb_stats_show, NULL);
+#endif
+
+#ifdef CONFIG_OMAP3_ISP_RESIZER
+static ssize_t omap_vout_rsz_stats_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct omap_vout_device *vout = dev_get_drvdata(dev);
+	struct vid_rsz_queue *rq = &vout->rsz_queue;
+	u32 frames = rq->frames;
+	u32 avg = frames ? div_u64(rq->busy_ns, frames) : 0;
+
+	return snprintf(buf, PAGE_SIZE,
+			"queued %d\nframes %u\nlate %u\nerrors %u\n"
+			"busy_us total %llu avg %u max %u\n",
+			vout->rsz_queued, frames, rq->late, rq->errors,
+			div_u64(rq->busy_ns, 1000), avg / 1000,
+			rq->max_ns / 1000);
+}
+
+static DEVICE_ATTR(rsz_stats, S_IRUGO, omap_vout_rsz_stats_show, NULL);
+#endif
+
 /* Create video out devices */
 static int __init omap_vout_create_video_devices(struct platform_device *pdev)
 {
@@ -3771,6 +4161,12 @@ static int __init omap_vout_create_video_devices(struct platform_device *pdev)
 		}
 		vout->vid_info.num_overlays = 1;
 		vout->vid_info.id = k + 1;
+#ifdef CONFIG_OMAP3_ISP_RESIZER
+		spin_lock_init(&vout->rsz_queue.lock);
+		init_waitqueue_head(&vout->rsz_queue.wait);
+		INIT_WORK(&vout->rsz_queue.work, omap_vout_rsz_work);
+		vout->rsz_queue.active = -1;
+#endif
 
 #ifndef CONFIG_FB_OMAP2_FORCE_AUTO_UPDATE
 		vout->workqueue = create_singlethread_workqueue("OMAPVOUT");
@@ -3812,6 +4208,14 @@ static int __init omap_vout_create_video_devices(struct platform_device *pdev)
 			goto error2;
 		}
 		video_set_drvdata(vfd, vout);
+#ifndef CONFIG_ARCH_OMAP4
+		if (device_create_file(&vfd->dev, &dev_attr_vrfb_stats))
+			dev_warn(&pdev->dev, ": failed to create vrfb_stats\n");
+#endif
+#ifdef CONFIG_OMAP3_ISP_RESIZER
+		if (device_create_file(&vfd->dev, &dev_attr_rsz_stats))
+			dev_warn(&pdev->dev, ": failed to create rsz_stats\n");
+#endif
 
 		/* Configure the overlay structure */
 		ret = omapvid_init(vid_dev->vouts[k], 0, 0);
@@ -3864,6 +4268,12 @@ static void omap_vout_cleanup_device(struct omap_vout_device *vout)
 			 * The unregister function will release the video_device
 			 * struct as well as unregistering it.
 			 */
+#ifndef CONFIG_ARCH_OMAP4
+			device_remove_file(&vfd->dev, &dev_attr_vrfb_stats);
+#endif
+#ifdef CONFIG_OMAP3_ISP_RESIZER
+			device_remove_file(&vfd->dev, &dev_attr_rsz_stats);
+#endif
 			video_unregister_device(vfd);
 		}
 	}
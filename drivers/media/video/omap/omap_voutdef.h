@@ -42,6 +42,8 @@
 
 /* TI Private V4L2 ioctls */
 #define V4L2_CID_TI_DISPC_OVERLAY	(V4L2_CID_PRIVATE_BASE + 0)
+/* mmap the VRFB view itself instead of copying each frame into it */
+#define V4L2_CID_TI_VRFB_DIRECT		(V4L2_CID_PRIVATE_BASE + 1)
 
 /* Enum for Rotation
  * DSS understands rotation in 0, 1, 2, 3 context
@@ -65,6 +67,42 @@ struct vid_vrfb_dma {
 	wait_queue_head_t wait;
 };
 
+/* Cost of getting the frames into VRFB, reset at streamon */
+struct vid_vrfb_stats {
+	u32 copies;
+	u32 direct;
+	u32 timeouts;
+	u32 min_ns;
+	u32 max_ns;
+	u64 total_ns;
+};
+
+#ifdef CONFIG_OMAP3_ISP_RESIZER
+/*
+ * Frames handed to the ISP resizer ahead of the display.  The resizer
+ * writes each frame into the VRFB buffer of the same index, so it can
+ * work on frame N+1 while the DSS scans out frame N.
+ */
+struct vid_rsz_queue {
+	spinlock_t lock;
+	wait_queue_head_t wait;
+	struct work_struct work;
+	int ring[VIDEO_MAX_FRAME];
+	int head;
+	int count;
+	int active;		/* buffer in the resizer, -1 if idle */
+	unsigned long ready;	/* buffers whose resize has finished */
+	ktime_t start;
+
+	/* statistics, reset at streamon */
+	u32 frames;
+	u32 late;		/* vsyncs that repeated a frame */
+	u32 errors;
+	u32 max_ns;
+	u64 busy_ns;
+};
+#endif
+
 struct omapvideo_info {
 	int id;
 	int num_overlays;
@@ -107,6 +145,8 @@ struct omap_vout_device {
 #ifdef CONFIG_OMAP3_ISP_RESIZER
 	u32 rsz_configured;
 	u32 use_isp_rsz_for_downscale;
+	bool rsz_queued;
+	struct vid_rsz_queue rsz_queue;
 #endif
 //720 ISP Enable OMAPS00235346
 	/* we don't allow to change image fmt/size once buffer has
@@ -157,6 +197,8 @@ struct omap_vout_device {
 	int vrfb_bpp; /* bytes per pixel with respect to VRFB */
 
 	struct vid_vrfb_dma vrfb_dma_tx;
+	struct vid_vrfb_stats vrfb_stats;
+	bool vrfb_direct;
 //Changes for OMAPS00235683
 	unsigned int smsshado_phy_addr[OMAP_VOUT_MAX_VRFB_CTXT];
 	unsigned int smsshado_virt_addr[OMAP_VOUT_MAX_VRFB_CTXT];
@@ -35,6 +35,9 @@
 #include <linux/videodev2.h>
 #include <linux/version.h>
 #include <linux/syscalls.h>
+#include <linux/vmalloc.h>
+#include <linux/file.h>
+#include <linux/android_pmem.h>
 #include <asm/pgalloc.h>
 
 #include <media/v4l2-common.h>
@@ -253,14 +256,77 @@ static void omap34xxcam_vbq_release(struct videobuf_queue *vbq,
 
 	if (!vbq->streaming) {
 		isp_vbq_release(isp, vbq, vb);
-		omap34xxcam_vb_lock_vma(vb, 0);
+		if (!videobuf_to_dma(vb)->bus_addr)
+			omap34xxcam_vb_lock_vma(vb, 0);
 		videobuf_dma_unmap(vbq, videobuf_to_dma(vb));
 		videobuf_dma_free(videobuf_to_dma(vb));
+		if (ofh->pmem_file[vb->i]) {
+			fput(ofh->pmem_file[vb->i]);
+			ofh->pmem_file[vb->i] = NULL;
+		}
 		vb->state = VIDEOBUF_NEEDS_INIT;
 	}
 	return;
 }
 
+/**
+ * omap34xxcam_vb_import_pmem - Use a pmem user buffer in place
+ * @ofh: camera file handle the buffer is queued on
+ * @vb: ptr to standard V4L2 video buffer structure
+ *
+ * If a USERPTR buffer points into a pmem mapping (e.g. one that is
+ * also queued to omap_vout or mapped by the DSP) there is no need to
+ * pin its pages: the memory is physically contiguous and the reference
+ * held on the pmem file keeps it allocated until the buffer is
+ * released.  Build the scatterlist straight from the physical address,
+ * one entry per page as the ISP MMU expects.  Returns 0 if the buffer
+ * was imported.
+ */
+static int omap34xxcam_vb_import_pmem(struct omap34xxcam_fh *ofh,
+				      struct videobuf_buffer *vb)
+{
+	struct videobuf_dmabuf *dma = videobuf_to_dma(vb);
+	struct vm_area_struct *vma;
+	unsigned long paddr;
+	struct file *file;
+	int i, npages, err;
+
+	if (vb->memory != V4L2_MEMORY_USERPTR || !current || !current->mm)
+		return -EINVAL;
+
+	npages = PAGE_ALIGN(vb->bsize) >> PAGE_SHIFT;
+
+	down_read(&current->mm->mmap_sem);
+	vma = find_vma(current->mm, vb->baddr);
+	err = get_pmem_user_phys(vma, vb->baddr, npages << PAGE_SHIFT,
+				 &paddr, &file);
+	up_read(&current->mm->mmap_sem);
+	if (err)
+		return -EINVAL;
+	if (paddr & ~PAGE_MASK) {
+		fput(file);
+		return -EINVAL;
+	}
+
+	dma->sglist = vmalloc(npages * sizeof(*dma->sglist));
+	if (!dma->sglist) {
+		fput(file);
+		return -ENOMEM;
+	}
+	sg_init_table(dma->sglist, npages);
+	for (i = 0; i < npages; i++) {
+		sg_dma_address(&dma->sglist[i]) = paddr + (i << PAGE_SHIFT);
+		sg_dma_len(&dma->sglist[i]) = PAGE_SIZE;
+	}
+	dma->direction = DMA_FROM_DEVICE;
+	dma->bus_addr = paddr;
+	dma->nr_pages = npages;
+	dma->sglen = npages;
+	ofh->pmem_file[vb->i] = file;
+
+	return 0;
+}
+
 /**
  * omap34xxcam_vbq_prepare - V4L2 video ops buf_prepare handler
  * @vbq: ptr. to standard V4L2 video buffer queue structure
@@ -307,13 +373,15 @@ static int omap34xxcam_vbq_prepare(struct videobuf_queue *vbq,
 	vb->field = field;
 
 	if (vb->state == VIDEOBUF_NEEDS_INIT) {
-		err = omap34xxcam_vb_lock_vma(vb, 1);
-		if (err)
-			goto buf_init_err;
-
-		err = videobuf_iolock(vbq, vb, NULL);
-		if (err)
-			goto buf_init_err;
+		if (omap34xxcam_vb_import_pmem(ofh, vb)) {
+			err = omap34xxcam_vb_lock_vma(vb, 1);
+			if (err)
+				goto buf_init_err;
+
+			err = videobuf_iolock(vbq, vb, NULL);
+			if (err)
+				goto buf_init_err;
+		}
 
 		/* isp_addr will be stored locally inside isp code */
 		err = isp_vbq_prepare(isp, vbq, vb, field);
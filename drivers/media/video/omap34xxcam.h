@@ -177,6 +177,8 @@ struct omap34xxcam_fh {
 	atomic_t field_count;
 	struct omap34xxcam_videodev *vdev;
 	wait_queue_head_t poll_vb;
+	/* pmem files behind imported USERPTR buffers, by buffer index */
+	struct file *pmem_file[VIDEO_MAX_FRAME];
 };
 
 #endif /* ifndef OMAP34XXCAM_H */
@@ -291,7 +291,9 @@ int videobuf_dma_unmap(struct videobuf_queue *q, struct videobuf_dmabuf *dma)
 	if (!dma->sglen)
 		return 0;
 
-	dma_unmap_sg(q->dev, dma->sglist, dma->sglen, dma->direction);
+	/* overlay buffers were never passed to dma_map_sg */
+	if (!dma->bus_addr)
+		dma_unmap_sg(q->dev, dma->sglist, dma->sglen, dma->direction);
 
 	vfree(dma->sglist);
 	dma->sglist = NULL;
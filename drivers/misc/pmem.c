@@ -734,6 +734,61 @@ int get_pmem_addr(struct file *file, unsigned long *start,
 	return 0;
 }
 
+/* returns the physical address behind [vaddr, vaddr + len) if that range
+ * lies in a user mapping of a pmem allocation, so that other drivers can
+ * take a user pointer into pmem as a handle to a contiguous buffer.  the
+ * caller holds the mmap_sem of the mm vma belongs to.  if filp is given,
+ * a reference on the pmem file is returned there which keeps the
+ * allocation alive after the user unmaps it, drop it with fput() once
+ * the device is done with the buffer */
+int get_pmem_user_phys(struct vm_area_struct *vma, unsigned long vaddr,
+		       unsigned long len, unsigned long *paddr,
+		       struct file **filp)
+{
+	struct file *file = vma ? vma->vm_file : NULL;
+	struct pmem_data *data;
+	struct pmem_region_node *region_node;
+	unsigned long offset;
+	int id, ret = -1;
+
+	if (!file || !is_pmem_file(file) || !has_allocation(file))
+		return -1;
+	if (vaddr < vma->vm_start || vaddr + len > vma->vm_end)
+		return -1;
+
+	data = (struct pmem_data *)file->private_data;
+	id = get_id(file);
+	offset = vaddr - vma->vm_start;
+
+	down_read(&data->sem);
+	if (offset + len > pmem_len(id, data))
+		goto end;
+	/* a submap only has the regions that were remapped into it */
+	if (data->flags & PMEM_FLAGS_CONNECTED) {
+		list_for_each_entry(region_node, &data->region_list, list) {
+			if (offset >= region_node->region.offset &&
+			    offset + len <= region_node->region.offset +
+					    region_node->region.len) {
+				ret = 0;
+				break;
+			}
+		}
+	} else {
+		ret = 0;
+	}
+	if (!ret) {
+		*paddr = pmem_start_addr(id, data) + offset;
+		if (filp) {
+			get_file(file);
+			*filp = file;
+		}
+	}
+end:
+	up_read(&data->sem);
+	return ret;
+}
+EXPORT_SYMBOL(get_pmem_user_phys);
+
 int get_pmem_file(int fd, unsigned long *start, unsigned long *vstart,
 		  unsigned long *len, struct file **filp)
 {
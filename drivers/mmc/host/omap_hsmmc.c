@@ -130,6 +130,23 @@ EXPORT_SYMBOL(mmc_is_available);
  * Hence rounding it to a lesser value.
  */
 #define ADMA_MAX_XFER_PER_ROW (63 * 1024)
+
+/*
+ * Number of sDMA logical channels linked in hardware for one run of
+ * sg segments.  Only the last channel of a run raises an interrupt.
+ */
+#define SDMA_MAX_LINKED_LCH	8
+
+/*
+ * Extra channels are only taken while more than SDMA_KEEP_FREE_LCH
+ * would stay free for other drivers, otherwise one channel is used.
+ */
+#define SDMA_KEEP_FREE_LCH	8
+
+static unsigned int sdma_linked_lch = 4;
+module_param(sdma_linked_lch, uint, 0644);
+MODULE_PARM_DESC(sdma_linked_lch, "sDMA channels linked per transfer "
+		 "(1-" __stringify(SDMA_MAX_LINKED_LCH) ")");
 /*
  * FIXME: Most likely all the data using these _DEVID defines should come
  * from the platform_data, or implemented in controller and slot specific
@@ -197,6 +214,12 @@ struct adma_desc_table {
 	dma_addr_t addr;
 };
 
+/* A request whose sg list was mapped by pre_req ahead of time */
+struct omap_hsmmc_next {
+	unsigned int	dma_len;
+	s32		cookie;
+};
+
 struct omap_hsmmc_host {
 	struct	device		*dev;
 	struct	mmc_host	*mmc;
@@ -231,6 +254,9 @@ struct omap_hsmmc_host {
 	int			suspended;
 	int			irq;
 	int			dma_type, dma_ch;
+	int			dma_lch[SDMA_MAX_LINKED_LCH];
+	unsigned int		dma_nr_lch;	/* logical channels held */
+	unsigned int		dma_run;	/* segments in current run */
 	int			polling_enabled;
 	struct adma_desc_table 	*adma_table;
 	dma_addr_t		phy_adma_table;
@@ -246,6 +272,7 @@ struct omap_hsmmc_host {
 	int			use_reg;
 	int			req_in_progress;
 	int			tput_constraint;
+	struct	omap_hsmmc_next	next_data;
 
 	struct	omap_mmc_platform_data	*pdata;
 };
@@ -1037,7 +1064,7 @@ omap_hsmmc_xfer_done(struct omap_hsmmc_host *host, struct mmc_data *data)
 
 	host->data = NULL;
 
-	if (host->dma_type == ADMA_XFER)
+	if (host->dma_type == ADMA_XFER && !data->host_cookie)
 		dma_unmap_sg(mmc_dev(host->mmc), data->sg, host->dma_len,
 					omap_hsmmc_get_dma_dir(host, data));
 
@@ -1077,6 +1104,16 @@ omap_hsmmc_cmd_done(struct omap_hsmmc_host *host, struct mmc_command *cmd)
 		omap_hsmmc_request_done(host, cmd->mrq);
 }
 
+static void omap_hsmmc_free_dma_lch(struct omap_hsmmc_host *host)
+{
+	unsigned int i;
+
+	for (i = 0; i < host->dma_nr_lch; i++)
+		omap_free_dma(host->dma_lch[i]);
+	host->dma_nr_lch = 0;
+	host->dma_run = 0;
+}
+
 /*
  * DMA clean up for command errors
  */
@@ -1092,9 +1129,11 @@ static void omap_hsmmc_dma_cleanup(struct omap_hsmmc_host *host, int errno)
 	spin_unlock(&host->irq_lock);
 
 	if ((host->dma_type == SDMA_XFER) && (dma_ch != -1)) {
-		dma_unmap_sg(mmc_dev(host->mmc), host->data->sg, host->dma_len,
-			omap_hsmmc_get_dma_dir(host, host->data));
-		omap_free_dma(dma_ch);
+		if (!host->data->host_cookie)
+			dma_unmap_sg(mmc_dev(host->mmc), host->data->sg,
+				host->dma_len,
+				omap_hsmmc_get_dma_dir(host, host->data));
+		omap_hsmmc_free_dma_lch(host);
 	}
 	host->data = NULL;
 }
@@ -1453,12 +1492,11 @@ static int omap_hsmmc_get_dma_sync_dev(struct omap_hsmmc_host *host,
 }
 
 static void omap_hsmmc_config_dma_params(struct omap_hsmmc_host *host,
-				       struct mmc_data *data,
+				       struct mmc_data *data, int dma_ch,
 				       struct scatterlist *sgl)
 {
-	int blksz, nblk, dma_ch;
+	int blksz, nblk;
 
-	dma_ch = host->dma_ch;
 	if (data->flags & MMC_DATA_WRITE) {
 		omap_set_dma_dest_params(dma_ch, 0, OMAP_DMA_AMODE_CONSTANT,
 			(host->mapbase + host->regs[OMAP_HSMMC_DATA]), 0, 0);
@@ -1478,8 +1516,44 @@ static void omap_hsmmc_config_dma_params(struct omap_hsmmc_host *host,
 			blksz / 4, nblk, OMAP_DMA_SYNC_FRAME,
 			omap_hsmmc_get_dma_sync_dev(host, data),
 			!(data->flags & MMC_DATA_WRITE));
+}
 
-	omap_start_dma(dma_ch);
+/*
+ * Program the next run of sg segments, one per logical channel, link
+ * the channels and start the head.  The controller then walks the whole
+ * run without the CPU reprogramming the DMA between segments.
+ */
+static void omap_hsmmc_start_dma_run(struct omap_hsmmc_host *host,
+				     struct mmc_data *data)
+{
+	unsigned int i, n;
+
+	n = min(host->dma_len - host->dma_sg_idx, host->dma_nr_lch);
+	for (i = 0; i < n; i++) {
+		int lch = host->dma_lch[i];
+
+		omap_hsmmc_config_dma_params(host, data, lch,
+					     data->sg + host->dma_sg_idx + i);
+		if (i + 1 < n) {
+			omap_disable_dma_irq(lch, OMAP_DMA_BLOCK_IRQ);
+			omap_dma_link_lch(lch, host->dma_lch[i + 1]);
+		} else
+			omap_enable_dma_irq(lch, OMAP_DMA_BLOCK_IRQ);
+	}
+	host->dma_run = n;
+
+	omap_start_dma(host->dma_lch[0]);
+}
+
+/* Tear down the links of a finished run so the channels can be reused */
+static void omap_hsmmc_stop_dma_run(struct omap_hsmmc_host *host)
+{
+	unsigned int i;
+
+	omap_stop_dma(host->dma_lch[0]);
+	for (i = 0; i + 1 < host->dma_run; i++)
+		omap_dma_unlink_lch(host->dma_lch[i], host->dma_lch[i + 1]);
+	host->dma_run = 0;
 }
 
 /*
@@ -1489,7 +1563,7 @@ static void omap_hsmmc_dma_cb(int lch, u16 ch_status, void *cb_data)
 {
 	struct omap_hsmmc_host *host = cb_data;
 	struct mmc_data *data = host->mrq->data;
-	int dma_ch, req_in_progress;
+	int req_in_progress;
 
 	if (!(ch_status & OMAP_DMA_BLOCK_IRQ)) {
 		dev_warn(mmc_dev(host->mmc), "unexpected dma status %x\n",
@@ -1503,24 +1577,30 @@ static void omap_hsmmc_dma_cb(int lch, u16 ch_status, void *cb_data)
 		return;
 	}
 
-	host->dma_sg_idx++;
+	/* Only the tail of a linked run is expected to interrupt */
+	if (!host->dma_run || lch != host->dma_lch[host->dma_run - 1]) {
+		spin_unlock(&host->irq_lock);
+		return;
+	}
+
+	host->dma_sg_idx += host->dma_run;
+	omap_hsmmc_stop_dma_run(host);
 	if (host->dma_sg_idx < host->dma_len) {
-		/* Fire up the next transfer. */
-		omap_hsmmc_config_dma_params(host, data,
-					   data->sg + host->dma_sg_idx);
+		/* Fire up the next run. */
+		omap_hsmmc_start_dma_run(host, data);
 		spin_unlock(&host->irq_lock);
 		return;
 	}
 
-	dma_unmap_sg(mmc_dev(host->mmc), data->sg, host->dma_len,
-		omap_hsmmc_get_dma_dir(host, data));
+	if (!data->host_cookie)
+		dma_unmap_sg(mmc_dev(host->mmc), data->sg, host->dma_len,
+			     omap_hsmmc_get_dma_dir(host, data));
 
 	req_in_progress = host->req_in_progress;
-	dma_ch = host->dma_ch;
 	host->dma_ch = -1;
 	spin_unlock(&host->irq_lock);
 
-	omap_free_dma(dma_ch);
+	omap_hsmmc_free_dma_lch(host);
 
 	/* If DMA has finished after TC, complete the request */
 	if (!req_in_progress) {
@@ -1531,6 +1611,48 @@ static void omap_hsmmc_dma_cb(int lch, u16 ch_status, void *cb_data)
 	}
 }
 
+/*
+ * Map the sg list of @data for DMA.  With @next set this is a pre_req
+ * call preparing a request ahead of time: the mapping is remembered in
+ * @next and tagged with a cookie.  Without @next the mapping made by an
+ * earlier pre_req is reused if the cookie matches, else it is done now.
+ */
+static int omap_hsmmc_pre_dma_transfer(struct omap_hsmmc_host *host,
+				       struct mmc_data *data,
+				       struct omap_hsmmc_next *next)
+{
+	int dma_len;
+
+	if (!next && data->host_cookie &&
+	    data->host_cookie != host->next_data.cookie) {
+		dev_warn(mmc_dev(host->mmc), "invalid cookie: data %d"
+			 " next %d\n", data->host_cookie,
+			 host->next_data.cookie);
+		data->host_cookie = 0;
+	}
+
+	/* Check if next job is already prepared */
+	if (next || data->host_cookie != host->next_data.cookie) {
+		dma_len = dma_map_sg(mmc_dev(host->mmc), data->sg,
+				     data->sg_len,
+				     omap_hsmmc_get_dma_dir(host, data));
+	} else {
+		dma_len = host->next_data.dma_len;
+		host->next_data.dma_len = 0;
+	}
+
+	if (dma_len == 0)
+		return -EINVAL;
+
+	if (next) {
+		next->dma_len = dma_len;
+		data->host_cookie = ++next->cookie < 0 ? 1 : next->cookie;
+	} else
+		host->dma_len = dma_len;
+
+	return 0;
+}
+
 /*
  * Routine to configure and start DMA for the MMC card
  */
@@ -1538,6 +1660,7 @@ static int omap_hsmmc_start_sdma_transfer(struct omap_hsmmc_host *host,
 					struct mmc_request *req)
 {
 	int dma_ch = 0, ret = 0, i;
+	unsigned int nr_lch;
 	struct mmc_data *data = req->data;
 
 	/* Sanity check: all the SG entries must be aligned by block size. */
@@ -1565,12 +1688,34 @@ static int omap_hsmmc_start_sdma_transfer(struct omap_hsmmc_host *host,
 		return ret;
 	}
 
-	host->dma_len = dma_map_sg(mmc_dev(host->mmc), data->sg,
-			data->sg_len, omap_hsmmc_get_dma_dir(host, data));
-	host->dma_ch = dma_ch;
+	ret = omap_hsmmc_pre_dma_transfer(host, data, NULL);
+	if (ret) {
+		omap_free_dma(dma_ch);
+		return ret;
+	}
+	host->dma_lch[0] = dma_ch;
+	host->dma_nr_lch = 1;
+
+	/*
+	 * Take extra channels to link for multi-segment transfers.  When
+	 * they are scarce, just run with fewer links per interrupt.
+	 */
+	nr_lch = clamp_t(unsigned int, sdma_linked_lch, 1,
+			 SDMA_MAX_LINKED_LCH);
+	nr_lch = min_t(unsigned int, host->dma_len, nr_lch);
+	while (host->dma_nr_lch < nr_lch &&
+	       omap_dma_free_lch_count() > SDMA_KEEP_FREE_LCH) {
+		if (omap_request_dma(omap_hsmmc_get_dma_sync_dev(host, data),
+				     "MMC/SD", omap_hsmmc_dma_cb, host,
+				     &dma_ch))
+			break;
+		host->dma_lch[host->dma_nr_lch++] = dma_ch;
+	}
+
+	host->dma_ch = host->dma_lch[0];
 	host->dma_sg_idx = 0;
 
-	omap_hsmmc_config_dma_params(host, data, data->sg);
+	omap_hsmmc_start_dma_run(host, data);
 
 	return 0;
 }
@@ -1584,8 +1729,8 @@ static int mmc_populate_adma_desc_table(struct omap_hsmmc_host *host,
 	dma_addr_t dmaaddr;
 	struct mmc_data *data = req->data;
 
-	host->dma_len = dma_map_sg(mmc_dev(host->mmc), data->sg,
-			data->sg_len, omap_hsmmc_get_dma_dir(host, data));
+	if (omap_hsmmc_pre_dma_transfer(host, data, NULL))
+		return 0;
 	for (i = 0, j = 0; i < host->dma_len; i++) {
 		dmaaddr = sg_dma_address(data->sg + i);
 		dmalen = sg_dma_len(data->sg + i);
@@ -1706,12 +1851,45 @@ omap_hsmmc_prepare_data(struct omap_hsmmc_host *host, struct mmc_request *req)
 	} else if (host->dma_type == ADMA_XFER) {
 		numblks = mmc_populate_adma_desc_table(host,
 				req, host->adma_table);
+		if (!numblks)
+			return -EINVAL;
 		WARN_ON(numblks != req->data->blocks);
 		omap_hsmmc_start_adma_transfer(host);
 	}
 	return 0;
 }
 
+static void omap_hsmmc_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
+				int err)
+{
+	struct omap_hsmmc_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (data && host->dma_type != DMA_TYPE_NODMA && data->host_cookie)
+		dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+			     omap_hsmmc_get_dma_dir(host, data));
+	if (data)
+		data->host_cookie = 0;
+}
+
+static void omap_hsmmc_pre_req(struct mmc_host *mmc, struct mmc_request *mrq,
+			       bool is_first_req)
+{
+	struct omap_hsmmc_host *host = mmc_priv(mmc);
+
+	if (!mrq->data)
+		return;
+
+	if (mrq->data->host_cookie) {
+		mrq->data->host_cookie = 0;
+		return;
+	}
+
+	if (host->dma_type != DMA_TYPE_NODMA &&
+	    omap_hsmmc_pre_dma_transfer(host, mrq->data, &host->next_data))
+		mrq->data->host_cookie = 0;
+}
+
 /*
  * Request function. for read/write operation
  */
@@ -2441,6 +2619,8 @@ static const struct mmc_host_ops omap_hsmmc_ops = {
 	.enable = omap_hsmmc_enable_simple,
 	.disable = omap_hsmmc_disable_simple,
 	.request = omap_hsmmc_request,
+	.pre_req = omap_hsmmc_pre_req,
+	.post_req = omap_hsmmc_post_req,
 	.set_ios = omap_hsmmc_set_ios,
 	.get_cd = omap_hsmmc_get_cd,
 	.get_ro = omap_hsmmc_get_ro,
@@ -2451,6 +2631,8 @@ static const struct mmc_host_ops omap_hsmmc_ps_ops = {
 	.enable = omap_hsmmc_enable,
 	.disable = omap_hsmmc_disable,
 	.request = omap_hsmmc_request,
+	.pre_req = omap_hsmmc_pre_req,
+	.post_req = omap_hsmmc_post_req,
 	.set_ios = omap_hsmmc_set_ios,
 	.get_cd = omap_hsmmc_get_cd,
 	.get_ro = omap_hsmmc_get_ro,
@@ -2586,6 +2768,7 @@ static int __init omap_hsmmc_probe(struct platform_device *pdev)
 	host->regs	= (u16 *) pdata->regs_map;
 	host->power_mode = MMC_POWER_OFF;
 	host->tput_constraint = 0;
+	host->next_data.cookie = 1;
 
 	host->master_clock = OMAP_MMC_MASTER_CLOCK;
 	if (mmc_slot(host).features & HSMMC_HAS_48MHZ_MASTER_CLK)
@@ -20,9 +20,12 @@
 #include <linux/bitops.h>
 #include <linux/blkdev.h>
 #include <linux/buffer_head.h>
+#include <linux/completion.h>
 #include <linux/device.h>
 #include <linux/genhd.h>
+#include <linux/hash.h>
 #include <linux/highmem.h>
+#include <linux/jhash.h>
 #include <linux/slab.h>
 #include <linux/lzo.h>
 #include <linux/string.h>
@@ -38,6 +41,8 @@ static struct ramzswap *devices;
 
 /* Module params (documentation at end) */
 static unsigned int num_devices;
+static unsigned int backing_cold_age = 8;
+static unsigned int backing_age_secs = 30;
 
 static int rzs_test_flag(struct ramzswap *rzs, u32 index,
 			enum rzs_pageflags flag)
@@ -57,21 +62,107 @@ static void rzs_clear_flag(struct ramzswap *rzs, u32 index,
 	rzs->table[index].flags &= ~BIT(flag);
 }
 
-static int page_zero_filled(void *ptr)
+static int page_same_filled(void *ptr, unsigned long *element)
 {
 	unsigned int pos;
 	unsigned long *page;
 
 	page = (unsigned long *)ptr;
 
-	for (pos = 0; pos != PAGE_SIZE / sizeof(*page); pos++) {
-		if (page[pos])
+	for (pos = 1; pos != PAGE_SIZE / sizeof(*page); pos++) {
+		if (page[pos] != page[0])
 			return 0;
 	}
 
+	*element = page[0];
 	return 1;
 }
 
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+static struct hlist_head *rzs_dedup_bucket(struct ramzswap *rzs, u32 checksum)
+{
+	return &rzs->dedup_table[hash_32(checksum, RZS_DEDUP_HASH_BITS)];
+}
+
+/*
+ * Look for a stored object whose compressed data is @src. If there is
+ * one, take a reference on it and point table entry @index at it.
+ * LZO output is deterministic, so identical pages compress identically.
+ */
+static int rzs_dedup_find(struct ramzswap *rzs, u32 index,
+			unsigned char *src, size_t clen, u32 checksum)
+{
+	int found = 0;
+	unsigned char *cmem;
+	struct rzs_dedup *dedup;
+	struct hlist_node *pos;
+
+	spin_lock(&rzs->dedup_lock);
+	hlist_for_each_entry(dedup, pos,
+			rzs_dedup_bucket(rzs, checksum), node) {
+		if (dedup->checksum != checksum || dedup->clen != clen)
+			continue;
+
+		cmem = kmap_atomic(dedup->page, KM_USER1) + dedup->offset;
+		found = !memcmp(cmem + sizeof(struct zobj_header), src, clen);
+		kunmap_atomic(cmem, KM_USER1);
+
+		if (found) {
+			dedup->refs++;
+			rzs->table[index].page = dedup->page;
+			rzs->table[index].offset = dedup->offset;
+			break;
+		}
+	}
+	spin_unlock(&rzs->dedup_lock);
+
+	return found;
+}
+
+static struct rzs_dedup *rzs_dedup_add(struct ramzswap *rzs,
+			struct page *page, u32 offset, size_t clen, u32 checksum)
+{
+	struct rzs_dedup *dedup;
+
+	/* Object is just not shareable if this fails */
+	dedup = kmalloc(sizeof(*dedup), GFP_NOIO | __GFP_NOWARN);
+	if (!dedup)
+		return NULL;
+
+	dedup->page = page;
+	dedup->offset = offset;
+	dedup->clen = clen;
+	dedup->checksum = checksum;
+	dedup->refs = 1;
+
+	spin_lock(&rzs->dedup_lock);
+	hlist_add_head(&dedup->node, rzs_dedup_bucket(rzs, checksum));
+	spin_unlock(&rzs->dedup_lock);
+
+	return dedup;
+}
+
+/*
+ * Drop a reference on a shared object. Returns the number of
+ * references left; the object must be freed when this is zero.
+ */
+static u32 rzs_dedup_put(struct ramzswap *rzs, struct rzs_dedup *dedup)
+{
+	u32 refs;
+
+	spin_lock(&rzs->dedup_lock);
+	refs = --dedup->refs;
+	if (!refs)
+		hlist_del(&dedup->node);
+	spin_unlock(&rzs->dedup_lock);
+
+	if (!refs)
+		kfree(dedup);
+
+	return refs;
+}
+#endif
+
 static void ramzswap_set_disksize(struct ramzswap *rzs, size_t totalram_bytes)
 {
 	if (!rzs->disksize) {
@@ -158,19 +249,138 @@ static void ramzswap_ioctl_get_stats(struct ramzswap *rzs,
 #endif /* CONFIG_RAMZSWAP_STATS */
 }
 
+#if defined(CONFIG_RAMZSWAP_STATS)
+/*
+ * Counters that do not fit in struct ramzswap_ioctl_stats without
+ * changing the RZSIO_GET_STATS ABI are exported in sysfs instead.
+ */
+static ssize_t same_pages_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ramzswap *rzs = dev_to_disk(dev)->private_data;
+
+	return sprintf(buf, "%u\n", rzs->stats.pages_same);
+}
+
+static ssize_t dedup_pages_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ramzswap *rzs = dev_to_disk(dev)->private_data;
+
+	return sprintf(buf, "%u\n", rzs->stats.pages_dedup);
+}
+
+static ssize_t backed_pages_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ramzswap *rzs = dev_to_disk(dev)->private_data;
+
+	return sprintf(buf, "%u\n", rzs->stats.pages_backed);
+}
+
+static ssize_t backing_reads_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ramzswap *rzs = dev_to_disk(dev)->private_data;
+
+	return sprintf(buf, "%llu\n", (unsigned long long)
+		rzs_stat64_read(rzs, &rzs->stats.backing_reads));
+}
+
+static ssize_t backing_writes_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ramzswap *rzs = dev_to_disk(dev)->private_data;
+
+	return sprintf(buf, "%llu\n", (unsigned long long)
+		rzs_stat64_read(rzs, &rzs->stats.backing_writes));
+}
+
+static DEVICE_ATTR(same_pages, S_IRUGO, same_pages_show, NULL);
+static DEVICE_ATTR(dedup_pages, S_IRUGO, dedup_pages_show, NULL);
+static DEVICE_ATTR(backed_pages, S_IRUGO, backed_pages_show, NULL);
+static DEVICE_ATTR(backing_reads, S_IRUGO, backing_reads_show, NULL);
+static DEVICE_ATTR(backing_writes, S_IRUGO, backing_writes_show, NULL);
+
+static struct attribute *ramzswap_disk_attrs[] = {
+	&dev_attr_same_pages.attr,
+	&dev_attr_dedup_pages.attr,
+	&dev_attr_backed_pages.attr,
+	&dev_attr_backing_reads.attr,
+	&dev_attr_backing_writes.attr,
+	NULL,
+};
+
+static struct attribute_group ramzswap_disk_attr_group = {
+	.attrs = ramzswap_disk_attrs,
+};
+#endif /* CONFIG_RAMZSWAP_STATS */
+
+static int rzs_backing_alloc(struct ramzswap *rzs, unsigned long *slot)
+{
+	unsigned long pos;
+
+	spin_lock(&rzs->backing_lock);
+	pos = find_next_zero_bit(rzs->backing_map, rzs->backing_pages,
+				rzs->backing_next);
+	if (pos >= rzs->backing_pages)
+		pos = find_first_zero_bit(rzs->backing_map,
+				rzs->backing_pages);
+	if (pos < rzs->backing_pages) {
+		__set_bit(pos, rzs->backing_map);
+		rzs->backing_next = pos + 1;
+	}
+	spin_unlock(&rzs->backing_lock);
+
+	if (pos >= rzs->backing_pages)
+		return -ENOSPC;
+
+	*slot = pos;
+	return 0;
+}
+
+static void rzs_backing_free(struct ramzswap *rzs, unsigned long slot)
+{
+	spin_lock(&rzs->backing_lock);
+	__clear_bit(slot, rzs->backing_map);
+	spin_unlock(&rzs->backing_lock);
+}
+
 static void ramzswap_free_page(struct ramzswap *rzs, size_t index)
 {
 	u32 clen;
 	void *obj;
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+	struct rzs_dedup *dedup;
+#endif
 
 	struct page *page = rzs->table[index].page;
 	u32 offset = rzs->table[index].offset;
 
+	/* Cancels a writeback to the backing swap in progress */
+	rzs->table[index].age = 0;
+
+	/*
+	 * No memory is allocated for same filled pages.
+	 * Simply clear the flag.
+	 */
+	if (rzs_test_flag(rzs, index, RZS_SAME)) {
+		rzs_clear_flag(rzs, index, RZS_SAME);
+		rzs_stat_dec(&rzs->stats.pages_same);
+		rzs->table[index].element = 0;
+		return;
+	}
+
+	/* Page lives on the backing swap: just release its slot */
+	if (rzs_test_flag(rzs, index, RZS_BACKED)) {
+		rzs_backing_free(rzs, rzs->table[index].element);
+		rzs_clear_flag(rzs, index, RZS_BACKED);
+		rzs_stat_dec(&rzs->stats.pages_backed);
+		rzs->table[index].element = 0;
+		return;
+	}
+
 	if (unlikely(!page)) {
-		/*
-		 * No memory is allocated for zero filled pages.
-		 * Simply clear zero page flag.
-		 */
 		if (rzs_test_flag(rzs, index, RZS_ZERO)) {
 			rzs_clear_flag(rzs, index, RZS_ZERO);
 			rzs_stat_dec(&rzs->stats.pages_zero);
@@ -188,27 +398,47 @@ static void ramzswap_free_page(struct ramzswap *rzs, size_t index)
 
 	obj = kmap_atomic(page, KM_USER0) + offset;
 	clen = xv_get_object_size(obj) - sizeof(struct zobj_header);
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+	dedup = ((struct zobj_header *)obj)->dedup;
+#endif
 	kunmap_atomic(obj, KM_USER0);
 
-	xv_free(rzs->mem_pool, page, offset);
 	if (clen <= PAGE_SIZE / 2)
 		rzs_stat_dec(&rzs->stats.good_compress);
 
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+	/* Object is still used by other swap slots */
+	if (dedup && rzs_dedup_put(rzs, dedup)) {
+		rzs_stat_dec(&rzs->stats.pages_dedup);
+		goto out_shared;
+	}
+#endif
+
+	xv_free(rzs->mem_pool, page, offset);
+
 out:
 	rzs->stats.compr_size -= clen;
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+out_shared:
+#endif
 	rzs_stat_dec(&rzs->stats.pages_stored);
 
 	rzs->table[index].page = NULL;
 	rzs->table[index].offset = 0;
 }
 
-static int handle_zero_page(struct bio *bio)
+static int handle_same_page(struct bio *bio, unsigned long element)
 {
-	void *user_mem;
+	unsigned int pos;
+	unsigned long *user_mem;
 	struct page *page = bio->bi_io_vec[0].bv_page;
 
 	user_mem = kmap_atomic(page, KM_USER0);
-	memset(user_mem, 0, PAGE_SIZE);
+	if (!element)
+		memset(user_mem, 0, PAGE_SIZE);
+	else
+		for (pos = 0; pos != PAGE_SIZE / sizeof(*user_mem); pos++)
+			user_mem[pos] = element;
 	kunmap_atomic(user_mem, KM_USER0);
 
 	flush_dcache_page(page);
@@ -242,6 +472,20 @@ static int handle_uncompressed_page(struct ramzswap *rzs, struct bio *bio)
 	return 0;
 }
 
+/*
+ * Redirect a request for a page kept on the backing swap device.
+ * A non-zero return from make_request makes the block layer
+ * resubmit the bio to its new device.
+ */
+static int ramzswap_backing_remap(struct ramzswap *rzs, struct bio *bio,
+			u32 index)
+{
+	bio->bi_bdev = rzs->backing_swap;
+	bio->bi_sector = (sector_t)rzs->table[index].element <<
+				SECTORS_PER_PAGE_SHIFT;
+	return 1;
+}
+
 /*
  * Called when request page is not present in ramzswap.
  * This is an attempt to read before any previous write
@@ -261,14 +505,33 @@ static int handle_ramzswap_fault(struct ramzswap *rzs, struct bio *bio)
 	return 0;
 }
 
+static int ramzswap_decompress_page(struct ramzswap *rzs, u32 index,
+			struct page *page)
+{
+	int ret;
+	size_t clen = PAGE_SIZE;
+	unsigned char *user_mem, *cmem;
+
+	user_mem = kmap_atomic(page, KM_USER0);
+	cmem = kmap_atomic(rzs->table[index].page, KM_USER1) +
+			rzs->table[index].offset;
+
+	ret = lzo1x_decompress_safe(
+		cmem + sizeof(struct zobj_header),
+		xv_get_object_size(cmem) - sizeof(struct zobj_header),
+		user_mem, &clen);
+
+	kunmap_atomic(user_mem, KM_USER0);
+	kunmap_atomic(cmem, KM_USER1);
+
+	return ret;
+}
+
 static int ramzswap_read(struct ramzswap *rzs, struct bio *bio)
 {
 	int ret;
 	u32 index;
-	size_t clen;
 	struct page *page;
-	struct zobj_header *zheader;
-	unsigned char *user_mem, *cmem;
 
 	rzs_stat64_inc(rzs, &rzs->stats.num_reads);
 
@@ -276,29 +539,39 @@ static int ramzswap_read(struct ramzswap *rzs, struct bio *bio)
 	index = bio->bi_sector >> SECTORS_PER_PAGE_SHIFT;
 
 	if (rzs_test_flag(rzs, index, RZS_ZERO))
-		return handle_zero_page(bio);
+		return handle_same_page(bio, 0);
 
-	/* Requested page is not present in compressed area */
-	if (!rzs->table[index].page)
-		return handle_ramzswap_fault(rzs, bio);
+	if (rzs_test_flag(rzs, index, RZS_SAME))
+		return handle_same_page(bio, rzs->table[index].element);
 
-	/* Page is stored uncompressed since it's incompressible */
-	if (unlikely(rzs_test_flag(rzs, index, RZS_UNCOMPRESSED)))
-		return handle_uncompressed_page(rzs, bio);
+	/* The aging pass may move this page out from under us */
+	mutex_lock(&rzs->lock);
 
-	user_mem = kmap_atomic(page, KM_USER0);
-	clen = PAGE_SIZE;
+	if (rzs_test_flag(rzs, index, RZS_BACKED)) {
+		ret = ramzswap_backing_remap(rzs, bio, index);
+		mutex_unlock(&rzs->lock);
+		rzs_stat64_inc(rzs, &rzs->stats.backing_reads);
+		return ret;
+	}
 
-	cmem = kmap_atomic(rzs->table[index].page, KM_USER1) +
-			rzs->table[index].offset;
+	/* Requested page is not present in compressed area */
+	if (!rzs->table[index].page) {
+		mutex_unlock(&rzs->lock);
+		return handle_ramzswap_fault(rzs, bio);
+	}
 
-	ret = lzo1x_decompress_safe(
-		cmem + sizeof(*zheader),
-		xv_get_object_size(cmem) - sizeof(*zheader),
-		user_mem, &clen);
+	/* Page is in use again, keep it in memory */
+	rzs->table[index].age = 0;
 
-	kunmap_atomic(user_mem, KM_USER0);
-	kunmap_atomic(cmem, KM_USER1);
+	/* Page is stored uncompressed since it's incompressible */
+	if (unlikely(rzs_test_flag(rzs, index, RZS_UNCOMPRESSED))) {
+		ret = handle_uncompressed_page(rzs, bio);
+		mutex_unlock(&rzs->lock);
+		return ret;
+	}
+
+	ret = ramzswap_decompress_page(rzs, index, page);
+	mutex_unlock(&rzs->lock);
 
 	/* should NEVER happen */
 	if (unlikely(ret != LZO_E_OK)) {
@@ -324,9 +597,14 @@ static int ramzswap_write(struct ramzswap *rzs, struct bio *bio)
 	int ret;
 	u32 offset, index;
 	size_t clen;
+	unsigned long element;
 	struct zobj_header *zheader;
 	struct page *page, *page_store;
 	unsigned char *user_mem, *cmem, *src;
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+	u32 checksum;
+	struct rzs_dedup *dedup = NULL;
+#endif
 
 	rzs_stat64_inc(rzs, &rzs->stats.num_writes);
 
@@ -337,12 +615,27 @@ static int ramzswap_write(struct ramzswap *rzs, struct bio *bio)
 
 	mutex_lock(&rzs->lock);
 
+	/*
+	 * The swap slot is being reused, so whatever was stored
+	 * here before is no longer referenced.
+	 */
+	if (rzs->table[index].page || rzs_test_flag(rzs, index, RZS_ZERO) ||
+			rzs_test_flag(rzs, index, RZS_SAME) ||
+			rzs_test_flag(rzs, index, RZS_BACKED))
+		ramzswap_free_page(rzs, index);
+
 	user_mem = kmap_atomic(page, KM_USER0);
-	if (page_zero_filled(user_mem)) {
+	if (page_same_filled(user_mem, &element)) {
 		kunmap_atomic(user_mem, KM_USER0);
 		mutex_unlock(&rzs->lock);
-		rzs_stat_inc(&rzs->stats.pages_zero);
-		rzs_set_flag(rzs, index, RZS_ZERO);
+		if (!element) {
+			rzs_stat_inc(&rzs->stats.pages_zero);
+			rzs_set_flag(rzs, index, RZS_ZERO);
+		} else {
+			rzs_stat_inc(&rzs->stats.pages_same);
+			rzs->table[index].element = element;
+			rzs_set_flag(rzs, index, RZS_SAME);
+		}
 
 		set_bit(BIO_UPTODATE, &bio->bi_flags);
 		bio_endio(bio, 0);
@@ -352,6 +645,10 @@ static int ramzswap_write(struct ramzswap *rzs, struct bio *bio)
 	ret = lzo1x_1_compress(user_mem, PAGE_SIZE, src, &clen,
 				rzs->compress_workmem);
 
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+	checksum = jhash2((u32 *)user_mem, PAGE_SIZE / sizeof(u32), 0);
+#endif
+
 	kunmap_atomic(user_mem, KM_USER0);
 
 	if (unlikely(ret != LZO_E_OK)) {
@@ -367,6 +664,18 @@ static int ramzswap_write(struct ramzswap *rzs, struct bio *bio)
 	 * errors which has side effect of hanging the system.
 	 */
 	if (unlikely(clen > max_zpage_size)) {
+		unsigned long slot;
+
+		/* It saves no memory here, send it to the backing swap */
+		if (rzs->backing_swap && !rzs_backing_alloc(rzs, &slot)) {
+			rzs->table[index].element = slot;
+			rzs_set_flag(rzs, index, RZS_BACKED);
+			rzs_stat_inc(&rzs->stats.pages_backed);
+			rzs_stat64_inc(rzs, &rzs->stats.backing_writes);
+			mutex_unlock(&rzs->lock);
+			return ramzswap_backing_remap(rzs, bio, index);
+		}
+
 		clen = PAGE_SIZE;
 		page_store = alloc_page(GFP_NOIO | __GFP_HIGHMEM);
 		if (unlikely(!page_store)) {
@@ -385,6 +694,14 @@ static int ramzswap_write(struct ramzswap *rzs, struct bio *bio)
 		goto memstore;
 	}
 
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+	/* Same contents already stored: share that object */
+	if (rzs_dedup_find(rzs, index, src, clen, checksum)) {
+		rzs_stat_inc(&rzs->stats.pages_dedup);
+		goto stored;
+	}
+#endif
+
 	if (xv_malloc(rzs->mem_pool, clen + sizeof(*zheader),
 			&rzs->table[index].page, &offset,
 			GFP_NOIO | __GFP_HIGHMEM)) {
@@ -395,6 +712,11 @@ static int ramzswap_write(struct ramzswap *rzs, struct bio *bio)
 		goto out;
 	}
 
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+	dedup = rzs_dedup_add(rzs, rzs->table[index].page, offset,
+				clen, checksum);
+#endif
+
 memstore:
 	rzs->table[index].offset = offset;
 
@@ -410,14 +732,28 @@ memstore:
 	}
 #endif
 
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+	if (!rzs_test_flag(rzs, index, RZS_UNCOMPRESSED)) {
+		zheader = (struct zobj_header *)cmem;
+		zheader->dedup = dedup;
+		cmem += sizeof(*zheader);
+	}
+#endif
+
 	memcpy(cmem, src, clen);
 
 	kunmap_atomic(cmem, KM_USER1);
 	if (unlikely(rzs_test_flag(rzs, index, RZS_UNCOMPRESSED)))
 		kunmap_atomic(src, KM_USER0);
 
-	/* Update stats */
 	rzs->stats.compr_size += clen;
+
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+stored:
+#endif
+	rzs->table[index].age = 0;
+
+	/* Update stats */
 	rzs_stat_inc(&rzs->stats.pages_stored);
 	if (clen <= PAGE_SIZE / 2)
 		rzs_stat_inc(&rzs->stats.good_compress);
@@ -433,6 +769,262 @@ out:
 	return 0;
 }
 
+/* One batch of cold pages on its way to the backing swap */
+struct rzs_backing_io {
+	struct completion done;
+	atomic_t pending;
+	size_t index[RZS_BACKING_BATCH];
+	unsigned long slot[RZS_BACKING_BATCH];
+	struct bio *bio[RZS_BACKING_BATCH];
+};
+
+static void ramzswap_backing_end_io(struct bio *bio, int err)
+{
+	struct rzs_backing_io *io = bio->bi_private;
+
+	if (atomic_dec_and_test(&io->pending))
+		complete(&io->done);
+}
+
+/*
+ * Write a batch of cold pages to the backing swap and release their
+ * memory. Pages are decompressed under rzs->lock, but the lock is not
+ * held across the I/O: a page that is read, written or freed meanwhile
+ * has its age reset and simply stays where it is. Entries are only
+ * looked at under table_lock since a slot free notify may race.
+ */
+static unsigned int ramzswap_backing_writeback(struct ramzswap *rzs,
+			struct rzs_backing_io *io, unsigned int count)
+{
+	unsigned int i, moved = 0;
+	struct page *page;
+	struct bio *bio;
+	size_t index;
+
+	init_completion(&io->done);
+	atomic_set(&io->pending, 1);
+
+	mutex_lock(&rzs->lock);
+	for (i = 0; i < count; i++) {
+		index = io->index[i];
+		io->bio[i] = NULL;
+
+		if (rzs_backing_alloc(rzs, &io->slot[i]))
+			continue;
+
+		page = alloc_page(GFP_NOIO | __GFP_HIGHMEM | __GFP_NOWARN);
+		if (!page)
+			goto free_slot;
+
+		bio = bio_alloc(GFP_NOIO, 1);
+		if (!bio)
+			goto free_page;
+
+		spin_lock(&rzs->table_lock);
+		if (rzs->table[index].age != RZS_AGE_WRITEBACK ||
+				ramzswap_decompress_page(rzs, index, page) != LZO_E_OK) {
+			spin_unlock(&rzs->table_lock);
+			bio_put(bio);
+			goto free_page;
+		}
+		spin_unlock(&rzs->table_lock);
+
+		bio->bi_bdev = rzs->backing_swap;
+		bio->bi_sector = (sector_t)io->slot[i] << SECTORS_PER_PAGE_SHIFT;
+		bio->bi_end_io = ramzswap_backing_end_io;
+		bio->bi_private = io;
+		bio_add_page(bio, page, PAGE_SIZE, 0);
+		io->bio[i] = bio;
+		continue;
+
+free_page:
+		__free_page(page);
+free_slot:
+		rzs_backing_free(rzs, io->slot[i]);
+	}
+	mutex_unlock(&rzs->lock);
+
+	/* Slots are handed out in order, so these mostly merge */
+	for (i = 0; i < count; i++) {
+		if (!io->bio[i])
+			continue;
+		atomic_inc(&io->pending);
+		submit_bio(WRITE, io->bio[i]);
+	}
+	blk_unplug(bdev_get_queue(rzs->backing_swap));
+
+	if (!atomic_dec_and_test(&io->pending))
+		wait_for_completion(&io->done);
+
+	mutex_lock(&rzs->lock);
+	spin_lock(&rzs->table_lock);
+	for (i = 0; i < count; i++) {
+		index = io->index[i];
+		bio = io->bio[i];
+
+		if (!bio) {
+			if (rzs->table[index].age == RZS_AGE_WRITEBACK)
+				rzs->table[index].age = 0;
+			continue;
+		}
+
+		if (test_bit(BIO_UPTODATE, &bio->bi_flags) &&
+				rzs->table[index].age == RZS_AGE_WRITEBACK) {
+			ramzswap_free_page(rzs, index);
+			rzs->table[index].element = io->slot[i];
+			rzs_set_flag(rzs, index, RZS_BACKED);
+			rzs_stat_inc(&rzs->stats.pages_backed);
+			rzs_stat64_inc(rzs, &rzs->stats.backing_writes);
+			moved++;
+		} else {
+			rzs_backing_free(rzs, io->slot[i]);
+			if (rzs->table[index].age == RZS_AGE_WRITEBACK)
+				rzs->table[index].age = 0;
+		}
+
+		__free_page(bio->bi_io_vec[0].bv_page);
+		bio_put(bio);
+	}
+	spin_unlock(&rzs->table_lock);
+	mutex_unlock(&rzs->lock);
+
+	return moved;
+}
+
+/*
+ * Only plain compressed objects are moved out. Objects shared by
+ * several swap slots would need one backing page per slot.
+ */
+static int ramzswap_page_movable(struct ramzswap *rzs, size_t index)
+{
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+	struct zobj_header *zheader;
+	struct rzs_dedup *dedup;
+#endif
+
+	if (!rzs->table[index].page ||
+			rzs_test_flag(rzs, index, RZS_UNCOMPRESSED) ||
+			rzs_test_flag(rzs, index, RZS_ZERO) ||
+			rzs_test_flag(rzs, index, RZS_SAME) ||
+			rzs_test_flag(rzs, index, RZS_BACKED))
+		return 0;
+
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+	zheader = kmap_atomic(rzs->table[index].page, KM_USER0) +
+			rzs->table[index].offset;
+	dedup = zheader->dedup;
+	kunmap_atomic(zheader, KM_USER0);
+
+	if (dedup && dedup->refs > 1)
+		return 0;
+#endif
+
+	return 1;
+}
+
+/*
+ * Periodic aging pass. Every stored page gets one tick older, and
+ * pages not touched for backing_cold_age passes are written to the
+ * backing swap in batches.
+ */
+static void ramzswap_age_work(struct work_struct *work)
+{
+	struct ramzswap *rzs = container_of(to_delayed_work(work),
+				struct ramzswap, age_work);
+	struct rzs_backing_io *io;
+	unsigned int cold_age, count = 0, queued = 0, moved = 0;
+	size_t index;
+
+	cold_age = min_t(unsigned int, backing_cold_age,
+			RZS_AGE_WRITEBACK - 1);
+	if (!cold_age)
+		goto out;
+
+	io = kmalloc(sizeof(*io), GFP_KERNEL);
+	if (!io)
+		goto out;
+
+	mutex_lock(&rzs->lock);
+	for (index = 1; index < rzs->disksize >> PAGE_SHIFT; index++) {
+		spin_lock(&rzs->table_lock);
+		if (!ramzswap_page_movable(rzs, index)) {
+			spin_unlock(&rzs->table_lock);
+			continue;
+		}
+
+		if (rzs->table[index].age < cold_age) {
+			rzs->table[index].age++;
+			spin_unlock(&rzs->table_lock);
+			continue;
+		}
+
+		if (queued >= RZS_BACKING_MAX_PER_PASS) {
+			spin_unlock(&rzs->table_lock);
+			continue;
+		}
+
+		rzs->table[index].age = RZS_AGE_WRITEBACK;
+		spin_unlock(&rzs->table_lock);
+		io->index[count++] = index;
+		queued++;
+		if (count == RZS_BACKING_BATCH) {
+			mutex_unlock(&rzs->lock);
+			moved += ramzswap_backing_writeback(rzs, io, count);
+			count = 0;
+			mutex_lock(&rzs->lock);
+		}
+	}
+	mutex_unlock(&rzs->lock);
+
+	if (count)
+		moved += ramzswap_backing_writeback(rzs, io, count);
+
+	kfree(io);
+
+	if (moved)
+		pr_debug("Moved %u cold pages to backing swap\n", moved);
+out:
+	schedule_delayed_work(&rzs->age_work,
+		max_t(unsigned int, backing_age_secs, 1) * HZ);
+}
+
+static int ramzswap_backing_init(struct ramzswap *rzs)
+{
+	size_t map_size;
+
+	rzs->backing_swap = open_bdev_exclusive(rzs->backing_swap_name,
+				FMODE_READ | FMODE_WRITE, rzs);
+	if (IS_ERR(rzs->backing_swap)) {
+		int ret = PTR_ERR(rzs->backing_swap);
+
+		pr_err("Error opening backing device: %s\n",
+			rzs->backing_swap_name);
+		rzs->backing_swap = NULL;
+		return ret;
+	}
+
+	rzs->backing_pages = i_size_read(rzs->backing_swap->bd_inode) >>
+				PAGE_SHIFT;
+	if (!rzs->backing_pages) {
+		pr_err("Backing device is too small: %s\n",
+			rzs->backing_swap_name);
+		return -EINVAL;
+	}
+
+	map_size = BITS_TO_LONGS(rzs->backing_pages) * sizeof(long);
+	rzs->backing_map = vmalloc(map_size);
+	if (!rzs->backing_map) {
+		pr_err("Error allocating backing device map\n");
+		return -ENOMEM;
+	}
+	memset(rzs->backing_map, 0, map_size);
+	rzs->backing_next = 0;
+
+	pr_info("Using backing device %s (%zu kB)\n",
+		rzs->backing_swap_name, rzs->backing_pages << (PAGE_SHIFT - 10));
+	return 0;
+}
+
 /*
  * Check if request is within bounds and page aligned.
  */
@@ -491,6 +1083,8 @@ static void reset_device(struct ramzswap *rzs)
 	/* Do not accept any new I/O request */
 	rzs->init_done = 0;
 
+	cancel_delayed_work_sync(&rzs->age_work);
+
 	/* Free various per-device buffers */
 	kfree(rzs->compress_workmem);
 	free_pages((unsigned long)rzs->compress_buffer, 1);
@@ -498,26 +1092,30 @@ static void reset_device(struct ramzswap *rzs)
 	rzs->compress_workmem = NULL;
 	rzs->compress_buffer = NULL;
 
-	/* Free all pages that are still in this ramzswap device */
-	for (index = 0; index < rzs->disksize >> PAGE_SHIFT; index++) {
-		struct page *page;
-		u16 offset;
-
-		page = rzs->table[index].page;
-		offset = rzs->table[index].offset;
-
-		if (!page)
-			continue;
-
-		if (unlikely(rzs_test_flag(rzs, index, RZS_UNCOMPRESSED)))
-			__free_page(page);
-		else
-			xv_free(rzs->mem_pool, page, offset);
-	}
+	/*
+	 * Free all pages that are still in this ramzswap device.
+	 * Shared objects are freed with their last reference.
+	 */
+	for (index = 0; index < rzs->disksize >> PAGE_SHIFT; index++)
+		ramzswap_free_page(rzs, index);
 
 	vfree(rzs->table);
 	rzs->table = NULL;
 
+	if (rzs->backing_swap)
+		close_bdev_exclusive(rzs->backing_swap,
+				FMODE_READ | FMODE_WRITE);
+	rzs->backing_swap = NULL;
+	vfree(rzs->backing_map);
+	rzs->backing_map = NULL;
+	rzs->backing_pages = 0;
+	rzs->backing_swap_name[0] = '\0';
+
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+	vfree(rzs->dedup_table);
+	rzs->dedup_table = NULL;
+#endif
+
 	xv_destroy_pool(rzs->mem_pool);
 	rzs->mem_pool = NULL;
 
@@ -531,6 +1129,9 @@ static int ramzswap_ioctl_init_device(struct ramzswap *rzs)
 {
 	int ret;
 	size_t num_pages;
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+	size_t index;
+#endif
 	struct page *page;
 	union swap_header *swap_header;
 
@@ -566,6 +1167,18 @@ static int ramzswap_ioctl_init_device(struct ramzswap *rzs)
 	}
 	memset(rzs->table, 0, num_pages * sizeof(*rzs->table));
 
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+	rzs->dedup_table = vmalloc(sizeof(*rzs->dedup_table) <<
+					RZS_DEDUP_HASH_BITS);
+	if (!rzs->dedup_table) {
+		pr_err("Error allocating ramzswap dedup table\n");
+		ret = -ENOMEM;
+		goto fail;
+	}
+	for (index = 0; index < 1 << RZS_DEDUP_HASH_BITS; index++)
+		INIT_HLIST_HEAD(&rzs->dedup_table[index]);
+#endif
+
 	page = alloc_page(__GFP_ZERO);
 	if (!page) {
 		pr_err("Error allocating swap header page\n");
@@ -591,6 +1204,14 @@ static int ramzswap_ioctl_init_device(struct ramzswap *rzs)
 		goto fail;
 	}
 
+	if (rzs->backing_swap_name[0]) {
+		ret = ramzswap_backing_init(rzs);
+		if (ret)
+			goto fail;
+		schedule_delayed_work(&rzs->age_work,
+			max_t(unsigned int, backing_age_secs, 1) * HZ);
+	}
+
 	rzs->init_done = 1;
 
 	pr_debug("Initialization done!\n");
@@ -655,6 +1276,20 @@ static int ramzswap_ioctl(struct block_device *bdev, fmode_t mode,
 		kfree(stats);
 		break;
 	}
+	case RZSIO_SET_BACKING_SWAP:
+		if (rzs->init_done) {
+			ret = -EBUSY;
+			goto out;
+		}
+		if (copy_from_user(&rzs->backing_swap_name, (void *)arg,
+						_IOC_SIZE(cmd))) {
+			ret = -EFAULT;
+			goto out;
+		}
+		rzs->backing_swap_name[MAX_SWAP_NAME_LEN - 1] = '\0';
+		pr_info("Backing swap set to %s\n", rzs->backing_swap_name);
+		break;
+
 	case RZSIO_INIT:
 		ret = ramzswap_ioctl_init_device(rzs);
 		break;
@@ -687,7 +1322,9 @@ void ramzswap_slot_free_notify(struct block_device *bdev, unsigned long index)
 	struct ramzswap *rzs;
 
 	rzs = bdev->bd_disk->private_data;
+	spin_lock(&rzs->table_lock);
 	ramzswap_free_page(rzs, index);
+	spin_unlock(&rzs->table_lock);
 	rzs_stat64_inc(rzs, &rzs->stats.notify_free);
 
 	return;
@@ -705,6 +1342,12 @@ static int create_device(struct ramzswap *rzs, int device_id)
 
 	mutex_init(&rzs->lock);
 	spin_lock_init(&rzs->stat64_lock);
+	spin_lock_init(&rzs->table_lock);
+	spin_lock_init(&rzs->backing_lock);
+	INIT_DELAYED_WORK(&rzs->age_work, ramzswap_age_work);
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+	spin_lock_init(&rzs->dedup_lock);
+#endif
 
 	rzs->queue = blk_alloc_queue(GFP_KERNEL);
 	if (!rzs->queue) {
@@ -742,6 +1385,13 @@ static int create_device(struct ramzswap *rzs, int device_id)
 
 	add_disk(rzs->disk);
 
+#if defined(CONFIG_RAMZSWAP_STATS)
+	if (sysfs_create_group(&disk_to_dev(rzs->disk)->kobj,
+			&ramzswap_disk_attr_group))
+		pr_warning("Error creating sysfs group for device %d\n",
+			device_id);
+#endif
+
 	rzs->init_done = 0;
 
 out:
@@ -751,6 +1401,10 @@ out:
 static void destroy_device(struct ramzswap *rzs)
 {
 	if (rzs->disk) {
+#if defined(CONFIG_RAMZSWAP_STATS)
+		sysfs_remove_group(&disk_to_dev(rzs->disk)->kobj,
+			&ramzswap_disk_attr_group);
+#endif
 		del_gendisk(rzs->disk);
 		put_disk(rzs->disk);
 	}
@@ -828,6 +1482,11 @@ static void __exit ramzswap_exit(void)
 
 module_param(num_devices, uint, 0);
 MODULE_PARM_DESC(num_devices, "Number of ramzswap devices");
+module_param(backing_cold_age, uint, 0644);
+MODULE_PARM_DESC(backing_cold_age,
+	"Aging passes before an unused page goes to the backing swap (0=never)");
+module_param(backing_age_secs, uint, 0644);
+MODULE_PARM_DESC(backing_age_secs, "Seconds between aging passes");
 
 module_init(ramzswap_init);
 module_exit(ramzswap_exit);
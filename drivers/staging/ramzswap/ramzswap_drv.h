@@ -17,6 +17,7 @@
 
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "ramzswap_ioctl.h"
 #include "xvmalloc.h"
@@ -37,6 +38,9 @@ struct zobj_header {
 #if 0
 	u32 table_idx;
 #endif
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+	struct rzs_dedup *dedup;	/* NULL if object is not shared */
+#endif
 };
 
 /*-- Configurable parameters */
@@ -63,6 +67,18 @@ static const unsigned max_zpage_size = PAGE_SIZE / 4 * 3;
 #define SECTORS_PER_PAGE_SHIFT	(PAGE_SHIFT - SECTOR_SHIFT)
 #define SECTORS_PER_PAGE	(1 << SECTORS_PER_PAGE_SHIFT)
 
+/* Buckets in the hash of stored objects used for deduplication */
+#define RZS_DEDUP_HASH_BITS	12
+
+/* Cold pages written to the backing swap device in one go */
+#define RZS_BACKING_BATCH	32
+
+/* Upper bound on cold pages moved out by one aging pass */
+#define RZS_BACKING_MAX_PER_PASS	(8 * RZS_BACKING_BATCH)
+
+/* table[page_no].age of a page being written to the backing swap */
+#define RZS_AGE_WRITEBACK	0xff
+
 /* Flags for ramzswap pages (table[page_no].flags) */
 enum rzs_pageflags {
 	/* Page is stored uncompressed */
@@ -71,19 +87,41 @@ enum rzs_pageflags {
 	/* Page consists entirely of zeros */
 	RZS_ZERO,
 
+	/* Page is one word repeated, kept in table[page_no].element */
+	RZS_SAME,
+
+	/* Page is on the backing swap, slot kept in table[page_no].element */
+	RZS_BACKED,
+
 	__NR_RZS_PAGEFLAGS,
 };
 
 /*-- Data structures */
 
+/*
+ * One for each compressed object, so that other swap slots
+ * with identical contents can share it.
+ */
+struct rzs_dedup {
+	struct hlist_node node;
+	struct page *page;
+	u16 offset;
+	u16 clen;
+	u32 checksum;
+	u32 refs;
+};
+
 /*
  * Allocated for each swap slot, indexed by page no.
  * These table entries must fit exactly in a page.
  */
 struct table {
-	struct page *page;
+	union {
+		struct page *page;
+		unsigned long element;	/* RZS_SAME and RZS_BACKED pages */
+	};
 	u16 offset;
-	u8 count;	/* object ref count (not yet used) */
+	u8 age;		/* aging passes since last access */
 	u8 flags;
 } __attribute__((aligned(4)));
 
@@ -100,6 +138,11 @@ struct ramzswap_stats {
 	u64 invalid_io;		/* non-swap I/O requests */
 	u64 notify_free;	/* no. of swap slot free notifications */
 	u32 pages_zero;		/* no. of zero filled pages */
+	u32 pages_same;		/* no. of other same filled pages */
+	u32 pages_dedup;	/* no. of pages sharing another's object */
+	u32 pages_backed;	/* no. of pages on the backing swap */
+	u64 backing_reads;	/* reads redirected to the backing swap */
+	u64 backing_writes;	/* pages written to the backing swap */
 	u32 pages_stored;	/* no. of pages currently stored */
 	u32 good_compress;	/* % of pages with compression ratio<=50% */
 	u32 pages_expand;	/* % of incompressible pages */
@@ -111,7 +154,17 @@ struct ramzswap {
 	void *compress_workmem;
 	void *compress_buffer;
 	struct table *table;
+#if defined(CONFIG_RAMZSWAP_DEDUP)
+	struct hlist_head *dedup_table;
+	spinlock_t dedup_lock;	/* protect dedup_table and refs */
+#endif
 	spinlock_t stat64_lock;	/* protect 64-bit stats */
+	/*
+	 * Slot free notifications come in under swap_lock and can't take
+	 * the mutex: they free entries under table_lock, and the aging
+	 * worker takes it too when touching entries it is not doing I/O on.
+	 */
+	spinlock_t table_lock;
 	struct mutex lock;
 	struct request_queue *queue;
 	struct gendisk *disk;
@@ -123,6 +176,18 @@ struct ramzswap {
 	 */
 	size_t disksize;	/* bytes */
 
+	/*
+	 * Optional backing swap device. Incompressible pages go
+	 * there directly, and compressed pages once they are cold.
+	 */
+	char backing_swap_name[MAX_SWAP_NAME_LEN];
+	struct block_device *backing_swap;
+	unsigned long *backing_map;	/* one bit per backing swap page */
+	size_t backing_pages;
+	size_t backing_next;	/* allocation cursor, keeps writes sequential */
+	spinlock_t backing_lock;	/* protect backing_map */
+	struct delayed_work age_work;
+
 	struct ramzswap_stats stats;
 };
 
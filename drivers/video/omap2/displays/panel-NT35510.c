@@ -63,6 +63,8 @@ static u16 LCD_VFP =	4;// 14;//6;
 static u16 LCD_VSW =	2; 
 
 #define LCD_PIXCLOCK_MAX	        24000 // 26000
+/* pixel clock while the picture is static, the LDI is fine at half rate */
+#define LCD_PIXCLOCK_IDLE	        (LCD_PIXCLOCK_MAX / 2)
 
 
 #define GPIO_LEVEL_LOW   0
@@ -443,6 +445,11 @@ static int nt35510_panel_resume(struct omap_dss_device *dssdev)
 	return 0;
 }
 
+static int nt35510_panel_set_idle(struct omap_dss_device *dssdev, bool idle)
+{
+	return dpi_set_idle_pixel_clock(dssdev, idle ? LCD_PIXCLOCK_IDLE : 0);
+}
+
 static struct omap_dss_driver nt35510_driver = {
 	.probe          = nt35510_panel_probe,
 	.remove         = nt35510_panel_remove,
@@ -451,6 +458,7 @@ static struct omap_dss_driver nt35510_driver = {
 	.disable        = nt35510_panel_disable,
 	.suspend        = nt35510_panel_suspend,
 	.resume         = nt35510_panel_resume,
+	.set_idle       = nt35510_panel_set_idle,
 
 	.driver		= {
 		.name	= "nt35510_panel",
@@ -12,6 +12,8 @@
 #include <linux/i2c/twl.h>
 #include <linux/delay.h>
 #include <linux/workqueue.h>
+#include <linux/ktime.h>
+#include <linux/bitmap.h>
 #include <linux/wakelock.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/consumer.h>
@@ -293,13 +295,45 @@ unsigned char cmc623_Power_LUT[NUM_POWER_LUT][NUM_ITEM_POWER_LUT]={
 };
 
 static bool cmc623_I2cWrite16(unsigned char Addr, unsigned long Data);
-static void cmc623_cabc_pwm_brightness_reg(int value);
+static void cmc623_cabc_pwm_brightness_reg(int value, int first);
 static void cmc623_manual_pwm_brightness_reg(int value);
 static void cmc623_manual_pwm_brightness_reg_nosync(int value);
 
 unsigned long last_cmc623_Bank = 0xffff;
 unsigned long last_cmc623_Algorithm = 0xffff;
 
+static int cmc623_I2cWriteTable(const mDNIe_data_type *mode);
+
+/* last value written to each register of bank 0 and 1, so that tables only
+ * send what changed. forgotten whenever the chip is reset */
+static u16 cmc623_shadow[2][256];
+static DECLARE_BITMAP(cmc623_shadow_valid, 2 * 256);
+
+/* registers per combined i2c transfer */
+#define CMC623_BATCH_MAX	32
+
+static u8 cmc623_batch_reg[CMC623_BATCH_MAX];
+static u8 cmc623_batch_data[CMC623_BATCH_MAX][2];
+static OMAP_GPIO_I2C_WR_DATA cmc623_batch_param[CMC623_BATCH_MAX];
+static int cmc623_batch_num;
+
+struct cmc623_i2c_stats {
+	unsigned long tables;
+	unsigned long written;
+	unsigned long skipped;
+	unsigned long errors;
+	unsigned long total_us;
+	unsigned long max_us;
+	unsigned long resume_us;
+};
+
+static struct cmc623_i2c_stats cmc623_i2c_stats;
+
+/* programs the chip after a reset and restores the mode, off the resume path */
+static struct work_struct cmc623_resume_work;
+/* bit 0 set: the next mode change is the first one after a reset */
+static unsigned long cmc623_resync;
+
 static void set_cmc623_val_for_pclk(int pclk)
 {
 	if(pclk > 53000000)
@@ -668,11 +702,7 @@ void cmc623_Color_Black_Change(int value, int finalize)
 	cmc623_state.black = value;
 	
 	mutex_lock(&cmc623_mDnie_mutex);
-	while ( mode->addr != END_SEQ)
-	{
-		cmc623_I2cWrite16(mode->addr, mode->data);
-		mode++;
-	}
+	cmc623_I2cWriteTable(mode);
 	
 	if(finalize == TRUE)
 	{
@@ -709,9 +739,12 @@ struct work_struct  cabc_work;
 //struct workqueue_struct *cabc_wq=NULL;
 void cabc_work_func(struct work_struct *work)
 {
-	int check;
+	int check, resync;
 	mDNIe_data_type *mode = current_cmc623_mode;
-	check = (setting_first || current_cabc_enable != cmc623_state.cabc_enabled);
+
+	/* latched at queue time, the caller clears setting_first before we run */
+	resync = test_and_clear_bit(0, &cmc623_resync);
+	check = (resync || current_cabc_enable != cmc623_state.cabc_enabled);
 	printk(KERN_DEBUG"[cmc623]%s ++ check(%d),cabc(%d)\n", __func__, check, current_cabc_enable);	
 
 
@@ -737,13 +770,7 @@ void cabc_work_func(struct work_struct *work)
 
 //	current_cmc623_mode = mode;
 	mutex_lock(&cmc623_mDnie_mutex);
-	int i2c_ret=0;
-	while ( mode->addr != END_SEQ)
-	{
-		i2c_ret = cmc623_I2cWrite16(mode->addr, mode->data);
-		dprintk(KERN_INFO "[cmc623] a(0x%x),d(0x%x),ret(%d)\n",mode->addr, mode->data, i2c_ret);	
-		mode++;
-	}
+	cmc623_I2cWriteTable(mode);
 	mutex_unlock(&cmc623_mDnie_mutex);
 	// brightness setting 
 	if(check || current_power_lut_num != cmc623_state.power_lut_num)
@@ -752,14 +779,14 @@ void cabc_work_func(struct work_struct *work)
 		if(current_cabc_enable)
 		{
 			//CABC brightness setting
-			cmc623_cabc_pwm_brightness_reg(cmc623_state.brightness);
+			cmc623_cabc_pwm_brightness_reg(cmc623_state.brightness, resync);
 
 			cmc623_state.cabc_enabled = TRUE;
 		}
 		else
 		{
 			//Manual brightness setting
-			if(setting_first)
+			if(resync)
 				cmc623_manual_pwm_brightness_reg_nosync(cmc623_state.brightness);
 			else
 				cmc623_manual_pwm_brightness_reg(cmc623_state.brightness);
@@ -793,6 +820,8 @@ void cmc623_Mode_Change(mDNIe_data_type *mode, int cabc_enable)
 {
 	current_cmc623_mode = mode;
 	current_cabc_enable = cabc_enable;
+	if(setting_first)
+		set_bit(0, &cmc623_resync);
 
 	if(cmc623_state.suspended == TRUE)
 	{
@@ -907,7 +936,7 @@ void cmc623_Mode_Change_Compare(mDNIe_data_type *mode, int cabc_enable)
 		if(cabc_enable)
 		{
 			//CABC brightness setting
-			cmc623_cabc_pwm_brightness_reg(cmc623_state.brightness);
+			cmc623_cabc_pwm_brightness_reg(cmc623_state.brightness, setting_first);
 
 			cmc623_state.cabc_enabled = TRUE;
 		}
@@ -1083,6 +1112,37 @@ void cmc623_Set_Mode_Ext(Lcd_CMC623_UI_mode mode, u8 mDNIe_Outdoor_OnOff)
 EXPORT_SYMBOL(cmc623_Set_Mode_Ext);
 
 
+static void cmc623_shadow_invalidate(void)
+{
+	bitmap_zero(cmc623_shadow_valid, 2 * 256);
+	last_cmc623_Bank = 0xffff;
+}
+
+/* registers that do something when written: sw reset, rgb i/f enable and
+ * the register update mask */
+static int cmc623_reg_volatile(unsigned long bank, u16 reg)
+{
+	return reg == 0x28 || (bank == 0 && (reg == 0x09 || reg == 0x26));
+}
+
+static void cmc623_shadow_update(unsigned long bank, u16 reg, u16 value)
+{
+	if(bank > 1 || reg > 0xff)
+		return;
+
+	cmc623_shadow[bank][reg] = value;
+	set_bit(bank * 256 + reg, cmc623_shadow_valid);
+}
+
+static int cmc623_shadow_match(unsigned long bank, u16 reg, u16 value)
+{
+	if(bank > 1 || reg > 0xff || cmc623_reg_volatile(bank, reg))
+		return FALSE;
+
+	return test_bit(bank * 256 + reg, cmc623_shadow_valid) &&
+		cmc623_shadow[bank][reg] == value;
+}
+
 bool cmc623_I2cWrite16( unsigned char reg, unsigned long value)
 {
 	int ret = 0;
@@ -1126,11 +1186,132 @@ bool cmc623_I2cWrite16( unsigned char reg, unsigned long value)
 	{
 		printk("[CMC623] I2C Write err !!\n");
 //		BUG_ON(ret == -EIO);
+		cmc623_shadow_invalidate();
+	}
+	else if(reg != 0x0000)
+	{
+		cmc623_shadow_update(last_cmc623_Bank, reg, value);
 	}
 
 	return ret;
 }
 
+static int cmc623_batch_flush(void)
+{
+	int ret;
+
+	if(!cmc623_batch_num)
+		return 0;
+
+	ret = omap_gpio_i2c_write_batch(p_cmc623_data, cmc623_batch_param, cmc623_batch_num);
+	cmc623_batch_num = 0;
+
+	return ret;
+}
+
+static int cmc623_batch_add(u16 reg, u16 value)
+{
+	int i = cmc623_batch_num++;
+
+	cmc623_batch_reg[i] = reg;
+	cmc623_batch_data[i][0] = (value >> 8) & 0xFF;
+	cmc623_batch_data[i][1] = value & 0xFF;
+
+	cmc623_batch_param[i].reg_len = 1;
+	cmc623_batch_param[i].reg_addr = &cmc623_batch_reg[i];
+	cmc623_batch_param[i].wdata_len = 2;
+	cmc623_batch_param[i].wdata = cmc623_batch_data[i];
+
+	cmc623_i2c_stats.written++;
+
+	if(cmc623_batch_num == CMC623_BATCH_MAX)
+		return cmc623_batch_flush();
+
+	return 0;
+}
+
+/*
+ * Writes an END_SEQ terminated table, leaving out the registers that
+ * already hold the wanted value, in combined transfers of up to
+ * CMC623_BATCH_MAX registers. A bank switch is only sent in front of a
+ * register that is written, and at the end if the table leaves another
+ * bank selected than the current one.
+ * Called with cmc623_mDnie_mutex held.
+ */
+static int cmc623_I2cWriteTable(const mDNIe_data_type *mode)
+{
+	unsigned long bank = last_cmc623_Bank;
+	unsigned long us;
+	ktime_t start;
+	int ret = 0;
+
+	if(!p_cmc623_data) {
+		printk(KERN_ERR "p_cmc623_data is NULL\n");
+		return -ENODEV;
+	}
+
+	if(TRUE == cmc623_state.suspended)
+		return 0;
+
+	start = ktime_get();
+
+	for( ; mode->addr != END_SEQ; mode++)
+	{
+		if(mode->addr == 0x0000)
+		{
+			bank = mode->data;
+			continue;
+		}
+
+		if(cmc623_shadow_match(bank, mode->addr, mode->data))
+		{
+			cmc623_i2c_stats.skipped++;
+			continue;
+		}
+
+		if(bank != last_cmc623_Bank)
+		{
+			ret = cmc623_batch_add(0x0000, bank);
+			if(ret)
+				break;
+			last_cmc623_Bank = bank;
+		}
+
+		cmc623_shadow_update(bank, mode->addr, mode->data);
+		if(mode->addr == 0x0001)
+			last_cmc623_Algorithm = mode->data;
+
+		ret = cmc623_batch_add(mode->addr, mode->data);
+		if(ret)
+			break;
+	}
+
+	if(!ret && bank != last_cmc623_Bank)
+	{
+		ret = cmc623_batch_add(0x0000, bank);
+		last_cmc623_Bank = bank;
+	}
+
+	if(!ret)
+		ret = cmc623_batch_flush();
+
+	if(ret)
+	{
+		printk("[CMC623] I2C table write err(%d) !!\n", ret);
+		cmc623_batch_num = 0;
+		cmc623_shadow_invalidate();
+		cmc623_i2c_stats.errors++;
+	}
+
+	us = ktime_us_delta(ktime_get(), start);
+	cmc623_i2c_stats.tables++;
+	cmc623_i2c_stats.total_us += us;
+	if(us > cmc623_i2c_stats.max_us)
+		cmc623_i2c_stats.max_us = us;
+
+	return ret;
+}
+
 
 
 int cmc623_I2cRead16(u8 reg, u16 *value)
@@ -2056,94 +2237,61 @@ static int cmc623_tuning_set (void)  // P1_LSJ DE19
 static int cmc623_initial_set (void)  // P1_LSJ DE19
 {
     int ret = 0;
-	u16 vlw_hlw, vbp_vfp, hbp_hfp;
+	mDNIe_data_type init_seq[] = {
+		{0x00, 0x0000},    //BANK 0
+		{0x01, 0x0020},    //algorithm selection
+		{0xb4, 0xC000},    //PWM ratio
+		{0xb3, 0xffff},    //up/down step
+		{0x10, 0x001A},    // PCLK Polarity Sel
+		{0x24, 0x0001},    // Polarity Sel
+		{0x0b, 0x0184},    // Clock Gating
+		{0x0f, 0x0010},     // PWM clock ratio
+		{0x0d, stageClkA},     // A-Stage clk
+		{0x0e, stageClkB},     // B-stage clk
+		{0x22, 0x0400},     // H_Size
+		{0x23, 0x0258},     // V_Size
+		{0x2c, 0x0fff},	//DNR bypass
+		{0x2d, 0x1900},	//DNR bypass
+		{0x2e, 0x0000},	//DNR bypass
+		{0x2f, 0x00ff},	//DNR bypass
+		{0x3a, 0x0000},    //HDTR on DE,
+		{0x00, 0x0001},    //BANK 1
+		{0x09, 0x0400},    // H_Size
+		{0x0a, 0x0258},    // V_Size
+		{0x0b, 0x0400},    // H_Size
+		{0x0c, 0x0258},    // V_Size
+		{0x01, 0x0500},    // BF_Line
+		{0x06, refreshTime},    // Refresh time
+		{0x07, 0x2225},    // eDRAM
+		{0x68, 0x0000},    // TCON Polarity
+		{0x6c, ((LCD_VSW&0xff)<<8)|(LCD_HSW&0xff)},    // VLW,HLW
+		{0x6d, ((LCD_VBP&0xff)<<8)|(LCD_VFP&0xff)},    // VBP,VFP
+		{0x6e, ((LCD_HBP&0xff)<<8)|(LCD_HFP&0xff)},    // HBP,HFP
+		{0x00, 0x0000},
+		{0x28, 0x0000},
+		{0x09, 0x0000},
+		{0x09, 0xffff},
+		{END_SEQ, 0x0000},
+	};
 
     printk("**************************************\n");
     printk("**** < cmc623_initial_set >       *****\n");
     printk("**************************************\n");
 	mutex_lock(&cmc623_mDnie_mutex);
-	vlw_hlw = ((LCD_VSW&0xff)<<8)|(LCD_HSW&0xff);
-	vbp_vfp = ((LCD_VBP&0xff)<<8)|(LCD_VFP&0xff);
-	hbp_hfp = ((LCD_HBP&0xff)<<8)|(LCD_HFP&0xff);
-
-	cmc623_I2cWrite16(0x00, 0x0000);    //BANK 0
-	cmc623_I2cWrite16(0x01, 0x0020);    //algorithm selection
-	cmc623_I2cWrite16(0xb4, 0xC000);    //PWM ratio
-	cmc623_I2cWrite16(0xb3, 0xffff);    //up/down step
-	cmc623_I2cWrite16(0x10, 0x001A);    // PCLK Polarity Sel
-	cmc623_I2cWrite16(0x24, 0x0001);    // Polarity Sel    
-	cmc623_I2cWrite16(0x0b, 0x0184);    // Clock Gating
-//	cmc623_I2cWrite16(0x12, 0x0000);    // Pad strength start
-//	cmc623_I2cWrite16(0x13, 0x0000);
-//	cmc623_I2cWrite16(0x14, 0x0000);
-//	cmc623_I2cWrite16(0x15, 0x0000);
-//	cmc623_I2cWrite16(0x16, 0x0000);
-//	cmc623_I2cWrite16(0x17, 0x0000);
-//	cmc623_I2cWrite16(0x18, 0x0000);
-//	cmc623_I2cWrite16(0x19, 0x0000);     // Pad strength end
-	cmc623_I2cWrite16(0x0f, 0x0010);     // PWM clock ratio
-	cmc623_I2cWrite16(0x0d, stageClkA);     // A-Stage clk
-	cmc623_I2cWrite16(0x0e, stageClkB);     // B-stage clk
-	cmc623_I2cWrite16(0x22, 0x0400);     // H_Size
-	cmc623_I2cWrite16(0x23, 0x0258);     // V_Size
-	cmc623_I2cWrite16(0x2c, 0x0fff);	//DNR bypass
-	cmc623_I2cWrite16(0x2d, 0x1900);	//DNR bypass
-	cmc623_I2cWrite16(0x2e, 0x0000);	//DNR bypass
-	cmc623_I2cWrite16(0x2f, 0x00ff);	//DNR bypass
-	cmc623_I2cWrite16(0x3a, 0x0000);    //HDTR on DE, 
-	cmc623_I2cWrite16(0x00, 0x0001);    //BANK 1
-	cmc623_I2cWrite16(0x09, 0x0400);    // H_Size
-	cmc623_I2cWrite16(0x0a, 0x0258);    // V_Size
-	cmc623_I2cWrite16(0x0b, 0x0400);    // H_Size
-	cmc623_I2cWrite16(0x0c, 0x0258);    // V_Size
-	cmc623_I2cWrite16(0x01, 0x0500);    // BF_Line
-	cmc623_I2cWrite16(0x06, refreshTime);    // Refresh time
-	cmc623_I2cWrite16(0x07, 0x2225);    // eDRAM
-//	cmc623_I2cWrite16(0x65, 0x0008);    // V_Sync cal.
-	cmc623_I2cWrite16(0x68, 0x0000);    // TCON Polarity
-	cmc623_I2cWrite16(0x6c, vlw_hlw);    // VLW,HLW
-	cmc623_I2cWrite16(0x6d, vbp_vfp);    // VBP,VFP
-	cmc623_I2cWrite16(0x6e, hbp_hfp);    // HBP,HFP
-//	cmc623_I2cWrite16(0x20, 0x0000);	//GAMMA	11
-//	cmc623_I2cWrite16(0x21, 0x2000);
-//	cmc623_I2cWrite16(0x22, 0x2000);
-//	cmc623_I2cWrite16(0x23, 0x2000);
-//	cmc623_I2cWrite16(0x24, 0x2000);
-//	cmc623_I2cWrite16(0x25, 0x2000);
-//	cmc623_I2cWrite16(0x26, 0x2000);
-//	cmc623_I2cWrite16(0x27, 0x2000);
-//	cmc623_I2cWrite16(0x28, 0x2000);
-//	cmc623_I2cWrite16(0x29, 0x2000);
-//	cmc623_I2cWrite16(0x2A, 0x2000);
-//	cmc623_I2cWrite16(0x2B, 0x2000);
-//	cmc623_I2cWrite16(0x2C, 0x2000);
-//	cmc623_I2cWrite16(0x2D, 0x2000);
-//	cmc623_I2cWrite16(0x2E, 0x2000);
-//	cmc623_I2cWrite16(0x2F, 0x2000);
-//	cmc623_I2cWrite16(0x30, 0x2000);
-//	cmc623_I2cWrite16(0x31, 0x2000);
-//	cmc623_I2cWrite16(0x32, 0x2000);
-//	cmc623_I2cWrite16(0x33, 0x2000);
-//	cmc623_I2cWrite16(0x34, 0x2000);
-//	cmc623_I2cWrite16(0x35, 0x2000);
-//	cmc623_I2cWrite16(0x36, 0x2000);
-//	cmc623_I2cWrite16(0x37, 0x2000);
-//	cmc623_I2cWrite16(0x38, 0xFF00); 
-//	cmc623_I2cWrite16(0x20, 0x0001);    // GAMMA 11
-	cmc623_I2cWrite16(0x00, 0x0000);
-
-	cmc623_I2cWrite16(0x28, 0x0000);
-	cmc623_I2cWrite16(0x09, 0x0000);
-	cmc623_I2cWrite16(0x09, 0xffff);
+	/* the chip was just reset */
+	cmc623_shadow_invalidate();
+	ret = cmc623_I2cWriteTable(init_seq);
+	mutex_unlock(&cmc623_mDnie_mutex);
 
 	//delay 5ms
-	mdelay(5);
+	msleep(5);
 
+	mutex_lock(&cmc623_mDnie_mutex);
 	cmc623_I2cWrite16(0x26, 0x0001);
 	mutex_unlock(&cmc623_mDnie_mutex);
     printk("**** < end cmc623_initial_set >       *****\n");
 
-	return ret;    
+	return ret;
 }
 
 static void cmc623_set_tuning (void)
@@ -2273,7 +2421,7 @@ static void cmc623_set_tuning (void)
 }
 
 // value: 0 ~ 100
-static void cmc623_cabc_pwm_brightness_reg(int value)
+static void cmc623_cabc_pwm_brightness_reg(int value, int first)
 {
 	u32 reg;
 	unsigned char * p_plut;
@@ -2306,7 +2454,7 @@ static void cmc623_cabc_pwm_brightness_reg(int value)
 		reg = 0x5000 | (value<<4);
 	}
 	
-	if(setting_first)
+	if(first)
 	{
 		reg |= 0x8000;
 	}
@@ -2327,7 +2475,7 @@ static void cmc623_cabc_pwm_brightness(int value)
 	mutex_lock(&cmc623_mDnie_mutex);
 	cmc623_I2cWrite16(0x00,0x0000);	//BANK 0
 
-	cmc623_cabc_pwm_brightness_reg(value);
+	cmc623_cabc_pwm_brightness_reg(value, setting_first);
 
 	cmc623_I2cWrite16(0x28,0x0000);
 	mutex_unlock(&cmc623_mDnie_mutex);
@@ -2587,6 +2735,27 @@ int omap_lcd_set_power(struct lcd_device *ld, int power)
 EXPORT_SYMBOL(omap_lcd_set_power);
 
 
+static void cmc623_resume_work_func(struct work_struct *work)
+{
+	ktime_t start = ktime_get();
+
+	cmc623_state.suspended = FALSE;
+	cmc623_initial_set();
+
+#ifdef CMC623_TUNING
+	cmc623_set_tuning();	//for test
+#endif
+
+	// restore mode & cabc status, the mode table goes out from cabc_work
+	set_bit(0, &cmc623_resync);
+	cmc623_state.brightness = 0;
+	cmc623_cabc_enable(cmc623_state.cabc_enabled);
+
+	msleep(10);
+
+	cmc623_i2c_stats.resume_us = ktime_us_delta(ktime_get(), start);
+}
+
 int tune_cmc623_suspend()
 {
 	int ret;
@@ -2598,6 +2767,9 @@ int tune_cmc623_suspend()
 		return 0;
 		}
 
+	// don't let a pending resume power the chip up again
+	tune_cmc623_resume_sync();
+
 	// 1.2V/1.8V/3.3V may be on
 
 	// CMC623[0x07] := 0x0004
@@ -2705,28 +2877,23 @@ int tune_cmc623_resume()
 	// wait 0.3ms or above
 	mdelay(5);	//udelay(300);
 
-	
-	cmc623_state.suspended = FALSE;
-	// set registers using I2C
-	cmc623_initial_set();
-
-#ifdef CMC623_TUNING
-	cmc623_set_tuning();	//for test
-#endif 
-
-	// restore mode & cabc status
-	setting_first = TRUE;
-	cmc623_state.brightness = 0;
-	cmc623_cabc_enable(cmc623_state.cabc_enabled);
-	setting_first = FALSE;
+	// set registers using I2C while the panel powers up
+	if(ove_wq)
+		queue_work(ove_wq, &cmc623_resume_work);
+	else
+		cmc623_resume_work_func(&cmc623_resume_work);
 
-	mdelay(10);
-	
-	
 	return 0;
 }
 EXPORT_SYMBOL(tune_cmc623_resume);
 
+// waits for the register setup queued by tune_cmc623_resume()
+void tune_cmc623_resume_sync(void)
+{
+	flush_work(&cmc623_resume_work);
+}
+EXPORT_SYMBOL(tune_cmc623_resume_sync);
+
 
 void tune_cmc623_set_lcd_pclk(int pclk)
 {
@@ -2892,6 +3059,22 @@ static ssize_t show_regs_store(struct device *dev, struct device_attribute *attr
 
 static DEVICE_ATTR(show_regs, 0666, show_regs_show, show_regs_store);
 
+static ssize_t i2c_stats_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct cmc623_i2c_stats stats;
+
+	mutex_lock(&cmc623_mDnie_mutex);
+	stats = cmc623_i2c_stats;
+	mutex_unlock(&cmc623_mDnie_mutex);
+
+	return sprintf(buf, "tables %lu\nwritten %lu\nskipped %lu\nerrors %lu\n"
+			"total_us %lu\nmax_us %lu\nresume_us %lu\n",
+			stats.tables, stats.written, stats.skipped, stats.errors,
+			stats.total_us, stats.max_us, stats.resume_us);
+}
+
+static DEVICE_ATTR(i2c_stats, S_IRUGO, i2c_stats_show, NULL);
+
 static ssize_t set_bypass_show(struct device *dev, struct device_attribute *attr, char *buf)
 {
 
@@ -3338,6 +3521,8 @@ static int __devinit cmc623_probe(struct omap_dss_device *dssdev)
 		printk("Failed to create device file!(%s)!\n", dev_attr_show_regs.attr.name);
 		ret = -1;
 	}
+	if (device_create_file(tune_cmc623_dev, &dev_attr_i2c_stats) < 0)
+		printk("Failed to create device file(%s)!\n", dev_attr_i2c_stats.attr.name);
 	if (device_create_file(tune_cmc623_dev, &dev_attr_set_bypass) < 0) {
 		printk("Failed to create device file!(%s)!\n", dev_attr_set_bypass.attr.name);
 		ret = -1;
@@ -3413,7 +3598,8 @@ static int __devinit cmc623_probe(struct omap_dss_device *dssdev)
 	INIT_WORK(&work_ove, ove_workqueue_func);
 
 //	cabc_wq = create_singlethread_workqueue("cabc_wq");
-	INIT_WORK(&cabc_work, cabc_work_func);	
+	INIT_WORK(&cabc_work, cabc_work_func);
+	INIT_WORK(&cmc623_resume_work, cmc623_resume_work_func);
 
     printk("<sec_tune_cmc623_i2c_driver Add END>   \n");
 
@@ -3464,6 +3650,7 @@ static int cmc623_resume(struct omap_dss_device *dssdev)
 	tune_cmc623_pre_resume();
 	tune_cmc623_resume();
 	msleep(120);
+	tune_cmc623_resume_sync();
 
 	/* LCD LDO ON */	
 	//gpio_set_value(OMAP_GPIO_LCD_EN_SET, GPIO_LEVEL_HIGH);
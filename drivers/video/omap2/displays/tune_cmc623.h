@@ -142,6 +142,7 @@ typedef enum
 extern int tune_cmc623_suspend(void);
 extern int tune_cmc623_pre_resume();
 extern int tune_cmc623_resume(void);
+extern void tune_cmc623_resume_sync(void);
 extern void tune_cmc623_set_lcddata(const struct s3cfb_lcd *);
 extern void tune_cmc623_set_lcd_pclk(int pclk);
 extern void cmc623_Set_Mode_Ext(Lcd_CMC623_UI_mode mode, u8 mDNIe_Outdoor_OnOff);
@@ -550,6 +550,10 @@ static int dss_initialize_debugfs(void)
 			&dss_dump_regs, &dss_debug_fops);
 	debugfs_create_file("dispc", S_IRUGO, dss_debugfs_dir,
 			&dispc_dump_regs, &dss_debug_fops);
+	debugfs_create_file("dispc_fifo", S_IRUGO, dss_debugfs_dir,
+			&dispc_dump_fifo, &dss_debug_fops);
+	debugfs_create_file("dispc_fifo_sim", S_IRUGO | S_IWUSR,
+			dss_debugfs_dir, NULL, &dispc_fifo_sim_fops);
 #ifdef CONFIG_OMAP2_DSS_RFBI
 	debugfs_create_file("rfbi", S_IRUGO, dss_debugfs_dir,
 			&rfbi_dump_regs, &dss_debug_fops);
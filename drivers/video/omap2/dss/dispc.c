@@ -32,6 +32,11 @@
 #include <linux/delay.h>
 #include <linux/workqueue.h>
 #include <linux/hardirq.h>
+#include <linux/module.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/mutex.h>
+#include <linux/uaccess.h>
 
 #include <plat/sram.h>
 #include <plat/clock.h>
@@ -344,6 +349,14 @@ static struct {
 
 	u32	fifo_size[DISPC_NUM_PIPELINES];
 
+	/* FIFO underflows per plane, and the extra latency margin (in %)
+	 * they earned for the following threshold calculations */
+	u32	fifo_underflows[DISPC_NUM_PIPELINES];
+	u32	fifo_margin[DISPC_NUM_PIPELINES];
+	unsigned long fifo_margin_time[DISPC_NUM_PIPELINES];
+
+	struct clk *l3_clk;
+
 	spinlock_t irq_lock;
 	u32 irq_error_mask;
 	struct omap_dispc_isr_data registered_isr[DISPC_MAX_NR_ISRS];
@@ -1954,6 +1967,148 @@ void dispc_enable_fifomerge(bool enable)
 	enable_clocks(0);
 }
 
+void dispc_set_plane_preload(enum omap_plane plane, u32 preload)
+{
+	struct dispc_reg preload_reg[4] = { DISPC_GFX_PRELOAD,
+					    DISPC_VID_PRELOAD(0),
+					    DISPC_VID_PRELOAD(1),
+					    DISPC_VID_VID3_PRELOAD };
+
+	if (cpu_is_omap24xx() || plane > OMAP_DSS_VIDEO3)
+		return;
+
+	enable_clocks(1);
+	dispc_write_reg(preload_reg[plane], FLD_VAL(preload, 11, 0));
+	enable_clocks(0);
+}
+
+static bool fifo_calc = true;
+module_param(fifo_calc, bool, 0644);
+MODULE_PARM_DESC(fifo_calc, "Compute the DISPC FIFO thresholds from the "
+		"plane bandwidth instead of keeping the FIFOs full");
+
+/* worst case refill latency seen by DISPC, in L3 clock cycles */
+static unsigned fifo_latency_cycles = 400;
+module_param(fifo_latency_cycles, uint, 0644);
+
+/* margin added to the latency, in % */
+static unsigned fifo_margin = 50;
+module_param(fifo_margin, uint, 0644);
+
+/*
+ * Thresholds stay programmed while the L3 governor moves between OPPs,
+ * so they are sized for the slowest L3 rate it may pick.
+ */
+#define DISPC_FIFO_L3_MIN_RATE	100000000	/* L3 at OPP50 */
+
+/* an underflow-free plane gives back some of its learnt margin */
+#define DISPC_FIFO_MARGIN_STEP		25
+#define DISPC_FIFO_MARGIN_DECAY		(10 * HZ)
+
+/*
+ * The FIFO drains at pixel clock * bytes per pixel, times the
+ * downscaling ratio, and a refill has to arrive within the L3 latency
+ * before it runs dry. The low threshold covers that plus a burst, so
+ * everything above it can be fetched in long runs. VRFB rotated fetches
+ * open a new SDRAM page every few pixels and count double latency.
+ *
+ * Returns -ENOSPC if the plane does not fit its FIFO, the thresholds are
+ * then the conservative full FIFO ones.
+ */
+int dispc_calc_fifo_thresholds(enum omap_plane plane, u32 fifo_size,
+		struct dispc_fifo_config *cfg)
+{
+	unsigned burst_size_bytes;
+	unsigned long l3_rate;
+	u64 drain, need;
+	u32 latency_ns;
+
+	cfg->burst_size = OMAP_DSS_BURST_16x32;
+	if (cpu_is_omap44xx())
+		burst_size_bytes = 8 * 128 / 8;
+	else
+		burst_size_bytes = 16 * 32 / 8;
+
+	cfg->fifo_high = fifo_size - 1;
+	cfg->fifo_low = fifo_size - burst_size_bytes;
+	cfg->preload = min(cfg->fifo_high, 0xfffu);
+	cfg->drain_rate = 0;
+	cfg->latency_ns = 0;
+
+	if (!fifo_calc) {
+		cfg->preload = 0;
+		return 0;
+	}
+
+	drain = (u64)cfg->pclk * cfg->bpp / 8;
+	if (cfg->out_width && cfg->out_height) {
+		drain = div_u64(drain * cfg->in_width, cfg->out_width);
+		if (cfg->in_height > cfg->out_height)
+			drain = div_u64(drain * cfg->in_height,
+					cfg->out_height);
+	}
+
+	l3_rate = cfg->l3_rate;
+	if (!l3_rate) {
+		l3_rate = DISPC_FIFO_L3_MIN_RATE;
+		if (dispc.l3_clk)
+			l3_rate = min(l3_rate, clk_get_rate(dispc.l3_clk));
+	}
+	if (!l3_rate)
+		l3_rate = DISPC_FIFO_L3_MIN_RATE;
+
+	if (dispc.fifo_margin[plane] &&
+			time_after(jiffies, dispc.fifo_margin_time[plane] +
+				DISPC_FIFO_MARGIN_DECAY)) {
+		dispc.fifo_margin[plane] -= min_t(u32, dispc.fifo_margin[plane],
+				DISPC_FIFO_MARGIN_STEP);
+		dispc.fifo_margin_time[plane] = jiffies;
+	}
+
+	latency_ns = div_u64((u64)fifo_latency_cycles * NSEC_PER_SEC,
+			l3_rate);
+	if (cfg->rotated)
+		latency_ns *= 2;
+	latency_ns += latency_ns * (fifo_margin + dispc.fifo_margin[plane]) /
+		100;
+
+	need = div_u64(drain * latency_ns, NSEC_PER_SEC) + burst_size_bytes;
+	need = roundup(need, burst_size_bytes);
+
+	cfg->drain_rate = div_u64(drain, 1000);
+	cfg->latency_ns = latency_ns;
+
+	if (need > fifo_size - burst_size_bytes)
+		return -ENOSPC;
+
+	cfg->fifo_low = need;
+
+	return 0;
+}
+
+static void dispc_count_underflows(u32 irqstatus)
+{
+	static const u32 underflow_irq[] = {
+		DISPC_IRQ_GFX_FIFO_UNDERFLOW,
+		DISPC_IRQ_VID1_FIFO_UNDERFLOW,
+		DISPC_IRQ_VID2_FIFO_UNDERFLOW,
+		DISPC_IRQ_VID3_FIFO_UNDERFLOW,
+	};
+	int plane;
+
+	for (plane = 0; plane < min_t(int, ARRAY_SIZE(underflow_irq),
+				DISPC_NUM_PIPELINES); ++plane) {
+		if (!(irqstatus & underflow_irq[plane]))
+			continue;
+
+		dispc.fifo_underflows[plane]++;
+		/* be more careful with this plane for a while */
+		if (dispc.fifo_margin[plane] < 200)
+			dispc.fifo_margin[plane] += DISPC_FIFO_MARGIN_STEP;
+		dispc.fifo_margin_time[plane] = jiffies;
+	}
+}
+
 static void _dispc_set_fir(enum omap_plane plane, int hinc, int vinc)
 {
 	u32 val;
@@ -2460,7 +2615,7 @@ static void _dispc_set_rotation_attrs(enum omap_plane plane, u8 rotation,
 	}
 }
 
-static int color_mode_to_bpp(enum omap_color_mode color_mode)
+int dispc_color_mode_to_bpp(enum omap_color_mode color_mode)
 {
 	switch (color_mode) {
 	case OMAP_DSS_COLOR_CLUT1:
@@ -2605,7 +2760,7 @@ static void calc_vrfb_rotation_offset(u8 rotation, bool mirror,
 		ps = 4;
 		break;
 	default:
-		ps = color_mode_to_bpp(color_mode) / 8;
+		ps = dispc_color_mode_to_bpp(color_mode) / 8;
 		break;
 	}
 
@@ -2685,7 +2840,7 @@ static void calc_dma_rotation_offset(u8 rotation, bool mirror,
 	case OMAP_DSS_COLOR_CLUT8:
 		return;
 	default:
-		ps = color_mode_to_bpp(color_mode) / 8;
+		ps = dispc_color_mode_to_bpp(color_mode) / 8;
 		break;
 	}
 
@@ -2908,7 +3063,7 @@ int dispc_scaling_decision(u16 width, u16 height,
 				u16 *x_decim, u16 *y_decim, bool *three_tap)
 {
 	int maxdownscale = cpu_is_omap24xx() ? 2 : 4;
-	int bpp = color_mode_to_bpp(color_mode);
+	int bpp = dispc_color_mode_to_bpp(color_mode);
 
 	/*
 	 * For now only whole byte formats on OMAP4 can be predecimated.
@@ -3265,7 +3420,7 @@ static int _dispc_setup_plane(enum omap_plane plane,
 
 	if (rotation_type == OMAP_DSS_ROT_TILER) {
 #ifdef CONFIG_TILER_OMAP
-		int bpp = color_mode_to_bpp(color_mode) / 8;
+		int bpp = dispc_color_mode_to_bpp(color_mode) / 8;
 		struct tiler_view_orient orient = {0};
 		unsigned long tiler_width = width, tiler_height = height;
 		u8 mir_x = 0, mir_y = 0;
@@ -4202,6 +4357,152 @@ void dispc_dump_irqs(struct seq_file *s)
 }
 #endif
 
+void dispc_dump_fifo(struct seq_file *s)
+{
+	struct dispc_reg ftrs_reg[4] = { DISPC_GFX_FIFO_THRESHOLD,
+					 DISPC_VID_FIFO_THRESHOLD(0),
+					 DISPC_VID_FIFO_THRESHOLD(1),
+					 DISPC_VID_V3_WB_BUF_THRESHOLD(0) };
+	struct dispc_reg preload_reg[4] = { DISPC_GFX_PRELOAD,
+					    DISPC_VID_PRELOAD(0),
+					    DISPC_VID_PRELOAD(1),
+					    DISPC_VID_VID3_PRELOAD };
+	int num_planes = cpu_is_omap44xx() ? 4 : 3;
+	int plane;
+	u32 l;
+
+	enable_clocks(1);
+
+	seq_printf(s, "fifo_calc %d, latency %u L3 cycles, margin %u%%\n",
+			fifo_calc, fifo_latency_cycles, fifo_margin);
+	if (dispc.l3_clk)
+		seq_printf(s, "l3 %lu Hz\n", clk_get_rate(dispc.l3_clk));
+
+	seq_printf(s, "%-6s %6s %6s %6s %8s %11s %7s\n", "plane", "size",
+			"low", "high", "preload", "underflows", "margin");
+
+	for (plane = 0; plane < num_planes; ++plane) {
+		l = dispc_read_reg(ftrs_reg[plane]);
+		seq_printf(s, "%-6d %6u %6u %6u %8u %11u %6u%%\n", plane,
+				dispc.fifo_size[plane],
+				cpu_is_omap44xx() ? FLD_GET(l, 15, 0) :
+					FLD_GET(l, 11, 0),
+				cpu_is_omap44xx() ? FLD_GET(l, 31, 16) :
+					FLD_GET(l, 27, 16),
+				REG_GET(preload_reg[plane], 11, 0),
+				dispc.fifo_underflows[plane],
+				dispc.fifo_margin[plane]);
+	}
+
+	enable_clocks(0);
+}
+
+#if defined(CONFIG_DEBUG_FS) && defined(CONFIG_OMAP2_DSS_DEBUG_SUPPORT)
+/*
+ * FIFO threshold simulation: write
+ *   plane pclk_khz bpp in_w in_h out_w out_h rotated l3_mhz [fifo_size]
+ * and read back what the calculator makes of it. Nothing is programmed,
+ * so any configuration can be checked without setting it up.
+ */
+static struct {
+	struct mutex lock;
+	bool valid;
+	int plane;
+	u32 fifo_size;
+	int r;
+	struct dispc_fifo_config cfg;
+} fifo_sim = {
+	.lock = __MUTEX_INITIALIZER(fifo_sim.lock),
+};
+
+static int dispc_fifo_sim_show(struct seq_file *s, void *unused)
+{
+	struct dispc_fifo_config *cfg = &fifo_sim.cfg;
+
+	mutex_lock(&fifo_sim.lock);
+
+	if (!fifo_sim.valid) {
+		seq_printf(s, "plane pclk_khz bpp in_w in_h out_w out_h "
+				"rotated l3_mhz [fifo_size]\n");
+		goto out;
+	}
+
+	seq_printf(s, "plane %d fifo %u pclk %lu bpp %d in %ux%u out %ux%u "
+			"rotated %d l3 %lu\n", fifo_sim.plane,
+			fifo_sim.fifo_size, cfg->pclk, cfg->bpp,
+			cfg->in_width, cfg->in_height,
+			cfg->out_width, cfg->out_height,
+			cfg->rotated, cfg->l3_rate);
+	seq_printf(s, "drain %u bytes/ms latency %u ns\n",
+			cfg->drain_rate, cfg->latency_ns);
+	seq_printf(s, "low %u high %u preload %u%s\n",
+			cfg->fifo_low, cfg->fifo_high, cfg->preload,
+			fifo_sim.r ? " (does not fit, would underflow)" : "");
+out:
+	mutex_unlock(&fifo_sim.lock);
+
+	return 0;
+}
+
+static int dispc_fifo_sim_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dispc_fifo_sim_show, NULL);
+}
+
+static ssize_t dispc_fifo_sim_write(struct file *file,
+		const char __user *ubuf, size_t count, loff_t *ppos)
+{
+	struct dispc_fifo_config cfg;
+	unsigned long pclk_khz, l3_mhz;
+	unsigned in_w, in_h, out_w, out_h;
+	int plane, rotated;
+	u32 fifo_size = 0;
+	char buf[128];
+	int n;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = 0;
+
+	n = sscanf(buf, "%d %lu %d %u %u %u %u %d %lu %u", &plane, &pclk_khz,
+			&cfg.bpp, &in_w, &in_h, &out_w, &out_h, &rotated,
+			&l3_mhz, &fifo_size);
+	if (n < 9 || plane < 0 || plane >= DISPC_NUM_PIPELINES)
+		return -EINVAL;
+
+	if (!fifo_size)
+		fifo_size = dispc.fifo_size[plane];
+
+	cfg.pclk = pclk_khz * 1000;
+	cfg.in_width = in_w;
+	cfg.in_height = in_h;
+	cfg.out_width = out_w;
+	cfg.out_height = out_h;
+	cfg.rotated = rotated;
+	cfg.l3_rate = l3_mhz * 1000000;
+
+	mutex_lock(&fifo_sim.lock);
+	fifo_sim.r = dispc_calc_fifo_thresholds(plane, fifo_size, &cfg);
+	fifo_sim.cfg = cfg;
+	fifo_sim.plane = plane;
+	fifo_sim.fifo_size = fifo_size;
+	fifo_sim.valid = true;
+	mutex_unlock(&fifo_sim.lock);
+
+	return count;
+}
+
+const struct file_operations dispc_fifo_sim_fops = {
+	.open           = dispc_fifo_sim_open,
+	.read           = seq_read,
+	.write          = dispc_fifo_sim_write,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+#endif
+
 void dispc_dump_regs(struct seq_file *s)
 {
 #define DUMPREG(r) seq_printf(s, "%-35s %08x\n", #r, dispc_read_reg(r))
@@ -4727,6 +5028,8 @@ void dispc_irq_handler(void)
 	spin_unlock(&dispc.irq_stats_lock);
 #endif
 
+	dispc_count_underflows(irqstatus);
+
 #ifdef DEBUG
 	if (dss_debug)
 		print_irq_status(irqstatus);
@@ -5144,6 +5447,11 @@ int dispc_init(struct platform_device *pdev)
 #endif
 
 	INIT_WORK(&dispc.error_work, dispc_error_worker);
+
+	dispc.l3_clk = clk_get(NULL, cpu_is_omap44xx() ? "l3_div_ck" : "l3_ick");
+	if (IS_ERR(dispc.l3_clk))
+		dispc.l3_clk = NULL;
+
 	if (cpu_is_omap44xx())
 		dispc_mem = platform_get_resource(pdev, IORESOURCE_MEM, 1);
 	else
@@ -5179,6 +5487,8 @@ int dispc_init(struct platform_device *pdev)
 
 void dispc_exit(void)
 {
+	if (dispc.l3_clk)
+		clk_put(dispc.l3_clk);
 	iounmap(dispc.base);
 }
 
@@ -32,11 +32,15 @@
 
 #include <plat/display.h>
 #include <plat/cpu.h>
+#include <plat/omap-pm.h>
 
 #include "dss.h"
 
 static struct {
 	struct regulator *vdds_dsi_reg;
+
+	/* pixel clock divider for the panel rate */
+	u16 pck_div;
 } dpi;
 
 #ifdef CONFIG_OMAP2_DSS_USE_DSI_PLL
@@ -129,6 +133,7 @@ static int dpi_set_dispc_clk(enum omap_channel channel,
 static int dpi_set_mode(struct omap_dss_device *dssdev)
 {
 	struct omap_video_timings *t = &dssdev->panel.timings;
+	struct dispc_clock_info cinfo;
 	unsigned long pck = 0;
 	unsigned long cache_req_pck = 0;
 	bool is_tft;
@@ -154,6 +159,9 @@ static int dpi_set_mode(struct omap_dss_device *dssdev)
 	if (r)
 		return r;
 
+	dispc_get_clock_div(dssdev->channel, &cinfo);
+	dpi.pck_div = cinfo.pck_div;
+
 	pck /= 1000;
 
 	if (pck != t->pixel_clock) {
@@ -239,6 +247,14 @@ int omapdss_dpi_display_enable(struct omap_dss_device *dssdev)
 
 	mdelay(2);
 
+	/*
+	 * Scanout of one full-screen 32bpp layer: pixel clock (kHz) times
+	 * 4 bytes.  Lets the L3 governor keep enough headroom for the
+	 * DISPC FIFO instead of relying on a fixed worst-case OPP.
+	 */
+	omap_pm_set_min_bus_tput(&dssdev->dev, OCP_INITIATOR_AGENT,
+				 dssdev->panel.timings.pixel_clock * 4);
+
 	if (dssdev->manager) {
 		if (cpu_is_omap44xx())
 			dpi_start_auto_update(dssdev);
@@ -291,6 +307,8 @@ void omapdss_dpi_display_disable(struct omap_dss_device *dssdev)
 	if (cpu_is_omap34xx() && !cpu_is_omap3630())
 		regulator_disable(dpi.vdds_dsi_reg);
 
+	omap_pm_set_min_bus_tput(&dssdev->dev, OCP_INITIATOR_AGENT, -1);
+
 	omap_dss_stop_device(dssdev);
 }
 EXPORT_SYMBOL(omapdss_dpi_display_disable);
@@ -307,6 +325,45 @@ void dpi_set_timings(struct omap_dss_device *dssdev,
 }
 EXPORT_SYMBOL(dpi_set_timings);
 
+/*
+ * Scan out at about pixel_clock kHz, or at the panel rate if 0. Only the
+ * pixel clock divider changes, so this is safe while the panel is on.
+ */
+int dpi_set_idle_pixel_clock(struct omap_dss_device *dssdev, int pixel_clock)
+{
+	struct dispc_clock_info cinfo;
+	unsigned long pck_div;
+	int r;
+
+	if (dssdev->state != OMAP_DSS_DISPLAY_ACTIVE)
+		return -EINVAL;
+
+	pck_div = dpi.pck_div;
+	if (pixel_clock > 0 && pixel_clock < dssdev->panel.timings.pixel_clock)
+		pck_div = min(255UL, pck_div *
+				dssdev->panel.timings.pixel_clock / pixel_clock);
+
+	dispc_get_clock_div(dssdev->channel, &cinfo);
+	if (cinfo.pck_div == pck_div)
+		return 0;
+
+	cinfo.pck_div = pck_div;
+	r = dispc_calc_clock_rates(dispc_fclk_rate(), &cinfo);
+	if (r)
+		return r;
+
+	DSSDBG("pck %lu kHz\n", cinfo.pck / 1000);
+
+	dispc_set_clock_div(dssdev->channel, &cinfo);
+
+	/* a pending GO latches the divider as well */
+	if (!dispc_go_busy(dssdev->channel))
+		dispc_go(dssdev->channel);
+
+	return 0;
+}
+EXPORT_SYMBOL(dpi_set_idle_pixel_clock);
+
 int dpi_check_timings(struct omap_dss_device *dssdev,
 			struct omap_video_timings *timings)
 {
@@ -262,6 +262,8 @@ void dss_start_update(struct omap_dss_device *dssdev);
 void dss_init_overlays(struct platform_device *pdev);
 void dss_uninit_overlays(struct platform_device *pdev);
 int dss_check_overlay(struct omap_overlay *ovl, struct omap_dss_device *dssdev);
+int dss_check_overlay_info(struct omap_overlay *ovl,
+		struct omap_overlay_info *info, struct omap_dss_device *dssdev);
 void dss_overlay_setup_dispc_manager(struct omap_overlay_manager *mgr);
 #ifdef L4_EXAMPLE
 void dss_overlay_setup_l4_manager(struct omap_overlay_manager *mgr);
@@ -409,6 +411,8 @@ void dispc_exit(void);
 void dispc_dump_clocks(struct seq_file *s);
 void dispc_dump_irqs(struct seq_file *s);
 void dispc_dump_regs(struct seq_file *s);
+void dispc_dump_fifo(struct seq_file *s);
+extern const struct file_operations dispc_fifo_sim_fops;
 void dispc_irq_handler(void);
 void dispc_fake_vsync_irq(enum omap_dsi_index ix);
 
@@ -429,8 +433,31 @@ void dispc_set_tv_divisor(void);
 #endif
 void dispc_set_digit_size(u16 width, u16 height);
 u32 dispc_get_plane_fifo_size(enum omap_plane plane);
+int dispc_color_mode_to_bpp(enum omap_color_mode color_mode);
 void dispc_setup_plane_fifo(enum omap_plane plane, u32 low, u32 high);
+void dispc_set_plane_preload(enum omap_plane plane, u32 preload);
 void dispc_enable_fifomerge(bool enable);
+
+/* FIFO threshold calculation for one plane */
+struct dispc_fifo_config {
+	/* what the plane scans out */
+	unsigned long pclk;		/* Hz */
+	int bpp;
+	u16 in_width, in_height;
+	u16 out_width, out_height;	/* 0: not scaled */
+	bool rotated;			/* 90/270 through VRFB */
+	unsigned long l3_rate;		/* Hz, 0: the slowest L3 OPP */
+
+	/* results */
+	enum omap_burst_size burst_size;
+	u32 fifo_low, fifo_high;
+	u32 preload;			/* 0: leave as is */
+	u32 drain_rate;			/* bytes per ms */
+	u32 latency_ns;
+};
+
+int dispc_calc_fifo_thresholds(enum omap_plane plane, u32 fifo_size,
+		struct dispc_fifo_config *cfg);
 void dispc_set_burst_size(enum omap_plane plane,
 		enum omap_burst_size burst_size);
 void dispc_set_zorder(enum omap_plane plane,
@@ -28,6 +28,9 @@
 #include <linux/platform_device.h>
 #include <linux/spinlock.h>
 #include <linux/jiffies.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/math64.h>
 
 #include <plat/display.h>
 #include <plat/cpu.h>
@@ -276,6 +279,13 @@ static ssize_t manager_alpha_blending_enabled_store(
 	return size;
 }
 
+static ssize_t manager_idle_timeout_show(struct omap_overlay_manager *mgr,
+		char *buf);
+static ssize_t manager_idle_timeout_store(struct omap_overlay_manager *mgr,
+		const char *buf, size_t size);
+static ssize_t manager_idle_stats_show(struct omap_overlay_manager *mgr,
+		char *buf);
+
 struct manager_attribute {
 	struct attribute attr;
 	ssize_t (*show)(struct omap_overlay_manager *, char *);
@@ -301,6 +311,9 @@ static MANAGER_ATTR(trans_key_enabled, S_IRUGO|S_IWUSR,
 static MANAGER_ATTR(alpha_blending_enabled, S_IRUGO|S_IWUSR,
 		manager_alpha_blending_enabled_show,
 		manager_alpha_blending_enabled_store);
+static MANAGER_ATTR(idle_timeout_ms, S_IRUGO|S_IWUSR,
+		manager_idle_timeout_show, manager_idle_timeout_store);
+static MANAGER_ATTR(idle_stats, S_IRUGO, manager_idle_stats_show, NULL);
 
 
 static struct attribute *manager_sysfs_attrs[] = {
@@ -311,6 +324,8 @@ static struct attribute *manager_sysfs_attrs[] = {
 	&manager_attr_trans_key_value.attr,
 	&manager_attr_trans_key_enabled.attr,
 	&manager_attr_alpha_blending_enabled.attr,
+	&manager_attr_idle_timeout_ms.attr,
+	&manager_attr_idle_stats.attr,
 	NULL
 };
 
@@ -417,6 +432,7 @@ struct overlay_cache_data {
 	enum omap_burst_size burst_size;
 	u32 fifo_low;
 	u32 fifo_high;
+	u32 fifo_preload;
 
 	bool manual_update;
 	enum omap_overlay_zorder zorder;
@@ -453,15 +469,71 @@ struct manager_cache_data {
 	bool enlarge_update_area;
 };
 
+/* Commits waiting for, or on their way to, the shadow registers */
+#define DSS_COMMIT_QUEUE_DEPTH	2
+
+struct dss_commit_entry {
+	struct omap_dss_commit *commit;
+
+	u32 ovl_mask;
+	struct overlay_cache_data overlay_cache[4];
+
+	bool set_mgr_info;
+	struct omap_overlay_manager_info mgr_info;
+};
+
+struct dss_commit_queue {
+	struct dss_commit_entry entry[DSS_COMMIT_QUEUE_DEPTH];
+	int head;	/* oldest entry, the one in dss_cache */
+	int count;
+};
+
 static struct {
 	spinlock_t lock;
 	struct overlay_cache_data overlay_cache[4];
 	struct manager_cache_data manager_cache[3];
 	struct writeback_cache_data writeback_cache;
 
+	struct dss_commit_queue commit_queue[3];
+	/* color conversion of committed overlays, the commit may be gone */
+	struct omap_dss_yuv2rgb_conv yuv2rgb_conv[4];
+
 	bool irq_enabled;
 } dss_cache;
 
+/*
+ * Auto update displays scan out every frame, changed or not. After
+ * idle_timeout_ms without a new frame the display driver may lower the
+ * refresh rate, and the overlay FIFOs are refilled in long bursts so
+ * that the SDRAM gets longer breaks.
+ */
+struct dss_idle_data {
+	struct omap_overlay_manager *mgr;
+	struct delayed_work idle_work;
+	struct work_struct wake_work;
+	/* serializes the driver set_idle() calls */
+	struct mutex lock;
+
+	/* the rest is protected by dss_cache.lock */
+	bool enabled;
+	bool idle;
+	u32 timeout_ms;
+	unsigned long last_activity;
+
+	/* scanout estimates, from the frame size and the refresh rate */
+	unsigned long refresh_mhz;
+	unsigned long full_refresh_mhz;
+	unsigned long last_account;
+	u64 active_ms;
+	u64 idle_ms;
+	u64 scanout_bytes;
+	u64 saved_bytes;
+	u64 dirty_rects;
+	u64 dirty_pixels;
+};
+
+static struct dss_idle_data dss_idle[3];
+
 
 
 static int omap_dss_set_device(struct omap_overlay_manager *mgr,
@@ -912,6 +984,8 @@ static int configure_overlay(enum omap_plane plane)
 	dispc_set_zorder(plane, c->zorder);
 	dispc_enable_zorder(plane, 1);
 	dispc_setup_plane_fifo(plane, c->fifo_low, c->fifo_high);
+	if (c->fifo_preload)
+		dispc_set_plane_preload(plane, c->fifo_preload);
 
 	if (source_of_wb && wb->dirty) {
 		/* writeback is enabled for this plane - set accordingly */
@@ -1258,6 +1332,236 @@ void dss_start_update(struct omap_dss_device *dssdev)
 	dssdev->manager->enable(dssdev->manager);
 }
 
+static void dss_ovl_fill_cache(struct omap_overlay *ovl,
+		struct omap_overlay_info *info, struct omap_dss_device *dssdev,
+		struct overlay_cache_data *oc)
+{
+	oc->paddr = info->paddr;
+	oc->p_uv_addr = info->p_uv_addr;
+	oc->vaddr = info->vaddr;
+	oc->screen_width = info->screen_width;
+	oc->width = info->width;
+	oc->height = info->height;
+	oc->pic_height = info->pic_height;
+	oc->color_mode = info->color_mode;
+
+	if (info->yuv2rgb_conv.dirty)
+		oc->yuv2rgb_conv = &info->yuv2rgb_conv;
+
+	oc->rotation = info->rotation;
+	oc->rotation_type = info->rotation_type;
+	oc->mirror = info->mirror;
+	oc->pos_x = info->pos_x;
+	oc->pos_y = info->pos_y;
+	oc->out_width = info->out_width;
+	oc->out_height = info->out_height;
+	oc->global_alpha = info->global_alpha;
+	oc->min_x_decim = info->min_x_decim;
+	oc->max_x_decim = info->max_x_decim;
+	oc->min_y_decim = info->min_y_decim;
+	oc->max_y_decim = info->max_y_decim;
+	oc->zorder = info->zorder;
+
+	oc->replication =
+		dss_use_replication(dssdev, info->color_mode);
+
+	oc->ilace = info->field;
+
+	oc->channel = ovl->manager->id;
+
+	oc->enabled = true;
+
+	oc->manual_update = dssdev_manually_updated(dssdev);
+}
+
+/* FIFO thresholds for what the overlay actually scans out */
+static void dss_ovl_calc_fifo(struct omap_overlay *ovl,
+		struct omap_dss_device *dssdev, u32 size,
+		struct overlay_cache_data *oc)
+{
+	struct dispc_fifo_config cfg;
+
+	cfg.pclk = dssdev->panel.timings.pixel_clock * 1000;
+	cfg.bpp = dispc_color_mode_to_bpp(oc->color_mode);
+	cfg.in_width = oc->width;
+	cfg.in_height = oc->height;
+	cfg.out_width = oc->out_width ? oc->out_width : oc->width;
+	cfg.out_height = oc->out_height ? oc->out_height : oc->height;
+	cfg.rotated = oc->rotation_type == OMAP_DSS_ROT_VRFB &&
+		(oc->rotation & 1);
+	cfg.l3_rate = 0;
+
+	if (dispc_calc_fifo_thresholds(ovl->id, size, &cfg))
+		DSSDBG("ovl %d: %u bytes/ms do not fit the FIFO\n",
+				ovl->id, cfg.drain_rate);
+
+	oc->burst_size = cfg.burst_size;
+	oc->fifo_low = cfg.fifo_low;
+	oc->fifo_high = cfg.fifo_high;
+	oc->fifo_preload = cfg.preload;
+}
+
+static void dss_ovl_fill_fifo(struct omap_overlay *ovl,
+		struct omap_dss_device *dssdev, u32 size,
+		struct overlay_cache_data *oc)
+{
+	oc->fifo_preload = 0;
+
+	switch (dssdev->type) {
+	case OMAP_DISPLAY_TYPE_DPI:
+	case OMAP_DISPLAY_TYPE_DBI:
+	case OMAP_DISPLAY_TYPE_SDI:
+	case OMAP_DISPLAY_TYPE_VENC:
+	case OMAP_DISPLAY_TYPE_HDMI:
+		dss_ovl_calc_fifo(ovl, dssdev, size, oc);
+		break;
+#ifdef CONFIG_OMAP2_DSS_DSI
+	case OMAP_DISPLAY_TYPE_DSI:
+		dsi_get_overlay_fifo_thresholds(ovl->id, size,
+				&oc->burst_size, &oc->fifo_low,
+				&oc->fifo_high);
+		break;
+#endif
+	default:
+		BUG();
+	}
+
+	/* a slowly scanned out static frame leaves plenty of time to
+	 * refill, so let the FIFO drain to half before fetching again */
+	if (dss_idle[oc->channel].idle)
+		oc->fifo_low = min(oc->fifo_low, size / 2);
+}
+
+static void dss_mgr_fill_cache(struct omap_overlay_manager_info *info,
+		struct manager_cache_data *mc)
+{
+	mc->default_color = info->default_color;
+	mc->trans_key_type = info->trans_key_type;
+	mc->trans_key = info->trans_key;
+	mc->trans_enabled = info->trans_enabled;
+	mc->alpha_enabled = info->alpha_enabled;
+}
+
+/* Bytes fetched per frame by the enabled overlays of the channel */
+static u64 dss_mgr_frame_bytes(int channel)
+{
+	struct overlay_cache_data *oc;
+	u64 bytes = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(dss_cache.overlay_cache); ++i) {
+		oc = &dss_cache.overlay_cache[i];
+		if (!oc->enabled || oc->channel != channel)
+			continue;
+
+		bytes += (u64)oc->width * oc->height *
+			dispc_color_mode_to_bpp(oc->color_mode) / 8;
+	}
+
+	return bytes;
+}
+
+/* dss_cache.lock has to be held */
+static void dss_idle_account(struct dss_idle_data *d)
+{
+	unsigned long now = jiffies;
+	u64 ms, frame;
+
+	ms = jiffies_to_msecs(now - d->last_account);
+	d->last_account = now;
+
+	if (!d->enabled)
+		return;
+
+	if (d->idle)
+		d->idle_ms += ms;
+	else
+		d->active_ms += ms;
+
+	frame = dss_mgr_frame_bytes(d->mgr->id);
+	d->scanout_bytes += div_u64(frame * d->refresh_mhz * ms, 1000000);
+	d->saved_bytes += div_u64(frame *
+			(d->full_refresh_mhz - d->refresh_mhz) * ms, 1000000);
+}
+
+/* A new frame for the channel. dss_cache.lock has to be held */
+static void dss_idle_activity(int channel)
+{
+	struct dss_idle_data *d = &dss_idle[channel];
+
+	if (!d->enabled)
+		return;
+
+	dss_idle_account(d);
+	d->last_activity = jiffies;
+
+	if (d->idle)
+		schedule_work(&d->wake_work);
+	else if (!delayed_work_pending(&d->idle_work))
+		schedule_delayed_work(&d->idle_work,
+				msecs_to_jiffies(d->timeout_ms));
+}
+
+/* Move the oldest queued commit of a manager to dss_cache, to be written
+ * to the shadow registers by configure_dispc(). dss_cache.lock held. */
+static void dss_commit_load(int channel)
+{
+	struct dss_commit_queue *q = &dss_cache.commit_queue[channel];
+	struct dss_commit_entry *e = &q->entry[q->head];
+	struct overlay_cache_data *oc;
+	struct manager_cache_data *mc;
+	bool shadow_dirty;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(dss_cache.overlay_cache); ++i) {
+		if (!(e->ovl_mask & (1 << i)))
+			continue;
+
+		oc = &dss_cache.overlay_cache[i];
+		shadow_dirty = oc->shadow_dirty;
+		*oc = e->overlay_cache[i];
+		oc->dirty = true;
+		oc->shadow_dirty = shadow_dirty;
+
+		if (oc->yuv2rgb_conv) {
+			dss_cache.yuv2rgb_conv[i] = *oc->yuv2rgb_conv;
+			oc->yuv2rgb_conv = &dss_cache.yuv2rgb_conv[i];
+		}
+	}
+
+	if (e->set_mgr_info) {
+		mc = &dss_cache.manager_cache[channel];
+		dss_mgr_fill_cache(&e->mgr_info, mc);
+		mc->dirty = true;
+	}
+}
+
+/* The loaded commit is on screen when the registers of everything it
+ * touched have been latched. dss_cache.lock held. */
+static bool dss_commit_done(int channel)
+{
+	struct dss_commit_queue *q = &dss_cache.commit_queue[channel];
+	struct dss_commit_entry *e = &q->entry[q->head];
+	struct manager_cache_data *mc;
+	struct overlay_cache_data *oc;
+	int i;
+
+	mc = &dss_cache.manager_cache[channel];
+	if (mc->dirty || mc->shadow_dirty)
+		return false;
+
+	for (i = 0; i < ARRAY_SIZE(dss_cache.overlay_cache); ++i) {
+		if (!(e->ovl_mask & (1 << i)))
+			continue;
+
+		oc = &dss_cache.overlay_cache[i];
+		if (oc->dirty || oc->shadow_dirty)
+			return false;
+	}
+
+	return true;
+}
+
 static void dss_apply_irq_handler(void *data, u32 mask)
 {
 	struct manager_cache_data *mc;
@@ -1266,6 +1570,9 @@ static void dss_apply_irq_handler(void *data, u32 mask)
 	const int num_mgrs = MAX_DSS_MANAGERS;
 	int i, r;
 	bool mgr_busy[MAX_DSS_MANAGERS];
+	struct dss_commit_queue *q;
+	struct omap_dss_commit *done[ARRAY_SIZE(dss_cache.commit_queue)];
+	int num_done = 0;
 
 	for (i = 0; i < num_mgrs; i++)
 		mgr_busy[i] = dispc_go_busy(i);
@@ -1284,6 +1591,18 @@ static void dss_apply_irq_handler(void *data, u32 mask)
 			mc->shadow_dirty = false;
 	}
 
+	/* retire commits that made it to the screen, and load the next */
+	for (i = 0; i < num_mgrs; ++i) {
+		q = &dss_cache.commit_queue[i];
+		if (!q->count || !dss_commit_done(i))
+			continue;
+
+		done[num_done++] = q->entry[q->head].commit;
+		q->head = (q->head + 1) % DSS_COMMIT_QUEUE_DEPTH;
+		if (--q->count)
+			dss_commit_load(i);
+	}
+
 	r = configure_dispc();
 	if (r == 1)
 		goto end;
@@ -1295,7 +1614,7 @@ static void dss_apply_irq_handler(void *data, u32 mask)
 	/* keep running as long as there are busy managers, so that
 	 * we can collect overlay-applied information */
 	for (i = 0; i < num_mgrs; ++i) {
-		if (mgr_busy[i])
+		if (mgr_busy[i] || dss_cache.commit_queue[i].count)
 			goto end;
 	}
 
@@ -1307,6 +1626,39 @@ static void dss_apply_irq_handler(void *data, u32 mask)
 
 end:
 	spin_unlock(&dss_cache.lock);
+
+	for (i = 0; i < num_done; ++i)
+		done[i]->callback(done[i], 0);
+}
+
+/* dss_cache.lock has to be held */
+static int dss_cache_enable_irq(void)
+{
+	int r;
+
+	if (dss_cache.irq_enabled)
+		return 0;
+
+	r = omap_dispc_register_isr(dss_apply_irq_handler, NULL,
+			DISPC_IRQ_VSYNC	| DISPC_IRQ_EVSYNC_ODD |
+			DISPC_IRQ_EVSYNC_EVEN |
+			(cpu_is_omap44xx() ? DISPC_IRQ_VSYNC2 : 0));
+	if (r)
+		return r;
+
+	dss_cache.irq_enabled = true;
+
+	return 0;
+}
+
+static int dss_cache_configure(void)
+{
+	int r;
+
+	r = dss_cache_enable_irq();
+	configure_dispc();
+
+	return r;
 }
 
 static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
@@ -1317,6 +1669,7 @@ static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
 	struct omap_overlay *ovl;
 	int num_planes_enabled = 0;
 	bool use_fifomerge;
+	u32 active_mgrs = 0;
 	unsigned long flags;
 	int r;
 	struct writeback_cache_data *wbc;
@@ -1352,6 +1705,7 @@ static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
 			if (oc->enabled) {
 				oc->enabled = false;
 				oc->dirty = true;
+				active_mgrs |= 1 << oc->channel;
 			}
 			continue;
 		}
@@ -1363,6 +1717,7 @@ static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
 		}
 
 		dssdev = ovl->manager->device;
+		active_mgrs |= 1 << ovl->manager->id;
 
 		if (dss_check_overlay(ovl, dssdev)) {
 			if (oc->enabled) {
@@ -1375,42 +1730,7 @@ static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
 		ovl->info_dirty = false;
 		oc->dirty = true;
 
-		oc->paddr = ovl->info.paddr;
-		oc->p_uv_addr = ovl->info.p_uv_addr;
-		oc->vaddr = ovl->info.vaddr;
-		oc->screen_width = ovl->info.screen_width;
-		oc->width = ovl->info.width;
-		oc->height = ovl->info.height;
-		oc->pic_height = ovl->info.pic_height;
-		oc->color_mode = ovl->info.color_mode;
-
-		if (ovl->info.yuv2rgb_conv.dirty)
-			oc->yuv2rgb_conv = &ovl->info.yuv2rgb_conv;
-
-		oc->rotation = ovl->info.rotation;
-		oc->rotation_type = ovl->info.rotation_type;
-		oc->mirror = ovl->info.mirror;
-		oc->pos_x = ovl->info.pos_x;
-		oc->pos_y = ovl->info.pos_y;
-		oc->out_width = ovl->info.out_width;
-		oc->out_height = ovl->info.out_height;
-		oc->global_alpha = ovl->info.global_alpha;
-		oc->min_x_decim = ovl->info.min_x_decim;
-		oc->max_x_decim = ovl->info.max_x_decim;
-		oc->min_y_decim = ovl->info.min_y_decim;
-		oc->max_y_decim = ovl->info.max_y_decim;
-		oc->zorder = ovl->info.zorder;
-
-		oc->replication =
-			dss_use_replication(dssdev, ovl->info.color_mode);
-
-		oc->ilace = ovl->info.field;
-
-		oc->channel = ovl->manager->id;
-
-		oc->enabled = true;
-
-		oc->manual_update = dssdev_manually_updated(dssdev);
+		dss_ovl_fill_cache(ovl, &ovl->info, dssdev, oc);
 
 		++num_planes_enabled;
 	}
@@ -1439,12 +1759,9 @@ static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
 
 		mgr->info_dirty = false;
 		mc->dirty = true;
+		active_mgrs |= 1 << mgr->id;
 
-		mc->default_color = mgr->info.default_color;
-		mc->trans_key_type = mgr->info.trans_key_type;
-		mc->trans_key = mgr->info.trans_key;
-		mc->trans_enabled = mgr->info.trans_enabled;
-		mc->alpha_enabled = mgr->info.alpha_enabled;
+		dss_mgr_fill_cache(&mgr->info, mc);
 
 		mc->manual_upd_display =
 			dssdev->caps & OMAP_DSS_DISPLAY_CAP_MANUAL_UPDATE;
@@ -1493,38 +1810,15 @@ static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
 		if (use_fifomerge)
 			size *= 3;
 
-		switch (dssdev->type) {
-		case OMAP_DISPLAY_TYPE_DPI:
-		case OMAP_DISPLAY_TYPE_DBI:
-		case OMAP_DISPLAY_TYPE_SDI:
-		case OMAP_DISPLAY_TYPE_VENC:
-		case OMAP_DISPLAY_TYPE_HDMI:
-			default_get_overlay_fifo_thresholds(ovl->id, size,
-					&oc->burst_size, &oc->fifo_low,
-					&oc->fifo_high);
-			break;
-#ifdef CONFIG_OMAP2_DSS_DSI
-		case OMAP_DISPLAY_TYPE_DSI:
-			dsi_get_overlay_fifo_thresholds(ovl->id, size,
-					&oc->burst_size, &oc->fifo_low,
-					&oc->fifo_high);
-			break;
-#endif
-		default:
-			BUG();
-		}
+		dss_ovl_fill_fifo(ovl, dssdev, size, oc);
 	}
 
-	r = 0;
-
-	if (!dss_cache.irq_enabled) {
-		r = omap_dispc_register_isr(dss_apply_irq_handler, NULL,
-				DISPC_IRQ_VSYNC	| DISPC_IRQ_EVSYNC_ODD |
-				DISPC_IRQ_EVSYNC_EVEN |
-				(cpu_is_omap44xx() ? DISPC_IRQ_VSYNC2 : 0));
-		dss_cache.irq_enabled = true;
+	for (i = 0; i < MAX_DSS_MANAGERS; ++i) {
+		if (active_mgrs & (1 << i))
+			dss_idle_activity(i);
 	}
-	configure_dispc();
+
+	r = dss_cache_configure();
 
 	spin_unlock_irqrestore(&dss_cache.lock, flags);
 
@@ -1704,18 +1998,23 @@ int omap_dss_wb_flush(void)
 }
 EXPORT_SYMBOL(omap_dss_wb_flush);
 
-static int dss_check_manager(struct omap_overlay_manager *mgr)
+static int dss_check_manager_info(struct omap_overlay_manager_info *info)
 {
 	/* OMAP supports only graphics source transparency color key and alpha
 	 * blending simultaneously. See TRM 15.4.2.4.2.2 Alpha Mode */
 
-	if (mgr->info.alpha_enabled && mgr->info.trans_enabled &&
-			mgr->info.trans_key_type != OMAP_DSS_COLOR_KEY_GFX_DST)
+	if (info->alpha_enabled && info->trans_enabled &&
+			info->trans_key_type != OMAP_DSS_COLOR_KEY_GFX_DST)
 		return -EINVAL;
 
 	return 0;
 }
 
+static int dss_check_manager(struct omap_overlay_manager *mgr)
+{
+	return dss_check_manager_info(&mgr->info);
+}
+
 static int omap_dss_mgr_set_info(struct omap_overlay_manager *mgr,
 		struct omap_overlay_manager_info *info)
 {
@@ -1742,15 +2041,395 @@ static void omap_dss_mgr_get_info(struct omap_overlay_manager *mgr,
 	*info = mgr->info;
 }
 
+/* Queue a commit, to be written to the shadow registers once the
+ * previous one of this manager has been latched. Never sleeps. */
+static int dss_mgr_queue_commit(struct omap_overlay_manager *mgr,
+		struct omap_dss_commit *commit)
+{
+	struct omap_dss_device *dssdev = mgr->device;
+	struct dss_commit_queue *q;
+	struct dss_commit_entry *e;
+	struct overlay_cache_data *oc;
+	struct omap_overlay_info *info;
+	struct omap_overlay *ovl;
+	unsigned long flags;
+	int i, r;
+
+	if (!dssdev || dssdev->state != OMAP_DSS_DISPLAY_ACTIVE)
+		return -ENODEV;
+
+	if (!dss_get_mainclk_state())
+		return -ENODEV;
+
+	/* manual update displays take new settings at the next update,
+	 * there is no vsync to queue for */
+	if (dssdev_manually_updated(dssdev))
+		return -EINVAL;
+
+	if (commit->ovl_mask >> omap_dss_get_num_overlays())
+		return -EINVAL;
+
+	if (commit->set_mgr_info) {
+		r = dss_check_manager_info(&commit->mgr_info);
+		if (r)
+			return r;
+	}
+
+	for (i = 0; i < omap_dss_get_num_overlays(); ++i) {
+		ovl = omap_dss_get_overlay(i);
+
+		if (!(commit->ovl_mask & (1 << ovl->id)))
+			continue;
+
+		if (ovl->manager != mgr ||
+				!(ovl->caps & OMAP_DSS_OVL_CAP_DISPC))
+			return -EINVAL;
+
+		r = dss_check_overlay_info(ovl, &commit->ovl_info[ovl->id],
+				dssdev);
+		if (r)
+			return r;
+	}
+
+	q = &dss_cache.commit_queue[mgr->id];
+
+	spin_lock_irqsave(&dss_cache.lock, flags);
+
+	if (q->count == DSS_COMMIT_QUEUE_DEPTH) {
+		r = -EBUSY;
+		goto out;
+	}
+
+	/* a queued commit is only retired by the vsync handler, so fail
+	 * before queuing if it can't be installed */
+	r = dss_cache_enable_irq();
+	if (r)
+		goto out;
+
+	e = &q->entry[(q->head + q->count) % DSS_COMMIT_QUEUE_DEPTH];
+	memset(e, 0, sizeof(*e));
+	e->commit = commit;
+	e->ovl_mask = commit->ovl_mask;
+
+	for (i = 0; i < omap_dss_get_num_overlays(); ++i) {
+		ovl = omap_dss_get_overlay(i);
+
+		if (!(commit->ovl_mask & (1 << ovl->id)))
+			continue;
+
+		info = &commit->ovl_info[ovl->id];
+		oc = &e->overlay_cache[ovl->id];
+
+		/* keep the get_overlay_info() view in sync */
+		ovl->info = *info;
+		ovl->info_dirty = false;
+
+		oc->channel = mgr->id;
+		if (!info->enabled)
+			continue;
+
+		dss_ovl_fill_cache(ovl, info, dssdev, oc);
+		dss_ovl_fill_fifo(ovl, dssdev,
+				dispc_get_plane_fifo_size(ovl->id), oc);
+	}
+
+	if (commit->set_mgr_info) {
+		e->set_mgr_info = true;
+		e->mgr_info = commit->mgr_info;
+		mgr->info = commit->mgr_info;
+		mgr->info_dirty = false;
+	}
+
+	if (q->count++ == 0)
+		dss_commit_load(mgr->id);
+
+	dss_idle_activity(mgr->id);
+
+	configure_dispc();
+
+out:
+	spin_unlock_irqrestore(&dss_cache.lock, flags);
+
+	return r;
+}
+
+/* Drop the commits that will never reach the screen */
+static void dss_mgr_cancel_commits(struct omap_overlay_manager *mgr)
+{
+	struct dss_commit_queue *q = &dss_cache.commit_queue[mgr->id];
+	struct omap_dss_commit *cancel[DSS_COMMIT_QUEUE_DEPTH];
+	unsigned long flags;
+	int i, num_cancel;
+
+	spin_lock_irqsave(&dss_cache.lock, flags);
+	num_cancel = q->count;
+	for (i = 0; i < num_cancel; ++i)
+		cancel[i] = q->entry[(q->head + i) %
+			DSS_COMMIT_QUEUE_DEPTH].commit;
+	q->count = 0;
+	spin_unlock_irqrestore(&dss_cache.lock, flags);
+
+	for (i = 0; i < num_cancel; ++i)
+		cancel[i]->callback(cancel[i], -ECANCELED);
+}
+
+static unsigned long dss_mgr_refresh_mhz(struct omap_dss_device *dssdev)
+{
+	struct omap_video_timings *t = &dssdev->panel.timings;
+	u32 total;
+
+	total = (t->x_res + t->hfp + t->hsw + t->hbp) *
+		(t->y_res + t->vfp + t->vsw + t->vbp);
+	if (!total)
+		return 0;
+
+	return div_u64((u64)dispc_pclk_rate(dssdev->channel) * 1000, total);
+}
+
+/* Switch the FIFO thresholds and the statistics to the new state */
+static void dss_idle_set(struct dss_idle_data *d, bool idle)
+{
+	struct omap_overlay_manager *mgr = d->mgr;
+	struct overlay_cache_data *oc;
+	struct omap_overlay *ovl;
+	unsigned long refresh_mhz;
+	unsigned long flags;
+	int i;
+
+	refresh_mhz = dss_mgr_refresh_mhz(mgr->device);
+
+	spin_lock_irqsave(&dss_cache.lock, flags);
+
+	dss_idle_account(d);
+	d->idle = idle;
+	d->refresh_mhz = refresh_mhz;
+
+	for (i = 0; i < omap_dss_get_num_overlays(); ++i) {
+		ovl = omap_dss_get_overlay(i);
+
+		if (!(ovl->caps & OMAP_DSS_OVL_CAP_DISPC))
+			continue;
+
+		oc = &dss_cache.overlay_cache[ovl->id];
+		if (!oc->enabled || oc->channel != mgr->id)
+			continue;
+
+		dss_ovl_fill_fifo(ovl, mgr->device,
+				dispc_get_plane_fifo_size(ovl->id), oc);
+		oc->dirty = true;
+	}
+
+	dss_cache_configure();
+
+	/* a frame came in while the panel was slowing down */
+	if (idle && time_before(jiffies, d->last_activity +
+				msecs_to_jiffies(d->timeout_ms)))
+		schedule_work(&d->wake_work);
+
+	spin_unlock_irqrestore(&dss_cache.lock, flags);
+}
+
+static void dss_idle_work(struct work_struct *work)
+{
+	struct dss_idle_data *d = container_of(work, struct dss_idle_data,
+			idle_work.work);
+	struct omap_dss_device *dssdev = d->mgr->device;
+	unsigned long timeout;
+	unsigned long flags;
+
+	mutex_lock(&d->lock);
+
+	spin_lock_irqsave(&dss_cache.lock, flags);
+
+	if (!d->enabled || d->idle) {
+		spin_unlock_irqrestore(&dss_cache.lock, flags);
+		goto out;
+	}
+
+	timeout = d->last_activity + msecs_to_jiffies(d->timeout_ms);
+	if (time_before(jiffies, timeout)) {
+		schedule_delayed_work(&d->idle_work, timeout - jiffies);
+		spin_unlock_irqrestore(&dss_cache.lock, flags);
+		goto out;
+	}
+
+	spin_unlock_irqrestore(&dss_cache.lock, flags);
+
+	if (dssdev->driver->set_idle(dssdev, true))
+		goto out;
+
+	DSSDBG("%s idle\n", d->mgr->name);
+	dss_idle_set(d, true);
+out:
+	mutex_unlock(&d->lock);
+}
+
+static void dss_wake_work(struct work_struct *work)
+{
+	struct dss_idle_data *d = container_of(work, struct dss_idle_data,
+			wake_work);
+	struct omap_dss_device *dssdev = d->mgr->device;
+	unsigned long flags;
+	bool idle;
+
+	mutex_lock(&d->lock);
+
+	spin_lock_irqsave(&dss_cache.lock, flags);
+	idle = d->enabled && d->idle;
+	spin_unlock_irqrestore(&dss_cache.lock, flags);
+
+	if (idle) {
+		dssdev->driver->set_idle(dssdev, false);
+
+		DSSDBG("%s active\n", d->mgr->name);
+		dss_idle_set(d, false);
+
+		schedule_delayed_work(&d->idle_work,
+				msecs_to_jiffies(d->timeout_ms));
+	}
+
+	mutex_unlock(&d->lock);
+}
+
+static void dss_idle_start(struct omap_overlay_manager *mgr)
+{
+	struct dss_idle_data *d = &dss_idle[mgr->id];
+	struct omap_dss_device *dssdev = mgr->device;
+	unsigned long refresh_mhz;
+	unsigned long flags;
+
+	if (!dssdev || !dssdev->driver || !dssdev->driver->set_idle ||
+			!dssdev->panel.idle_timeout_ms ||
+			dssdev_manually_updated(dssdev))
+		return;
+
+	refresh_mhz = dss_mgr_refresh_mhz(dssdev);
+
+	spin_lock_irqsave(&dss_cache.lock, flags);
+	d->enabled = true;
+	d->idle = false;
+	d->timeout_ms = dssdev->panel.idle_timeout_ms;
+	d->refresh_mhz = refresh_mhz;
+	d->full_refresh_mhz = refresh_mhz;
+	d->last_account = jiffies;
+	d->last_activity = jiffies;
+	spin_unlock_irqrestore(&dss_cache.lock, flags);
+
+	schedule_delayed_work(&d->idle_work, msecs_to_jiffies(d->timeout_ms));
+}
+
+/* restore: the display stays on, bring it back to full rate */
+static void dss_idle_stop(struct omap_overlay_manager *mgr, bool restore)
+{
+	struct dss_idle_data *d = &dss_idle[mgr->id];
+	struct omap_dss_device *dssdev = mgr->device;
+	unsigned long flags;
+
+	spin_lock_irqsave(&dss_cache.lock, flags);
+	dss_idle_account(d);
+	d->enabled = false;
+	spin_unlock_irqrestore(&dss_cache.lock, flags);
+
+	cancel_delayed_work_sync(&d->idle_work);
+	cancel_work_sync(&d->wake_work);
+
+	mutex_lock(&d->lock);
+	if (d->idle) {
+		if (restore) {
+			dssdev->driver->set_idle(dssdev, false);
+			dss_idle_set(d, false);
+		} else {
+			spin_lock_irqsave(&dss_cache.lock, flags);
+			d->idle = false;
+			spin_unlock_irqrestore(&dss_cache.lock, flags);
+		}
+	}
+	mutex_unlock(&d->lock);
+}
+
+static int dss_mgr_mark_dirty(struct omap_overlay_manager *mgr,
+		u16 x, u16 y, u16 w, u16 h)
+{
+	struct dss_idle_data *d = &dss_idle[mgr->id];
+	unsigned long flags;
+
+	spin_lock_irqsave(&dss_cache.lock, flags);
+	d->dirty_rects++;
+	d->dirty_pixels += (u32)w * h;
+	dss_idle_activity(mgr->id);
+	spin_unlock_irqrestore(&dss_cache.lock, flags);
+
+	return 0;
+}
+
+static ssize_t manager_idle_timeout_show(struct omap_overlay_manager *mgr,
+		char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			mgr->device ? mgr->device->panel.idle_timeout_ms : 0);
+}
+
+static ssize_t manager_idle_timeout_store(struct omap_overlay_manager *mgr,
+		const char *buf, size_t size)
+{
+	struct omap_dss_device *dssdev = mgr->device;
+	unsigned timeout;
+
+	if (sscanf(buf, "%u", &timeout) != 1)
+		return -EINVAL;
+
+	if (!dssdev)
+		return -ENODEV;
+
+	dss_idle_stop(mgr, dssdev->state == OMAP_DSS_DISPLAY_ACTIVE);
+	dssdev->panel.idle_timeout_ms = timeout;
+	if (dssdev->state == OMAP_DSS_DISPLAY_ACTIVE)
+		dss_idle_start(mgr);
+
+	return size;
+}
+
+static ssize_t manager_idle_stats_show(struct omap_overlay_manager *mgr,
+		char *buf)
+{
+	struct dss_idle_data *d = &dss_idle[mgr->id];
+	struct dss_idle_data stats;
+	unsigned long flags;
+
+	spin_lock_irqsave(&dss_cache.lock, flags);
+	dss_idle_account(d);
+	stats = *d;
+	spin_unlock_irqrestore(&dss_cache.lock, flags);
+
+	return snprintf(buf, PAGE_SIZE,
+			"state %s\n"
+			"refresh_mhz %lu\n"
+			"full_refresh_mhz %lu\n"
+			"active_ms %llu\n"
+			"idle_ms %llu\n"
+			"scanout_bytes %llu\n"
+			"saved_bytes %llu\n"
+			"dirty_rects %llu\n"
+			"dirty_pixels %llu\n",
+			!stats.enabled ? "off" : stats.idle ? "idle" : "active",
+			stats.refresh_mhz, stats.full_refresh_mhz,
+			stats.active_ms, stats.idle_ms,
+			stats.scanout_bytes, stats.saved_bytes,
+			stats.dirty_rects, stats.dirty_pixels);
+}
+
 static int dss_mgr_enable(struct omap_overlay_manager *mgr)
 {
 	dispc_enable_channel(mgr->id, 1);
+	dss_idle_start(mgr);
 	return 0;
 }
 
 static int dss_mgr_disable(struct omap_overlay_manager *mgr)
 {
+	dss_idle_stop(mgr, false);
 	dispc_enable_channel(mgr->id, 0);
+	dss_mgr_cancel_commits(mgr);
 	return 0;
 }
 
@@ -1811,12 +2490,19 @@ int dss_init_overlay_managers(struct platform_device *pdev)
 		mgr->get_manager_info = &omap_dss_mgr_get_info;
 		mgr->wait_for_go = &dss_mgr_wait_for_go;
 		mgr->wait_for_vsync = &dss_mgr_wait_for_vsync;
+		mgr->queue_commit = &dss_mgr_queue_commit;
+		mgr->mark_dirty = &dss_mgr_mark_dirty;
 
 		mgr->enable = &dss_mgr_enable;
 		mgr->disable = &dss_mgr_disable;
 
 		mgr->caps = OMAP_DSS_OVL_MGR_CAP_DISPC;
 
+		dss_idle[mgr->id].mgr = mgr;
+		INIT_DELAYED_WORK(&dss_idle[mgr->id].idle_work, dss_idle_work);
+		INIT_WORK(&dss_idle[mgr->id].wake_work, dss_wake_work);
+		mutex_init(&dss_idle[mgr->id].lock);
+
 		dss_overlay_setup_dispc_manager(mgr);
 
 		omap_dss_add_overlay_manager(mgr);
@@ -1877,6 +2563,8 @@ void dss_uninit_overlay_managers(struct platform_device *pdev)
 		mgr = list_first_entry(&manager_list,
 				struct omap_overlay_manager, list);
 		list_del(&mgr->list);
+		if (mgr->caps & OMAP_DSS_OVL_MGR_CAP_DISPC)
+			dss_idle_stop(mgr, false);
 		kobject_del(&mgr->kobj);
 		kobject_put(&mgr->kobj);
 		kfree(mgr);
@@ -523,20 +523,18 @@ static struct kobj_type overlay_ktype = {
 };
 
 /* Check if overlay parameters are compatible with display */
-int dss_check_overlay(struct omap_overlay *ovl, struct omap_dss_device *dssdev)
+int dss_check_overlay_info(struct omap_overlay *ovl,
+		struct omap_overlay_info *info, struct omap_dss_device *dssdev)
 {
-	struct omap_overlay_info *info;
 	u16 outw, outh;
 	u16 dw, dh;
 
 	if (!dssdev)
 		return 0;
 
-	if (!ovl->info.enabled)
+	if (!info->enabled)
 		return 0;
 
-	info = &ovl->info;
-
 	if (info->paddr == 0) {
 		DSSDBG("check_overlay failed: paddr 0\n");
 		return -EINVAL;
@@ -545,7 +543,7 @@ int dss_check_overlay(struct omap_overlay *ovl, struct omap_dss_device *dssdev)
 	dssdev->driver->get_resolution(dssdev, &dw, &dh);
 
 	/* y resolution to be doubled in case of interlaced HDMI */
-	if ((ovl->info.field == IBUF_IDEV) || (ovl->info.field == PBUF_IDEV))
+	if ((info->field == IBUF_IDEV) || (info->field == PBUF_IDEV))
 		dh *= 2;
 
 	DSSDBG("check_overlay %d: (%d,%d %dx%d -> %dx%d) disp (%dx%d)\n",
@@ -596,6 +594,11 @@ int dss_check_overlay(struct omap_overlay *ovl, struct omap_dss_device *dssdev)
 	return 0;
 }
 
+int dss_check_overlay(struct omap_overlay *ovl, struct omap_dss_device *dssdev)
+{
+	return dss_check_overlay_info(ovl, &ovl->info, dssdev);
+}
+
 static int dss_ovl_set_overlay_info(struct omap_overlay *ovl,
 		struct omap_overlay_info *info)
 {
@@ -292,6 +292,17 @@ static int omapfb_update_window_nolock(struct fb_info *fbi,
 	if (x + w > dw || y + h > dh)
 		return -EINVAL;
 
+	/* auto update displays scan the area out anyway, but the manager
+	 * has to know that the frame is not static */
+	if (!display->driver->update) {
+		struct omap_overlay_manager *mgr = display->manager;
+
+		if (!mgr || !mgr->mark_dirty)
+			return 0;
+
+		return mgr->mark_dirty(mgr, x, y, w, h);
+	}
+
 	return display->driver->update(display, x, y, w, h);
 }
 
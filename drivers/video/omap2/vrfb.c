@@ -59,6 +59,15 @@
 /* bitmap of reserved contexts */
 static unsigned long ctx_map;
 
+/*
+ * Free contexts are handed out least recently released first.  omapfb
+ * and omap_vout share the pool, and a context that was just released
+ * may still be fetched by the DSS until the next vsync, so it should
+ * be the last one to get reprogrammed by a new owner.
+ */
+static unsigned long ctx_stamp[VRFB_NUM_CTXS];
+static unsigned long ctx_clock;
+
 static DEFINE_MUTEX(ctx_lock);
 
 /*
@@ -252,21 +261,16 @@ int omap_vrfb_map_angle(struct vrfb *vrfb, u16 height, u8 rot)
 }
 EXPORT_SYMBOL(omap_vrfb_map_angle);
 
-void omap_vrfb_release_ctx(struct vrfb *vrfb)
+/* called with ctx_lock held */
+static void __omap_vrfb_release_ctx(struct vrfb *vrfb)
 {
 	int rot;
 	int ctx = vrfb->context;
 
-	if (ctx == 0xff)
-		return;
-
-	DBG("release ctx %d\n", ctx);
-
-	mutex_lock(&ctx_lock);
-
 	BUG_ON(!(ctx_map & (1 << ctx)));
 
 	clear_bit(ctx, &ctx_map);
+	ctx_stamp[ctx] = ++ctx_clock;
 
 	for (rot = 0; rot < 4; ++rot) {
 		if (vrfb->paddr[rot]) {
@@ -276,7 +280,17 @@ void omap_vrfb_release_ctx(struct vrfb *vrfb)
 	}
 
 	vrfb->context = 0xff;
+}
+
+void omap_vrfb_release_ctx(struct vrfb *vrfb)
+{
+	if (vrfb->context == 0xff)
+		return;
+
+	DBG("release ctx %d\n", vrfb->context);
 
+	mutex_lock(&ctx_lock);
+	__omap_vrfb_release_ctx(vrfb);
 	mutex_unlock(&ctx_lock);
 }
 EXPORT_SYMBOL(omap_vrfb_release_ctx);
@@ -285,16 +299,20 @@ int omap_vrfb_request_ctx(struct vrfb *vrfb)
 {
 	int rot;
 	u32 paddr;
-	u8 ctx;
+	u8 ctx, i;
 	int r;
 
 	DBG("request ctx\n");
 
 	mutex_lock(&ctx_lock);
 
-	for (ctx = 0; ctx < VRFB_NUM_CTXS; ++ctx)
-		if ((ctx_map & (1 << ctx)) == 0)
-			break;
+	ctx = VRFB_NUM_CTXS;
+	for (i = 0; i < VRFB_NUM_CTXS; ++i) {
+		if (ctx_map & (1 << i))
+			continue;
+		if (ctx == VRFB_NUM_CTXS || ctx_stamp[i] < ctx_stamp[ctx])
+			ctx = i;
+	}
 
 	if (ctx == VRFB_NUM_CTXS) {
 		pr_err("vrfb: no free contexts\n");
@@ -316,7 +334,7 @@ int omap_vrfb_request_ctx(struct vrfb *vrfb)
 			pr_err("vrfb: failed to reserve VRFB "
 					"area for ctx %d, rotation %d\n",
 					ctx, rot * 90);
-			omap_vrfb_release_ctx(vrfb);
+			__omap_vrfb_release_ctx(vrfb);
 			r = -ENOMEM;
 			goto out;
 		}
@@ -54,6 +54,7 @@ static int yaffs2_CheckpointErase(yaffs_Device *dev)
 	}
 
 	dev->blocksInCheckpoint = 0;
+	dev->checkpointStale = 0;
 
 	return 1;
 }
@@ -88,9 +88,6 @@ static void yaffs_CheckObjectDetailsLoaded(yaffs_Object *in);
 static void yaffs_InvalidateWholeChunkCache(yaffs_Object *in);
 static void yaffs_InvalidateChunkCache(yaffs_Object *object, int chunkId);
 
-static int yaffs_FindChunkInFile(yaffs_Object *in, int chunkInInode,
-				yaffs_ExtendedTags *tags);
-
 static int yaffs_VerifyChunkWritten(yaffs_Device *dev,
 					int chunkInNAND,
 					const __u8 *data,
@@ -392,7 +389,7 @@ static int yaffs_WriteNewChunkWithTagsToNAND(struct yaffs_DeviceStruct *dev,
 	int writeOk = 0;
 	int chunk;
 
-	yaffs2_InvalidateCheckpoint(dev);
+	yaffs2_StaleCheckpoint(dev);
 
 	do {
 		yaffs_BlockInfo *bi = 0;
@@ -662,6 +659,7 @@ static void yaffs_FreeTnode(yaffs_Device *dev, yaffs_Tnode *tn)
 {
 	yaffs_FreeRawTnode(dev,tn);
 	dev->nTnodes--;
+	dev->tnodeGeneration++; /* drop any cached lookups of it */
 	dev->nCheckpointBlocksRequired = 0; /* force recalculation*/
 }
 
@@ -749,8 +747,6 @@ yaffs_Tnode *yaffs_FindLevel0Tnode(yaffs_Device *dev,
 	int requiredTallness;
 	int level = fStruct->topLevel;
 
-	dev=dev;
-
 	/* Check sane level and chunk Id */
 	if (level < 0 || level > YAFFS_TNODES_MAX_LEVEL)
 		return NULL;
@@ -758,6 +754,17 @@ yaffs_Tnode *yaffs_FindLevel0Tnode(yaffs_Device *dev,
 	if (chunkId > YAFFS_MAX_CHUNK_ID)
 		return NULL;
 
+	/* Sequential access keeps hitting the same level 0 tnode, so try
+	 * the one found last time before walking down the tree.
+	 */
+	if (fStruct->cachedTn &&
+	    fStruct->cachedTnGeneration == dev->tnodeGeneration &&
+	    fStruct->cachedTnBase == (chunkId >> YAFFS_TNODES_LEVEL0_BITS)) {
+		dev->tnodeCacheHits++;
+		return fStruct->cachedTn;
+	}
+	dev->tnodeCacheMisses++;
+
 	/* First check we're tall enough (ie enough topLevel) */
 
 	i = chunkId >> YAFFS_TNODES_LEVEL0_BITS;
@@ -780,6 +787,12 @@ yaffs_Tnode *yaffs_FindLevel0Tnode(yaffs_Device *dev,
 		level--;
 	}
 
+	if (tn) {
+		fStruct->cachedTn = tn;
+		fStruct->cachedTnBase = chunkId >> YAFFS_TNODES_LEVEL0_BITS;
+		fStruct->cachedTnGeneration = dev->tnodeGeneration;
+	}
+
 	return tn;
 }
 
@@ -1485,6 +1498,7 @@ yaffs_Object *yaffs_CreateNewObject(yaffs_Device *dev, int number,
 			theObject->variant.fileVariant.shrinkSize = 0xFFFFFFFF;	/* max __u32 */
 			theObject->variant.fileVariant.topLevel = 0;
 			theObject->variant.fileVariant.top = tn;
+			theObject->variant.fileVariant.cachedTn = NULL;
 			break;
 		case YAFFS_OBJECT_TYPE_DIRECTORY:
 			YINIT_LIST_HEAD(&theObject->variant.directoryVariant.
@@ -2546,6 +2560,7 @@ static int yaffs_CheckGarbageCollection(yaffs_Device *dev, int background)
 	int minErased;
 	int erasedChunks;
 	int checkpointBlockAdjust;
+	__u32 erasures;
 
 	if(dev->param.gcControl &&
 		(dev->param.gcControl(dev) & 1) == 0)
@@ -2606,13 +2621,20 @@ static int yaffs_CheckGarbageCollection(yaffs_Device *dev, int background)
 			dev->allGCs++;
 			if (!aggressive)
 				dev->passiveGCs++;
+			if (!background)
+				dev->foregroundGCs++;
 
 			T(YAFFS_TRACE_GC,
 			  (TSTR
 			   ("yaffs: GC erasedBlocks %d aggressive %d" TENDSTR),
 			   dev->nErasedBlocks, aggressive));
 
+			erasures = dev->nBlockErasures;
 			gcOk = yaffs_GarbageCollectBlock(dev, dev->gcBlock, aggressive);
+			if (background)
+				dev->backgroundGCBlocks += dev->nBlockErasures - erasures;
+			else
+				dev->foregroundGCBlocks += dev->nBlockErasures - erasures;
 		}
 
 		if (dev->nErasedBlocks < (dev->param.nReservedBlocks) && dev->gcBlock > 0) {
@@ -2631,15 +2653,21 @@ static int yaffs_CheckGarbageCollection(yaffs_Device *dev, int background)
 /*
  * yaffs_BackgroundGarbageCollect()
  * Garbage collects. Intended to be called from a background thread.
+ * A passive collection only copies a few chunks per pass, so higher
+ * urgency runs more passes per call.
  * Returns non-zero if at least half the free chunks are erased.
  */
 int yaffs_BackgroundGarbageCollect(yaffs_Device *dev, unsigned urgency)
 {
-	int erasedChunks = dev->nErasedBlocks * dev->param.nChunksPerBlock;
+	int erasedChunks;
+	unsigned pass;
 
 	T(YAFFS_TRACE_BACKGROUND, (TSTR("Background gc %u" TENDSTR),urgency));
 
-	yaffs_CheckGarbageCollection(dev, 1);
+	for (pass = 0; pass <= urgency; pass++)
+		yaffs_CheckGarbageCollection(dev, 1);
+
+	erasedChunks = dev->nErasedBlocks * dev->param.nChunksPerBlock;
 	return erasedChunks > dev->nFreeChunks/2;
 }
 
@@ -2656,7 +2684,7 @@ static int yaffs_TagsMatch(const yaffs_ExtendedTags *tags, int objectId,
 
 /*-------------------- Data file manipulation -----------------*/
 
-static int yaffs_FindChunkInFile(yaffs_Object *in, int chunkInInode,
+int yaffs_FindChunkInFile(yaffs_Object *in, int chunkInInode,
 				 yaffs_ExtendedTags *tags)
 {
 	/*Get the Tnode, then get the level 0 offset chunk offset */
@@ -3713,7 +3741,7 @@ int yaffs_WriteDataToFile(yaffs_Object *in, const __u8 *buffer, loff_t offset,
 
 /* ---------------------- File resizing stuff ------------------ */
 
-static void yaffs_PruneResizedChunks(yaffs_Object *in, int newSize)
+void yaffs_PruneResizedChunks(yaffs_Object *in, int newSize)
 {
 
 	yaffs_Device *dev = in->myDev;
@@ -5276,6 +5304,7 @@ int yaffs_GutsInitialise(yaffs_Device *dev)
 	dev->nDeletedFiles = 0;
 	dev->nBackgroundDeletions = 0;
 	dev->nUnlinkedFiles = 0;
+	dev->checkpointStale = 0;
 	dev->eccFixed = 0;
 	dev->eccUnfixed = 0;
 	dev->tagsEccFixed = 0;
@@ -5410,7 +5439,8 @@ int yaffs_GutsInitialise(yaffs_Device *dev)
 	yaffs_VerifyBlocks(dev);
 
 	/* Clean up any aborted checkpoint data */
-	if(!dev->isCheckpointed && dev->blocksInCheckpoint > 0)
+	if(!dev->isCheckpointed && !dev->checkpointStale &&
+		dev->blocksInCheckpoint > 0)
 		yaffs2_InvalidateCheckpoint(dev);
 
 	T(YAFFS_TRACE_TRACING,
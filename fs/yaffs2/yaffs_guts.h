@@ -64,7 +64,7 @@
 #define YAFFS_OBJECT_SPACE		0x40000
 #define YAFFS_MAX_OBJECT_ID		(YAFFS_OBJECT_SPACE -1)
 
-#define YAFFS_CHECKPOINT_VERSION 	4
+#define YAFFS_CHECKPOINT_VERSION 	5
 
 #ifdef CONFIG_YAFFS_UNICODE
 #define YAFFS_MAX_NAME_LENGTH		127
@@ -372,6 +372,11 @@ typedef struct {
 	__u32 shrinkSize;
 	int topLevel;
 	yaffs_Tnode *top;
+
+	/* Last level 0 tnode found, valid while tnodeGeneration is unchanged */
+	yaffs_Tnode *cachedTn;
+	__u32 cachedTnBase;
+	__u32 cachedTnGeneration;
 } yaffs_FileStructure;
 
 typedef struct {
@@ -640,6 +645,7 @@ struct yaffs_DeviceStruct {
 	int isMounted;
 	int readOnly;
 	int isCheckpointed;
+	int checkpointStale;	/* Checkpoint on flash predates the last writes */
 
 
 	/* Stuff to support block offsetting to support start block zero */
@@ -684,6 +690,7 @@ struct yaffs_DeviceStruct {
 	void *allocator;
 	int nObjects;
 	int nTnodes;
+	__u32 tnodeGeneration;	/* Bumped whenever a tnode is freed */
 
 	int nHardLinks;
 
@@ -759,6 +766,9 @@ struct yaffs_DeviceStruct {
 	__u32 oldestDirtyGCs;
 	__u32 nGCBlocks;
 	__u32 backgroundGCs;
+	__u32 foregroundGCs;		/* gc passes run inline by a writer */
+	__u32 foregroundGCBlocks;	/* blocks reclaimed by inline gc */
+	__u32 backgroundGCBlocks;	/* blocks reclaimed by background gc */
 	__u32 nRetriedWrites;
 	__u32 nRetiredBlocks;
 	__u32 eccFixed;
@@ -769,6 +779,8 @@ struct yaffs_DeviceStruct {
 	__u32 nUnmarkedDeletions;
 	__u32 refreshCount;
 	__u32 cacheHits;
+	__u32 tnodeCacheHits;
+	__u32 tnodeCacheMisses;
 
 };
 
@@ -956,6 +968,9 @@ yaffs_Tnode *yaffs_AddOrFindLevel0Tnode(yaffs_Device *dev,
 int yaffs_DoWriteDataToFile(yaffs_Object *in, const __u8 *buffer, loff_t offset,
 			int nBytes, int writeThrough);
 void yaffs_ResizeDown( yaffs_Object *obj, loff_t newSize);
+void yaffs_PruneResizedChunks(yaffs_Object *in, int newSize);
+int yaffs_FindChunkInFile(yaffs_Object *in, int chunkInInode,
+				yaffs_ExtendedTags *tags);
 void yaffs_SkipRestOfBlock(yaffs_Device *dev);
 
 int yaffs_CountFreeChunks(yaffs_Device *dev);
@@ -19,12 +19,20 @@
 #include "devextras.h"
 #include "yportenv.h"
 
+#ifdef CONFIG_HAS_WAKELOCK
+#include <linux/wakelock.h>
+#endif
+
 struct yaffs_LinuxContext {
 	struct ylist_head	contextList; /* List of these we have mounted */
 	struct yaffs_DeviceStruct *dev;
 	struct super_block * superBlock;
 	struct task_struct *bgThread; /* Background thread for this device */
 	int bgRunning;
+	unsigned long lastActivity; /* jiffies of the last foreground access */
+#ifdef CONFIG_HAS_WAKELOCK
+	struct wake_lock bgWakeLock; /* Held while background gc is urgent */
+#endif
         struct semaphore grossLock;     /* Gross locking semaphore */
 	__u8 *spareBuffer;      /* For mtdif2 use. Don't know the size of the buffer
 				 * at compile time so we have to allocate it.
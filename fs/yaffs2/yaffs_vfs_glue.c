@@ -146,6 +146,12 @@
 #define YAFFS_USE_WRITE_BEGIN_END 0
 #endif
 
+#if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 16))
+#define YAFFS_USE_READPAGES 1
+#else
+#define YAFFS_USE_READPAGES 0
+#endif
+
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 28))
 static uint32_t YCALCBLOCKS(uint64_t partition_size, uint32_t block_size)
 {
@@ -175,6 +181,9 @@ unsigned int yaffs_wr_attempts = YAFFS_WR_ATTEMPTS;
 unsigned int yaffs_auto_checkpoint = 1;
 unsigned int yaffs_gc_control = 1;
 unsigned int yaffs_bg_enable = 1;
+unsigned int yaffs_bg_idle_ms = 500;
+unsigned int yaffs_bg_gc_aggressiveness = 1;
+unsigned int yaffs_bg_wakelock = 0;
 
 /* Module Parameters */
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 5, 0))
@@ -183,6 +192,9 @@ module_param(yaffs_wr_attempts, uint, 0644);
 module_param(yaffs_auto_checkpoint, uint, 0644);
 module_param(yaffs_gc_control, uint, 0644);
 module_param(yaffs_bg_enable, uint, 0644);
+module_param(yaffs_bg_idle_ms, uint, 0644);
+module_param(yaffs_bg_gc_aggressiveness, uint, 0644);
+module_param(yaffs_bg_wakelock, uint, 0644);
 #else
 MODULE_PARM(yaffs_traceMask, "i");
 MODULE_PARM(yaffs_wr_attempts, "i");
@@ -300,6 +312,10 @@ static void yaffs_clear_inode(struct inode *);
 #endif
 
 static int yaffs_readpage(struct file *file, struct page *page);
+#if (YAFFS_USE_READPAGES != 0)
+static int yaffs_readpages(struct file *file, struct address_space *mapping,
+				struct list_head *pages, unsigned nr_pages);
+#endif
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 5, 0))
 static int yaffs_writepage(struct page *page, struct writeback_control *wbc);
 #else
@@ -349,6 +365,9 @@ static int yaffs_vfs_setattr(struct inode *, struct iattr *);
 
 static struct address_space_operations yaffs_file_address_operations = {
 	.readpage = yaffs_readpage,
+#if (YAFFS_USE_READPAGES != 0)
+	.readpages = yaffs_readpages,
+#endif
 	.writepage = yaffs_writepage,
 #if (YAFFS_USE_WRITE_BEGIN_END > 0)
 	.write_begin = yaffs_write_begin,
@@ -514,8 +533,12 @@ static unsigned yaffs_gc_control_callback(yaffs_Device *dev)
                 	                                                                                          	
 static void yaffs_GrossLock(yaffs_Device *dev)
 {
+	struct yaffs_LinuxContext *lc = yaffs_DeviceToLC(dev);
+
 	T(YAFFS_TRACE_LOCK, (TSTR("yaffs locking %p\n"), current));
-	down(&(yaffs_DeviceToLC(dev)->grossLock));
+	down(&lc->grossLock);
+	if (current != lc->bgThread)
+		lc->lastActivity = jiffies;
 	T(YAFFS_TRACE_LOCK, (TSTR("yaffs locked %p\n"), current));
 }
 
@@ -985,25 +1008,12 @@ static int yaffs_file_flush(struct file *file)
 	return 0;
 }
 
-static int yaffs_readpage_nolock(struct file *f, struct page *pg)
+/* Fill a locked page from the file. Caller holds the gross lock. */
+static int yaffs_readpage_fill(yaffs_Object *obj, struct page *pg)
 {
-	/* Lifted from jffs2 */
-
-	yaffs_Object *obj;
 	unsigned char *pg_buf;
 	int ret;
 
-	yaffs_Device *dev;
-
-	T(YAFFS_TRACE_OS,
-		(TSTR("yaffs_readpage_nolock at %08x, size %08x\n"),
-		(unsigned)(pg->index << PAGE_CACHE_SHIFT),
-		(unsigned)PAGE_CACHE_SIZE));
-
-	obj = yaffs_DentryToObject(f->f_dentry);
-
-	dev = obj->myDev;
-
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 5, 0))
 	BUG_ON(!PageLocked(pg));
 #else
@@ -1014,14 +1024,10 @@ static int yaffs_readpage_nolock(struct file *f, struct page *pg)
 	pg_buf = kmap(pg);
 	/* FIXME: Can kmap fail? */
 
-	yaffs_GrossLock(dev);
-
 	ret = yaffs_ReadDataFromFile(obj, pg_buf,
 				pg->index << PAGE_CACHE_SHIFT,
 				PAGE_CACHE_SIZE);
 
-	yaffs_GrossUnlock(dev);
-
 	if (ret >= 0)
 		ret = 0;
 
@@ -1036,6 +1042,33 @@ static int yaffs_readpage_nolock(struct file *f, struct page *pg)
 	flush_dcache_page(pg);
 	kunmap(pg);
 
+	return ret;
+}
+
+static int yaffs_readpage_nolock(struct file *f, struct page *pg)
+{
+	/* Lifted from jffs2 */
+
+	yaffs_Object *obj;
+	int ret;
+
+	yaffs_Device *dev;
+
+	T(YAFFS_TRACE_OS,
+		(TSTR("yaffs_readpage_nolock at %08x, size %08x\n"),
+		(unsigned)(pg->index << PAGE_CACHE_SHIFT),
+		(unsigned)PAGE_CACHE_SIZE));
+
+	obj = yaffs_DentryToObject(f->f_dentry);
+
+	dev = obj->myDev;
+
+	yaffs_GrossLock(dev);
+
+	ret = yaffs_readpage_fill(obj, pg);
+
+	yaffs_GrossUnlock(dev);
+
 	T(YAFFS_TRACE_OS, (TSTR("yaffs_readpage_nolock done\n")));
 	return ret;
 }
@@ -1057,6 +1090,59 @@ static int yaffs_readpage(struct file *f, struct page *pg)
 	return ret;
 }
 
+#if (YAFFS_USE_READPAGES != 0)
+
+/* Number of readahead pages filled per gross lock hold */
+#define YAFFS_READPAGES_BATCH 16
+
+/*
+ * Readahead. The pages are put into the page cache first, without the
+ * gross lock held since that may have to write back dirty yaffs pages.
+ * Then a whole batch is read under one gross lock hold, in file order, so
+ * that consecutive chunks are looked up through the file's cached level 0
+ * tnode instead of a walk down the tnode tree each.
+ */
+static int yaffs_readpages(struct file *f, struct address_space *mapping,
+				struct list_head *pages, unsigned nr_pages)
+{
+	yaffs_Object *obj = yaffs_DentryToObject(f->f_dentry);
+	yaffs_Device *dev = obj->myDev;
+	struct page *batch[YAFFS_READPAGES_BATCH];
+	struct page *pg;
+	int n;
+	int i;
+
+	T(YAFFS_TRACE_OS, (TSTR("yaffs_readpages %u pages\n"), nr_pages));
+
+	while (!list_empty(pages)) {
+		n = 0;
+		while (n < YAFFS_READPAGES_BATCH && !list_empty(pages)) {
+			pg = list_entry(pages->prev, struct page, lru);
+			list_del(&pg->lru);
+			if (add_to_page_cache_lru(pg, mapping, pg->index,
+							GFP_KERNEL))
+				page_cache_release(pg);
+			else
+				batch[n++] = pg;
+		}
+
+		yaffs_GrossLock(dev);
+		for (i = 0; i < n; i++)
+			yaffs_readpage_fill(obj, batch[i]);
+		yaffs_GrossUnlock(dev);
+
+		for (i = 0; i < n; i++) {
+			UnlockPage(batch[i]);
+			page_cache_release(batch[i]);
+		}
+	}
+
+	T(YAFFS_TRACE_OS, (TSTR("yaffs_readpages done\n")));
+	return 0;
+}
+
+#endif
+
 /* writepage inspired by/stolen from smbfs */
 
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 5, 0))
@@ -2240,14 +2326,21 @@ static void yaffs_FlushSuperBlock(struct super_block *sb, int do_checkpoint)
 }
 
 
-static unsigned yaffs_bg_gc_urgency(yaffs_Device *dev)
+/* Free chunks not in an erased block, ie. what gc could reclaim */
+static unsigned yaffs_bg_scattered_free(yaffs_Device *dev)
 {
 	unsigned erasedChunks = dev->nErasedBlocks * dev->param.nChunksPerBlock;
-	struct yaffs_LinuxContext *context = yaffs_DeviceToLC(dev);
-	unsigned scatteredFree = 0; /* Free chunks not in an erased block */
 
 	if(erasedChunks < dev->nFreeChunks)
-		scatteredFree = (dev->nFreeChunks - erasedChunks);
+		return dev->nFreeChunks - erasedChunks;
+	return 0;
+}
+
+static unsigned yaffs_bg_gc_urgency(yaffs_Device *dev)
+{
+	unsigned erasedChunks = dev->nErasedBlocks * dev->param.nChunksPerBlock;
+	struct yaffs_LinuxContext *context = yaffs_DeviceToLC(dev);
+	unsigned scatteredFree = yaffs_bg_scattered_free(dev);
 
 	if(!context->bgRunning)
 		return 0;
@@ -2261,6 +2354,20 @@ static unsigned yaffs_bg_gc_urgency(yaffs_Device *dev)
 		return 2;
 }
 
+/*
+ * While nobody is using the device, collect harder than the free space
+ * alone asks for (yaffs_bg_gc_aggressiveness), so that writers find
+ * erased blocks instead of having to gc inline.
+ */
+static unsigned yaffs_bg_gc_idle_urgency(yaffs_Device *dev, unsigned urgency)
+{
+	if(yaffs_bg_scattered_free(dev) < (dev->param.nChunksPerBlock * 2))
+		return urgency;
+
+	urgency += yaffs_bg_gc_aggressiveness;
+	return (urgency > 3) ? 3 : urgency;
+}
+
 static int yaffs_do_sync_fs(struct super_block *sb,
 				int request_checkpoint)
 {
@@ -2321,6 +2428,9 @@ static int yaffs_BackgroundThread(void *data)
 	unsigned long next_gc = now;
 	unsigned long expires;
 	unsigned int urgency;
+	unsigned long idle_at;
+	int idle;
+	int urgent;
 
 	int gcResult;
 	struct timer_list timer;
@@ -2346,6 +2456,7 @@ static int yaffs_BackgroundThread(void *data)
 		yaffs_GrossLock(dev);
 
 		now = jiffies;
+		urgent = 0;
 
 		if(time_after(now, next_dir_update) && yaffs_bg_enable){
 			yaffs_UpdateDirtyDirectories(dev);
@@ -2355,9 +2466,22 @@ static int yaffs_BackgroundThread(void *data)
 		if(time_after(now,next_gc) && yaffs_bg_enable){
 			if(!dev->isCheckpointed){
 				urgency = yaffs_bg_gc_urgency(dev);
-				gcResult = yaffs_BackgroundGarbageCollect(dev, urgency);
+				urgent = (urgency > 1);
+				idle_at = context->lastActivity +
+					msecs_to_jiffies(yaffs_bg_idle_ms);
+				idle = !time_before(now, idle_at);
+				if(idle)
+					urgency = yaffs_bg_gc_idle_urgency(dev, urgency);
+
+				/* Stay out of the way of foreground work
+				 * unless free space is getting short.
+				 */
+				if(idle || urgency > 1)
+					gcResult = yaffs_BackgroundGarbageCollect(dev, urgency);
 				if(urgency > 1)
 					next_gc = now + HZ/20+1;
+				else if(!idle)
+					next_gc = idle_at + 1;
 				else if(urgency > 0)
 					next_gc = now + HZ/10+1;
 				else
@@ -2369,6 +2493,14 @@ static int yaffs_BackgroundThread(void *data)
 				next_gc = next_dir_update;
 		}
 		yaffs_GrossUnlock(dev);
+
+#ifdef CONFIG_HAS_WAKELOCK
+		/* Optionally keep the system up until urgent gc is done */
+		if(yaffs_bg_wakelock && urgent)
+			wake_lock(&context->bgWakeLock);
+		else
+			wake_unlock(&context->bgWakeLock);
+#endif
 #if 1
 		expires = next_dir_update;
 		if (time_before(next_gc,expires))
@@ -2402,6 +2534,10 @@ static int yaffs_BackgroundStart(yaffs_Device *dev)
 		return -1;
 
 	context->bgRunning = 1;
+	context->lastActivity = jiffies;
+#ifdef CONFIG_HAS_WAKELOCK
+	wake_lock_init(&context->bgWakeLock, WAKE_LOCK_SUSPEND, "yaffs_bg_gc");
+#endif
 
 	context->bgThread = kthread_run(yaffs_BackgroundThread,
 	                        (void *)dev,"yaffs-bg-%d",context->mount_id);
@@ -2410,6 +2546,9 @@ static int yaffs_BackgroundStart(yaffs_Device *dev)
 		retval = PTR_ERR(context->bgThread);
 		context->bgThread = NULL;
 		context->bgRunning = 0;
+#ifdef CONFIG_HAS_WAKELOCK
+		wake_lock_destroy(&context->bgWakeLock);
+#endif
 	}
 	return retval;
 }
@@ -2423,6 +2562,9 @@ static void yaffs_BackgroundStop(yaffs_Device *dev)
 	if( ctxt->bgThread){
 		kthread_stop(ctxt->bgThread);
 		ctxt->bgThread = NULL;
+#ifdef CONFIG_HAS_WAKELOCK
+		wake_lock_destroy(&ctxt->bgWakeLock);
+#endif
 	}
 }
 #else
@@ -3214,6 +3356,7 @@ static char *yaffs_dump_dev_part1(char *buf, yaffs_Device * dev)
 	buf += sprintf(buf, "chunkGroupSize..... %d\n", dev->chunkGroupSize);
 	buf += sprintf(buf, "nErasedBlocks...... %d\n", dev->nErasedBlocks);
 	buf += sprintf(buf, "blocksInCheckpoint. %d\n", dev->blocksInCheckpoint);
+	buf += sprintf(buf, "checkpointStale.... %d\n", dev->checkpointStale);
 	buf += sprintf(buf, "\n");
 	buf += sprintf(buf, "nTnodes............ %d\n", dev->nTnodes);
 	buf += sprintf(buf, "nObjects........... %d\n", dev->nObjects);
@@ -3228,6 +3371,9 @@ static char *yaffs_dump_dev_part1(char *buf, yaffs_Device * dev)
 	buf += sprintf(buf, "oldestDirtyGCs..... %u\n", dev->oldestDirtyGCs);
 	buf += sprintf(buf, "nGCBlocks.......... %u\n", dev->nGCBlocks);
 	buf += sprintf(buf, "backgroundGCs...... %u\n", dev->backgroundGCs);
+	buf += sprintf(buf, "foregroundGCs...... %u\n", dev->foregroundGCs);
+	buf += sprintf(buf, "foregroundGCBlocks. %u\n", dev->foregroundGCBlocks);
+	buf += sprintf(buf, "backgroundGCBlocks. %u\n", dev->backgroundGCBlocks);
 	buf += sprintf(buf, "nRetriedWrites..... %u\n", dev->nRetriedWrites);
 	buf += sprintf(buf, "nRetireBlocks...... %u\n", dev->nRetiredBlocks);
 	buf += sprintf(buf, "eccFixed........... %u\n", dev->eccFixed);
@@ -3235,6 +3381,8 @@ static char *yaffs_dump_dev_part1(char *buf, yaffs_Device * dev)
 	buf += sprintf(buf, "tagsEccFixed....... %u\n", dev->tagsEccFixed);
 	buf += sprintf(buf, "tagsEccUnfixed..... %u\n", dev->tagsEccUnfixed);
 	buf += sprintf(buf, "cacheHits.......... %u\n", dev->cacheHits);
+	buf += sprintf(buf, "tnodeCacheHits..... %u\n", dev->tnodeCacheHits);
+	buf += sprintf(buf, "tnodeCacheMisses... %u\n", dev->tnodeCacheMisses);
 	buf += sprintf(buf, "nDeletedFiles...... %u\n", dev->nDeletedFiles);
 	buf += sprintf(buf, "nUnlinkedFiles..... %u\n", dev->nUnlinkedFiles);
 	buf += sprintf(buf, "refreshCount....... %u\n", dev->refreshCount);
@@ -767,6 +767,24 @@ void yaffs2_InvalidateCheckpoint(yaffs_Device *dev)
 		dev->param.markSuperBlockDirty(dev);
 }
 
+/*
+ * Called before writing a chunk. Unlike a block erasure, a chunk write does
+ * not disturb anything the checkpoint describes, so keep the checkpoint
+ * on flash and let the next mount roll it forward over the chunks written
+ * since (see yaffs2_CheckpointRollForward()).
+ */
+void yaffs2_StaleCheckpoint(yaffs_Device *dev)
+{
+	if (dev->isCheckpointed) {
+		dev->isCheckpointed = 0;
+		dev->checkpointStale = 1;
+	} else if (!dev->checkpointStale && dev->blocksInCheckpoint > 0)
+		yaffs2_CheckpointInvalidateStream(dev);
+
+	if (dev->param.markSuperBlockDirty)
+		dev->param.markSuperBlockDirty(dev);
+}
+
 
 int yaffs_CheckpointSave(yaffs_Device *dev)
 {
@@ -787,6 +805,8 @@ int yaffs_CheckpointSave(yaffs_Device *dev)
 	return dev->isCheckpointed;
 }
 
+static int yaffs2_CheckpointRollForward(yaffs_Device *dev);
+
 int yaffs2_CheckpointRestore(yaffs_Device *dev)
 {
 	int retval;
@@ -794,6 +814,9 @@ int yaffs2_CheckpointRestore(yaffs_Device *dev)
 
 	retval = yaffs2_ReadCheckpointData(dev);
 
+	if (retval && !yaffs2_CheckpointRollForward(dev))
+		retval = 0;
+
 	if (dev->isCheckpointed) {
 		yaffs_VerifyObjects(dev);
 		yaffs_VerifyBlocks(dev);
@@ -909,6 +932,341 @@ static int yaffs2_ybicmp(const void *a, const void *b)
 		return aseq - bseq;
 }
 
+/*
+ * Checkpoint roll-forward.
+ *
+ * A chunk write only marks the checkpoint stale (yaffs2_StaleCheckpoint()),
+ * the first block erasure destroys it. So while a stale checkpoint is still
+ * on flash, every chunk it refers to is intact and everything written since
+ * went into the tail of the checkpointed allocation block and then into
+ * blocks the checkpoint recorded as empty, in sequence number order.
+ *
+ * Replaying those chunks the way they were applied at run time rebuilds the
+ * state without scanning the whole device. Anything that does not fit that
+ * picture makes the roll-forward fail, and the caller falls back to a full
+ * backwards scan.
+ */
+
+static int yaffs2_RollForwardChunk(yaffs_Device *dev, yaffs_BlockInfo *bi,
+				int chunk, yaffs_ExtendedTags *tags,
+				__u8 *chunkData, yaffs_Object **hardList)
+{
+	yaffs_ExtendedTags ohTags;
+	yaffs_ObjectHeader *oh;
+	yaffs_Object *in;
+	yaffs_Object *parent;
+	yaffs_Object *shadowed;
+	int prevChunk;
+	int objectType;
+	int parentObjectId;
+	int fileSize;
+	int isShrink;
+	int equivalentObjectId;
+	int shadows = 0;
+	int isNew = 0;
+
+	yaffs_SetChunkBit(dev, chunk / dev->param.nChunksPerBlock,
+			chunk % dev->param.nChunksPerBlock);
+	bi->pagesInUse++;
+	dev->nFreeChunks--;
+
+	in = yaffs_FindObjectByNumber(dev, tags->objectId);
+
+	if (tags->chunkId > 0) {
+		/* Data chunk, as in yaffs_WriteChunkDataToObject() */
+		__u32 endpos;
+
+		if (!in || in->variantType != YAFFS_OBJECT_TYPE_FILE)
+			return 0;
+
+		prevChunk = yaffs_FindChunkInFile(in, tags->chunkId, NULL);
+		if (!yaffs_PutChunkIntoFile(in, tags->chunkId, chunk, 0))
+			return 0;
+		if (prevChunk > 0)
+			yaffs_DeleteChunk(dev, prevChunk, 1, __LINE__);
+
+		endpos = (tags->chunkId - 1) * dev->nDataBytesPerChunk +
+			tags->byteCount;
+		if (in->variant.fileVariant.fileSize < endpos)
+			in->variant.fileVariant.fileSize = endpos;
+		return 1;
+	}
+
+	/* Object header, as in yaffs_UpdateObjectHeader().
+	 * The tags carry all we need unless the header shadows an object.
+	 */
+	if (!tags->extraHeaderInfoAvailable || tags->extraShadows) {
+		yaffs_ReadChunkWithTagsFromNAND(dev, chunk, chunkData, &ohTags);
+		if (ohTags.eccResult == YAFFS_ECC_RESULT_UNFIXED)
+			return 0;
+
+		oh = (yaffs_ObjectHeader *) chunkData;
+		if (dev->param.inbandTags) {
+			oh->shadowsObject = oh->inbandShadowsObject;
+			oh->isShrink = oh->inbandIsShrink;
+		}
+
+		objectType = oh->type;
+		parentObjectId = oh->parentObjectId;
+		fileSize = oh->fileSize;
+		isShrink = oh->isShrink;
+		equivalentObjectId = oh->equivalentObjectId;
+		shadows = oh->shadowsObject;
+	} else {
+		objectType = tags->extraObjectType;
+		parentObjectId = tags->extraParentObjectId;
+		fileSize = tags->extraFileLength;
+		isShrink = tags->extraIsShrinkHeader;
+		equivalentObjectId = tags->extraEquivalentObjectId;
+	}
+
+	if (!in) {
+		in = yaffs_FindOrCreateObjectByNumber(dev, tags->objectId,
+						objectType);
+		if (!in)
+			return 0;
+		isNew = 1;
+	}
+
+	if (in->variantType != objectType) {
+		T(YAFFS_TRACE_SCAN,
+		  (TSTR("Roll forward: object %d type %d, header type %d"
+		  TENDSTR), in->objectId, in->variantType, objectType));
+		return 0;
+	}
+
+	if (in->hdrChunk > 0)
+		yaffs_DeleteChunk(dev, in->hdrChunk, 1, __LINE__);
+	in->hdrChunk = chunk;
+	in->serial++;
+
+	/* Attributes, name and alias get loaded from the new header on
+	 * demand, like for any other object restored from the checkpoint.
+	 */
+	if (!in->lazyLoaded && in->variantType == YAFFS_OBJECT_TYPE_SYMLINK &&
+		in->variant.symLinkVariant.alias) {
+		YFREE(in->variant.symLinkVariant.alias);
+		in->variant.symLinkVariant.alias = NULL;
+	}
+	in->lazyLoaded = 1;
+
+	if (isShrink)
+		bi->hasShrinkHeader = 1;
+
+	if (shadows > 0) {
+		shadowed = yaffs_FindObjectByNumber(dev, shadows);
+		if (shadowed && !shadowed->fake && !shadowed->unlinked)
+			yaffs_AddObjectToDirectory(dev->unlinkedDir, shadowed);
+	}
+
+	/* Don't fiddle with the directory structure of the fake objects */
+	if (in->fake)
+		return 1;
+
+	parent = yaffs_FindObjectByNumber(dev, parentObjectId);
+	if (!parent || parent->variantType != YAFFS_OBJECT_TYPE_DIRECTORY)
+		return 0;
+
+	/* Objects only move into unlinked or deleted, never back out. Coming
+	 * back means the object number was reused, leave that to the scan.
+	 */
+	if (in->unlinked && parent != dev->unlinkedDir &&
+		parent != dev->deletedDir)
+		return 0;
+
+	if (in->parent != parent)
+		yaffs_AddObjectToDirectory(parent, in);
+
+	switch (in->variantType) {
+	case YAFFS_OBJECT_TYPE_FILE:
+		if (fileSize < in->variant.fileVariant.fileSize)
+			yaffs_PruneResizedChunks(in, fileSize);
+		in->variant.fileVariant.fileSize = fileSize;
+		break;
+	case YAFFS_OBJECT_TYPE_HARDLINK:
+		if (isNew && !in->unlinked) {
+			in->variant.hardLinkVariant.equivalentObjectId =
+				equivalentObjectId;
+			in->hardLinks.next = (struct ylist_head *) *hardList;
+			*hardList = in;
+		}
+		break;
+	default:
+		break;
+	}
+
+	return 1;
+}
+
+static int yaffs2_RollForwardBlock(yaffs_Device *dev, int blk, int c,
+				__u8 *chunkData, yaffs_Object **hardList,
+				int *nChunks, int *nTorn)
+{
+	yaffs_BlockInfo *bi = yaffs_GetBlockInfo(dev, blk);
+	yaffs_ExtendedTags tags;
+	int chunk;
+
+	for (; c < dev->param.nChunksPerBlock; c++) {
+		chunk = blk * dev->param.nChunksPerBlock + c;
+
+		yaffs_ReadChunkWithTagsFromNAND(dev, chunk, NULL, &tags);
+
+		/* Writes never skip ahead within a block, so the first
+		 * unused chunk ends the block.
+		 */
+		if (!tags.chunkUsed)
+			break;
+
+		/* A torn or failed write, left for gc like the scan does */
+		if (tags.eccResult == YAFFS_ECC_RESULT_UNFIXED ||
+			tags.objectId > YAFFS_MAX_OBJECT_ID ||
+			tags.chunkId > YAFFS_MAX_CHUNK_ID ||
+			(tags.chunkId > 0 && tags.byteCount > dev->nDataBytesPerChunk) ||
+			tags.sequenceNumber != bi->sequenceNumber) {
+			T(YAFFS_TRACE_SCAN,
+			  (TSTR("Roll forward: chunk (%d:%d) ignored" TENDSTR),
+			  blk, c));
+			(*nTorn)++;
+			continue;
+		}
+
+		if (!yaffs2_RollForwardChunk(dev, bi, chunk, &tags, chunkData,
+						hardList)) {
+			T(YAFFS_TRACE_SCAN,
+			  (TSTR("Roll forward: chunk (%d:%d) obj %d id %d failed"
+			  TENDSTR), blk, c, tags.objectId, tags.chunkId));
+			return 0;
+		}
+		(*nChunks)++;
+	}
+
+	return 1;
+}
+
+static int yaffs2_CheckpointRollForward(yaffs_Device *dev)
+{
+	yaffs_BlockIndex *blockIndex = NULL;
+	int altBlockIndex = 0;
+	int nBlocks = dev->internalEndBlock - dev->internalStartBlock + 1;
+	int nBlocksToReplay = 0;
+	int nChunks = 0;
+	int nTorn = 0;
+	yaffs_Object *hardList = NULL;
+	yaffs_BlockState state;
+	yaffs_BlockInfo *bi;
+	__u32 checkpointSequence = dev->sequenceNumber;
+	__u32 sequenceNumber;
+	__u8 *chunkData;
+	int blk;
+	int i;
+	int ok = 1;
+
+	blockIndex = YMALLOC(nBlocks * sizeof(yaffs_BlockIndex));
+	if (!blockIndex) {
+		blockIndex = YMALLOC_ALT(nBlocks * sizeof(yaffs_BlockIndex));
+		altBlockIndex = 1;
+	}
+	if (!blockIndex)
+		return 0;
+
+	/* Find the blocks that have been written since the checkpoint */
+	for (blk = dev->internalStartBlock; ok && blk <= dev->internalEndBlock; blk++) {
+		bi = yaffs_GetBlockInfo(dev, blk);
+		if (bi->blockState != YAFFS_BLOCK_STATE_EMPTY)
+			continue;
+
+		yaffs_QueryInitialBlockState(dev, blk, &state, &sequenceNumber);
+
+		if (state == YAFFS_BLOCK_STATE_EMPTY)
+			continue;
+
+		if (state == YAFFS_BLOCK_STATE_NEEDS_SCANNING &&
+		    sequenceNumber > checkpointSequence &&
+		    sequenceNumber < YAFFS_HIGHEST_SEQUENCE_NUMBER) {
+			blockIndex[nBlocksToReplay].seq = sequenceNumber;
+			blockIndex[nBlocksToReplay].block = blk;
+			nBlocksToReplay++;
+		} else {
+			T(YAFFS_TRACE_CHECKPOINT,
+			  (TSTR("Roll forward: block %d state %d seq %d unexpected"
+			  TENDSTR), blk, state, sequenceNumber));
+			ok = 0;
+		}
+	}
+
+	yaffs_qsort(blockIndex, nBlocksToReplay, sizeof(yaffs_BlockIndex),
+			yaffs2_ybicmp);
+
+	chunkData = yaffs_GetTempBuffer(dev, __LINE__);
+
+	if (ok && dev->allocationBlock > 0)
+		ok = yaffs2_RollForwardBlock(dev, dev->allocationBlock,
+				dev->allocationPage, chunkData, &hardList,
+				&nChunks, &nTorn);
+
+	/* Whatever was written after the checkpoint may have been cut short
+	 * by a power loss, so don't append to it (same as after a scan).
+	 * A torn chunk still leaves its page programmed.
+	 */
+	if (ok && (nChunks > 0 || nTorn > 0 || nBlocksToReplay > 0)) {
+		blk = dev->allocationBlock;
+		yaffs_SkipRestOfBlock(dev);
+		if (blk > 0) {
+			bi = yaffs_GetBlockInfo(dev, blk);
+			if (bi->pagesInUse == 0 && !bi->hasShrinkHeader &&
+			    bi->blockState == YAFFS_BLOCK_STATE_FULL)
+				yaffs_BlockBecameDirty(dev, blk);
+		}
+	}
+
+	for (i = 0; ok && i < nBlocksToReplay; i++) {
+		YYIELD();
+
+		blk = blockIndex[i].block;
+		bi = yaffs_GetBlockInfo(dev, blk);
+
+		/* Allocating, so that deletions don't erase it under us */
+		bi->blockState = YAFFS_BLOCK_STATE_ALLOCATING;
+		bi->sequenceNumber = blockIndex[i].seq;
+		dev->sequenceNumber = blockIndex[i].seq;
+		dev->nErasedBlocks--;
+
+		ok = yaffs2_RollForwardBlock(dev, blk, 0, chunkData,
+					&hardList, &nChunks, &nTorn);
+
+		bi->blockState = YAFFS_BLOCK_STATE_FULL;
+		if (ok && bi->pagesInUse == 0 && !bi->hasShrinkHeader)
+			yaffs_BlockBecameDirty(dev, blk);
+	}
+
+	yaffs_ReleaseTempBuffer(dev, chunkData, __LINE__);
+
+	if (altBlockIndex)
+		YFREE_ALT(blockIndex);
+	else
+		YFREE(blockIndex);
+
+	if (ok)
+		yaffs_HardlinkFixup(dev, hardList);
+
+	T(YAFFS_TRACE_CHECKPOINT,
+	  (TSTR("Roll forward %s: %d blocks, %d chunks, %d torn" TENDSTR),
+	  ok ? "done" : "failed", nBlocksToReplay, nChunks, nTorn));
+
+	if (!ok) {
+		dev->isCheckpointed = 0;
+		dev->checkpointStale = 0;
+	} else if (nChunks > 0 || nTorn > 0 || nBlocksToReplay > 0) {
+		/* Keep the checkpoint for the next mount unless the replay
+		 * had to erase a block.
+		 */
+		dev->isCheckpointed = 0;
+		dev->checkpointStale = (dev->blocksInCheckpoint > 0);
+	}
+
+	return ok;
+}
+
 int yaffs2_ScanBackwards(yaffs_Device *dev)
 {
 	yaffs_ExtendedTags tags;
@@ -27,6 +27,7 @@ int yaffs2_CalcCheckpointBlocksRequired(yaffs_Device *dev);
 
 
 void yaffs2_InvalidateCheckpoint(yaffs_Device *dev);
+void yaffs2_StaleCheckpoint(yaffs_Device *dev);
 int yaffs2_CheckpointSave(yaffs_Device *dev);
 int yaffs2_CheckpointRestore(yaffs_Device *dev);
 
@@ -57,12 +57,17 @@ struct pmem_region {
 	unsigned long len;
 };
 
+struct vm_area_struct;
+
 #ifdef CONFIG_ANDROID_PMEM
 int is_pmem_file(struct file *file);
 int get_pmem_file(int fd, unsigned long *start, unsigned long *vstart,
 		  unsigned long *end, struct file **filp);
 int get_pmem_user_addr(struct file *file, unsigned long *start,
 		       unsigned long *end);
+int get_pmem_user_phys(struct vm_area_struct *vma, unsigned long vaddr,
+		       unsigned long len, unsigned long *paddr,
+		       struct file **filp);
 void put_pmem_file(struct file* file);
 void flush_pmem_file(struct file *file, unsigned long start, unsigned long len);
 int pmem_setup(struct android_pmem_platform_data *pdata,
@@ -78,6 +83,10 @@ static inline int get_pmem_file(int fd, unsigned long *start,
 				struct file **filp) { return -ENOSYS; }
 static inline int get_pmem_user_addr(struct file *file, unsigned long *start,
 				     unsigned long *end) { return -ENOSYS; }
+static inline int get_pmem_user_phys(struct vm_area_struct *vma,
+				     unsigned long vaddr, unsigned long len,
+				     unsigned long *paddr,
+				     struct file **filp) { return -ENOSYS; }
 static inline void put_pmem_file(struct file* file) { return; }
 static inline void flush_pmem_file(struct file *file, unsigned long start,
 				   unsigned long len) { return; }
@@ -32,9 +32,15 @@ int ispdss_begin(struct isp_node *pipe, u32 input_buffer_index,
 		 int output_buffer_index, u32 out_off, u32 out_phy_add,
 		 u32 in_phy_add, u32 in_off);
 
+int ispdss_begin_async(struct isp_node *pipe, u32 input_buffer_index,
+		 int output_buffer_index, u32 out_off, u32 out_phy_add,
+		 u32 in_phy_add, u32 in_off);
+
 int ispdss_configure(struct isp_node *pipe, ispdss_callback callback,
 		  u32 num_video_buffers, void *arg1);
 
+void ispdss_abort(void);
+
 void ispdss_put_resource(void);
 
 int ispdss_get_resource(void);
@@ -10,6 +10,7 @@
 
 #include <linux/interrupt.h>
 #include <linux/device.h>
+#include <linux/completion.h>
 
 struct request;
 struct mmc_data;
@@ -115,6 +116,7 @@ struct mmc_data {
 
 	unsigned int		sg_len;		/* size of scatter list */
 	struct scatterlist	*sg;		/* I/O scatter list */
+	s32			host_cookie;	/* host private data */
 };
 
 struct mmc_request {
@@ -124,11 +126,27 @@ struct mmc_request {
 
 	void			*done_data;	/* completion data */
 	void			(*done)(struct mmc_request *);/* completion function */
+	struct completion	completion;	/* used by mmc_start_req */
 };
 
 struct mmc_host;
 struct mmc_card;
+struct mmc_async_req;
 
+/*
+ * A request which may be started while the previous one is still in
+ * flight; see mmc_start_req().  @err_check is run once the data phase
+ * has completed and returns 0 on success or a caller defined status.
+ */
+struct mmc_async_req {
+	/* active mmc request */
+	struct mmc_request	*mrq;
+	/* check error status of a completed request */
+	int (*err_check)(struct mmc_card *, struct mmc_async_req *);
+};
+
+extern struct mmc_async_req *mmc_start_req(struct mmc_host *,
+					   struct mmc_async_req *, int *);
 extern void mmc_wait_for_req(struct mmc_host *, struct mmc_request *);
 extern int mmc_wait_for_cmd(struct mmc_host *, struct mmc_command *, int);
 extern int mmc_wait_for_app_cmd(struct mmc_host *, struct mmc_card *,
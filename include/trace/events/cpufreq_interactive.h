@@ -0,0 +1,73 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM cpufreq_interactive
+
+#if !defined(_TRACE_CPUFREQ_INTERACTIVE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_CPUFREQ_INTERACTIVE_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(set,
+
+	TP_PROTO(u32 cpu_id, unsigned long load, unsigned long curfreq,
+		 unsigned long targfreq),
+
+	TP_ARGS(cpu_id, load, curfreq, targfreq),
+
+	TP_STRUCT__entry(
+		__field(	u32,		cpu_id		)
+		__field(	unsigned long,	load		)
+		__field(	unsigned long,	curfreq		)
+		__field(	unsigned long,	targfreq	)
+	),
+
+	TP_fast_assign(
+		__entry->cpu_id = cpu_id;
+		__entry->load = load;
+		__entry->curfreq = curfreq;
+		__entry->targfreq = targfreq;
+	),
+
+	TP_printk("cpu=%u load=%lu cur=%lu targ=%lu",
+		  __entry->cpu_id, __entry->load, __entry->curfreq,
+		  __entry->targfreq)
+);
+
+DEFINE_EVENT(set, cpufreq_interactive_up,
+
+	TP_PROTO(u32 cpu_id, unsigned long load, unsigned long curfreq,
+		 unsigned long targfreq),
+
+	TP_ARGS(cpu_id, load, curfreq, targfreq)
+);
+
+DEFINE_EVENT(set, cpufreq_interactive_down,
+
+	TP_PROTO(u32 cpu_id, unsigned long load, unsigned long curfreq,
+		 unsigned long targfreq),
+
+	TP_ARGS(cpu_id, load, curfreq, targfreq)
+);
+
+TRACE_EVENT(cpufreq_interactive_boost,
+
+	TP_PROTO(unsigned int type, unsigned int code),
+
+	TP_ARGS(type, code),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	type		)
+		__field(	unsigned int,	code		)
+	),
+
+	TP_fast_assign(
+		__entry->type = type;
+		__entry->code = code;
+	),
+
+	TP_printk("input type=%u code=%u", __entry->type, __entry->code)
+);
+
+#endif /* _TRACE_CPUFREQ_INTERACTIVE_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
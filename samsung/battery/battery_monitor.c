@@ -29,6 +29,7 @@
 #include <linux/delay.h>
 #include <linux/mutex.h>
 #include <plat/omap3-gptimer12.h>
+#include <plat/smartreflex.h>
 #include "common.h"
 
 // To access sysfs file system [+]
@@ -1017,7 +1018,11 @@ static void battery_monitor_work_handler( struct work_struct *work )
 //	printk("[BM] MMC2_DAT0 : %x\n", omap_readw(0x4800215c));
 
     if ( device_config->MONITORING_SYSTEM_TEMP )
+    {
         sec_bci.battery.battery_temp = get_system_temperature( TEMP_DEG );
+        /* Let SmartReflex pick the voltages calibrated for this band */
+        omap_sr_temp_notify( sec_bci.battery.battery_temp );
+    }
     else
         sec_bci.battery.battery_temp = 0;
 
@@ -28,6 +28,10 @@ unsigned int j4fs_PORCount=0;
 unsigned int j4fs_rw_start=0;
 j4fs_header ro_j4fs_header[J4FS_MAX_RO_FILES_NUMBER];
 int ro_j4fs_header_count=0;
+j4fs_index rw_j4fs_index[J4FS_MAX_RW_INDEX_NUMBER];
+int rw_j4fs_index_count=0;
+int rw_j4fs_index_valid=0;
+int rw_j4fs_index_empty=0;
 int j4fs_panic=0;
 
 #ifdef J4FS_TRANSACTION_LOGGING
@@ -61,6 +65,7 @@ int fsd_read(j4fs_ctrl *ctl)
 	DWORD offset, matching_offset=0xffffffff, len, count, file_length=0xffffffff;
 	int ret=-1;
 	j4fs_header *header;
+	j4fs_index *index;
 	int file_exist=0, i;
 
 #ifdef __KERNEL__
@@ -117,6 +122,41 @@ int fsd_read(j4fs_ctrl *ctl)
 		goto error1;
 	}
 
+	// the index is dropped whenever the j4fs_header list changes, rebuild it here
+	if(!rw_j4fs_index_valid) fsd_build_rw_index();
+
+	// find object header corresponding to ctl.id in the in-memory index of RW area
+	if(rw_j4fs_index_valid)
+	{
+		// There are no RW files in this partition and this can happen and this is a normal case.
+		if(rw_j4fs_index_empty) {
+			memset(ctl->buffer,0xff,ctl->count);
+			goto error1;
+		}
+
+		for(i=0;i<rw_j4fs_index_count;i++)
+		{
+			index = &rw_j4fs_index[i];
+
+			// File ID is dismatched, so read next file.
+			if(ctl->id && ctl->id!=index->id)
+			{
+				continue;
+			}
+
+			// File ID is matched. we should read lastest object larger than ctl.index, so go ahead.
+			if( ((ctl->index + ctl->count + J4FS_BASIC_UNIT_SIZE-1)/J4FS_BASIC_UNIT_SIZE*J4FS_BASIC_UNIT_SIZE)
+				<= ((index->length + J4FS_BASIC_UNIT_SIZE-1)/J4FS_BASIC_UNIT_SIZE*J4FS_BASIC_UNIT_SIZE) )
+			{
+				matching_offset=index->offset;
+				file_length=index->length;
+			}
+			else file_exist=1;
+		}
+
+		goto got_header;
+	}
+
 	// the start address of the RW area of the device (partition)
 	offset=j4fs_rw_start;
 
@@ -297,6 +337,8 @@ int fsd_write(j4fs_ctrl *ctl)
 
 	T(J4FS_TRACE_FSD,("%s %d: (ino,index)=(%d,0x%08x)\n",__FUNCTION__,__LINE__,ctl->id,ctl->index));
 
+	fsd_invalidate_rw_index();
+
 	if(is_invalid_j4fs_rw_start())
 	{
 		T(J4FS_TRACE_ALWAYS,("%s %d: Error! j4fs_rw_start is invalid(j4fs_rw_start=0x%08x, j4fs_end=0x%08x, ro_j4fs_header_count=0x%08x)\n",
@@ -1146,6 +1188,8 @@ int fsd_unlink(char *filename)
 		return 0;
 	}
 
+	fsd_invalidate_rw_index();
+
 	if(is_invalid_j4fs_rw_start())
 	{
 		T(J4FS_TRACE_ALWAYS,("%s %d: Error! j4fs_rw_start is invalid(j4fs_rw_start=0x%08x, j4fs_end=0x%08x, ro_j4fs_header_count=0x%08x)\n",
@@ -1265,6 +1309,8 @@ int fsd_reclaim()
 	header=(j4fs_header *)buf_header;
 	mst=(j4fs_mst *)buf_mst;
 
+	fsd_invalidate_rw_index();
+
 	// read mst
 	ret = FlashDevRead(&device_info, 0, J4FS_BASIC_UNIT_SIZE, buf_mst);
 	if (error(ret)) {
@@ -1634,6 +1680,8 @@ int fsd_mark_invalid()
 
 	mst=(j4fs_mst *)buf;
 
+	fsd_invalidate_rw_index();
+
 	// read mst
 	ret = FlashDevRead(&device_info, 0, J4FS_BASIC_UNIT_SIZE, buf);
 	if (error(ret)) {
@@ -1853,6 +1901,176 @@ error1:
 
 }
 
+// Build the in-memory index of valid objects of RW area
+int fsd_build_rw_index(void)
+{
+	DWORD offset;
+	j4fs_header *header;
+	int ret=-1;
+
+#ifdef __KERNEL__
+	BYTE *buf;
+	buf=kmalloc(J4FS_BASIC_UNIT_SIZE,GFP_NOFS);
+#else
+	BYTE buf[J4FS_BASIC_UNIT_SIZE];
+#endif
+
+	rw_j4fs_index_valid=0;
+	rw_j4fs_index_empty=0;
+	rw_j4fs_index_count=0;
+
+	if(is_invalid_j4fs_rw_start()) goto error1;
+
+	// the start address of the RW area of the device (partition)
+	offset=j4fs_rw_start;
+
+	// scanning all j4fs_header of RW area.
+	while(offset!=0xffffffff)
+	{
+		// check the partition range
+		j4fs_check_partition_range(offset);
+
+		// read j4fs_header
+		ret = FlashDevRead(&device_info, offset, J4FS_BASIC_UNIT_SIZE, buf);
+		if (error(ret)) {
+			T(J4FS_TRACE_ALWAYS,("%s %d: Error(nErr=0x%08x)\n",__FUNCTION__,__LINE__,ret));
+			goto error1;
+		}
+		header=(j4fs_header *)buf;
+
+		//This j4fs_header cannot be interpreted. Only an empty RW area is indexed, a crashed partition is left to fsd_read.
+		if(header->type!=J4FS_FILE_TYPE)
+		{
+			if(offset!=j4fs_rw_start) goto error1;
+
+			rw_j4fs_index_empty=1;
+			break;
+		}
+
+		// This file was deleted, so read next j4fs_header.
+		if((header->flags&0x1)!=((header->flags&0x2)>>1))
+		{
+			offset=header->link;
+			continue;
+		}
+
+		// Too many valid objects, fsd_read walks the flash as before.
+		if(rw_j4fs_index_count>=J4FS_MAX_RW_INDEX_NUMBER)
+		{
+			T(J4FS_TRACE_FSD,("%s %d: too many rw objects, index is not used\n",__FUNCTION__,__LINE__));
+			goto error1;
+		}
+
+		rw_j4fs_index[rw_j4fs_index_count].offset=offset;
+		rw_j4fs_index[rw_j4fs_index_count].id=header->id;
+		rw_j4fs_index[rw_j4fs_index_count].length=header->length;
+		rw_j4fs_index_count++;
+
+		offset=header->link;
+	}
+
+	rw_j4fs_index_valid=1;
+
+	T(J4FS_TRACE_FSD,("%s %d: (count,empty)=(%d,%d)\n",__FUNCTION__,__LINE__,rw_j4fs_index_count,rw_j4fs_index_empty));
+
+#ifdef __KERNEL__
+	kfree(buf);
+#endif
+	return J4FS_SUCCESS;
+
+error1:
+	rw_j4fs_index_empty=0;
+	rw_j4fs_index_count=0;
+#ifdef __KERNEL__
+	kfree(buf);
+#endif
+	return J4FS_FAIL;
+}
+
+// Drop the in-memory index of RW area, every change of the j4fs_header list must call this
+void fsd_invalidate_rw_index(void)
+{
+	rw_j4fs_index_valid=0;
+}
+
+// Get the data length of the latest valid object of 'id' on flash, fsd_write() can only append at or before it
+int fsd_get_length(DWORD id, DWORD *length)
+{
+	DWORD offset;
+	j4fs_header *header;
+	int i, ret=-1, found=0;
+
+#ifdef __KERNEL__
+	BYTE *buf;
+#else
+	BYTE buf[J4FS_BASIC_UNIT_SIZE];
+#endif
+
+	*length=0;
+
+	if(is_invalid_j4fs_rw_start()) return J4FS_FAIL;
+
+	if(!rw_j4fs_index_valid) fsd_build_rw_index();
+
+	if(rw_j4fs_index_valid)
+	{
+		for(i=0;i<rw_j4fs_index_count;i++)
+		{
+			if(rw_j4fs_index[i].id!=id) continue;
+
+			*length=rw_j4fs_index[i].length;
+			found=1;
+		}
+
+		return found ? J4FS_SUCCESS : J4FS_FAIL;
+	}
+
+#ifdef __KERNEL__
+	buf=kmalloc(J4FS_BASIC_UNIT_SIZE,GFP_NOFS);
+	if(!buf) return J4FS_FAIL;
+#endif
+
+	// the start address of the RW area of the device (partition)
+	offset=j4fs_rw_start;
+
+	while(offset!=0xffffffff)
+	{
+		// check the partition range
+		j4fs_check_partition_range(offset);
+
+		// read j4fs_header
+		ret = FlashDevRead(&device_info, offset, J4FS_BASIC_UNIT_SIZE, buf);
+		if (error(ret)) {
+			T(J4FS_TRACE_ALWAYS,("%s %d: Error(nErr=0x%08x)\n",__FUNCTION__,__LINE__,ret));
+			goto error1;
+		}
+		header=(j4fs_header *)buf;
+
+		if(header->type!=J4FS_FILE_TYPE) break;
+
+		// valid object with matching ID, go ahead to find the latest one
+		if((id==header->id) && ((header->flags&0x1)==((header->flags&0x2)>>1)))
+		{
+			*length=header->length;
+			found=1;
+		}
+
+		offset=header->link;
+	}
+
+#ifdef __KERNEL__
+	kfree(buf);
+#endif
+	return found ? J4FS_SUCCESS : J4FS_FAIL;
+
+error1:
+	*length=0;
+#ifdef __KERNEL__
+	kfree(buf);
+#endif
+	return J4FS_FAIL;
+}
+
 #ifdef J4FS_TRANSACTION_LOGGING
 int fsd_initialize_transaction()
 {
@@ -1925,6 +2143,7 @@ int fsd_panic()
 #endif
 
 	j4fs_panic=1;
+	fsd_invalidate_rw_index();
 
 	// Marking j4fs panic by writing J4FS_PANIC to mst->status
 	ret = FlashDevRead(&device_info, 0, J4FS_BASIC_UNIT_SIZE, buf);
@@ -113,6 +113,11 @@
  */
 #define J4FS_MAX_FILE_NUM	256
 
+/*
+ * Max number of valid RW objects kept in the in-memory index
+ */
+#define J4FS_MAX_RW_INDEX_NUMBER	J4FS_MAX_FILE_NUM
+
 /*
  * Special inode numbers
  */
@@ -393,6 +398,18 @@ typedef struct {
 	DWORD rw_start;
 } j4fs_mst;
 
+/*
+  * In-memory index entry for a valid object of RW area. fsd_read() uses it instead of walking the j4fs_header list on flash.
+  * offset : offset of the object's j4fs_header
+  * id : file identifier(inode number)
+  * length : file data length
+  */
+typedef struct {
+	DWORD offset;
+	DWORD id;
+	DWORD length;
+} j4fs_index;
+
 #ifdef J4FS_TRANSACTION_LOGGING
 /*
   * transaction structure for j4fs crash debugging. size should be 512B.
@@ -470,6 +487,9 @@ extern int fsd_delete(j4fs_ctrl *);
 extern int fsd_special(j4fs_ctrl *);
 extern int fsd_print_meta_data(void);
 extern int fsd_read_ro_header(void);
+extern int fsd_build_rw_index(void);
+extern int fsd_get_length(DWORD id, DWORD *length);
+extern void fsd_invalidate_rw_index(void);
 extern int fsd_mark_invalid(void);
 extern int fsd_reclaim(void);
 extern int fsd_panic(void);
@@ -145,6 +145,7 @@ int j4fs_writepage(struct page *page, struct writeback_control *wbc)
 	char *buffer;
 	int nWritten = 0;
 	unsigned nBytes;
+	DWORD flash_len;
 	j4fs_ctrl ctl;
 	int nErr;
 
@@ -172,6 +173,21 @@ int j4fs_writepage(struct page *page, struct writeback_control *wbc)
 		return 0;
 	}
 
+	/* fsd_write() can't leave a hole, leave the page to writeback in file order */
+	j4fs_GrossLock();
+	if (error(fsd_get_length(inode->i_ino, &flash_len)))
+		flash_len = 0;
+	j4fs_GrossUnlock();
+
+	if (offset > flash_len) {
+		T(J4FS_TRACE_FS,
+			("j4fs_writepage at %08x past flash length %08x, redirty\n",
+			(unsigned)offset, (unsigned)flash_len));
+		redirty_page_for_writepage(wbc, page);
+		unlock_page(page);
+		return 0;
+	}
+
 	end_index = inode->i_size >> PAGE_CACHE_SHIFT;
 
 	/* easy case */
@@ -199,6 +215,8 @@ int j4fs_writepage(struct page *page, struct writeback_control *wbc)
 
 	if(nErr==J4FS_RETRY_WRITE) nErr=fsd_write(&ctl);
 
+	if(nErr!=J4FS_RETRY_WRITE && !error(nErr)) nWritten=nErr;
+
 	T(J4FS_TRACE_FS,
 		("j4fs_writepage: index=%08x,nBytes=%08x,inode.i_size=%05x\n", (unsigned)(page->index << PAGE_CACHE_SHIFT), nBytes,(int)inode->i_size));
 
@@ -213,6 +231,159 @@ int j4fs_writepage(struct page *page, struct writeback_control *wbc)
 
 }
 
+#ifdef CONFIG_SAMSUNG_J4FS_WRITEBACK
+/*
+ * Dirty pages are collected in runs of contiguous pages and each run goes to
+ * flash with one fsd_write(). A write to an object which is not the last one
+ * in the partition makes fsd_write() relocate the whole object, so doing it
+ * once per run instead of once per page saves most of the flash traffic.
+ */
+#define J4FS_WRITEBACK_PAGES	8
+
+struct j4fs_wb_run {
+	struct inode *inode;
+	BYTE *buffer;
+	pgoff_t index;
+	int nr_pages;
+	loff_t flash_len;
+};
+
+static int j4fs_flush_run(struct j4fs_wb_run *run)
+{
+	struct inode *inode = run->inode;
+	loff_t offset = (loff_t) run->index << PAGE_CACHE_SHIFT;
+	loff_t i_size = i_size_read(inode);
+	unsigned nBytes;
+	j4fs_ctrl ctl;
+	int nErr;
+
+	if (!run->nr_pages)
+		return 0;
+
+	nBytes = run->nr_pages << PAGE_CACHE_SHIFT;
+	if (offset + nBytes > i_size)
+		nBytes = i_size - offset;
+
+	run->nr_pages = 0;
+
+	T(J4FS_TRACE_FS,
+		("j4fs_flush_run: ino=%ld,index=%08x,nBytes=%08x\n", inode->i_ino, (unsigned)offset, nBytes));
+
+	j4fs_GrossLock();
+
+	ctl.buffer=run->buffer;
+	ctl.count=nBytes;
+	ctl.id=inode->i_ino;
+	ctl.index=offset;
+
+	nErr=fsd_write(&ctl);
+
+	if(nErr==J4FS_RETRY_WRITE) nErr=fsd_write(&ctl);
+
+	j4fs_GrossUnlock();
+
+	if(nErr==J4FS_RETRY_WRITE || error(nErr) || nErr!=nBytes)
+	{
+		T(J4FS_TRACE_ALWAYS,("%s %d: Error(nErr=0x%x)\n",__FUNCTION__,__LINE__,nErr));
+		mapping_set_error(inode->i_mapping, -ENOSPC);
+		return -ENOSPC;
+	}
+
+	if (offset + nBytes > run->flash_len)
+		run->flash_len = offset + nBytes;
+
+	return 0;
+}
+
+static int j4fs_writepages_fill(struct page *page, struct writeback_control *wbc, void *data)
+{
+	struct j4fs_wb_run *run = data;
+	loff_t i_size = i_size_read(run->inode);
+	loff_t offset = (loff_t) page->index << PAGE_CACHE_SHIFT;
+	char *kaddr;
+	int ret = 0;
+
+	/* page was truncated away, nothing to write */
+	if (offset >= i_size) {
+		unlock_page(page);
+		return 0;
+	}
+
+	if (run->nr_pages &&
+	    (page->index != run->index + run->nr_pages ||
+	     run->nr_pages == J4FS_WRITEBACK_PAGES))
+		ret = j4fs_flush_run(run);
+
+	/* an earlier page was skipped, writing this one would leave a hole */
+	if (!run->nr_pages && offset > run->flash_len) {
+		redirty_page_for_writepage(wbc, page);
+		unlock_page(page);
+		return ret;
+	}
+
+	if (!run->nr_pages)
+		run->index = page->index;
+
+	/* the page is clean now, a later write simply dirties it again */
+	kaddr = kmap_atomic(page, KM_USER0);
+	memcpy(run->buffer + (run->nr_pages << PAGE_CACHE_SHIFT), kaddr, PAGE_CACHE_SIZE);
+	kunmap_atomic(kaddr, KM_USER0);
+	run->nr_pages++;
+
+	unlock_page(page);
+
+	return ret;
+}
+
+int j4fs_writepages(struct address_space *mapping, struct writeback_control *wbc)
+{
+	struct j4fs_wb_run run;
+	struct writeback_control wbc_ordered;
+	DWORD flash_len;
+	int ret, err;
+
+	if(j4fs_panic==1) {
+		T(J4FS_TRACE_ALWAYS,("%s %d: j4fs panic\n",__FUNCTION__,__LINE__));
+		return -ENOSPC;
+	}
+
+	run.buffer = kmalloc(J4FS_WRITEBACK_PAGES << PAGE_CACHE_SHIFT, GFP_NOFS);
+	if (!run.buffer)
+		return generic_writepages(mapping, wbc);
+
+	run.inode = mapping->host;
+	run.index = 0;
+	run.nr_pages = 0;
+
+	j4fs_GrossLock();
+	if (error(fsd_get_length(run.inode->i_ino, &flash_len)))
+		flash_len = 0;
+	j4fs_GrossUnlock();
+	run.flash_len = flash_len;
+
+	/*
+	 * fsd_write() can only extend a file at its end on flash, so always go
+	 * through the whole file from the first page instead of resuming at
+	 * writeback_index.
+	 */
+	wbc_ordered = *wbc;
+	wbc_ordered.range_cyclic = 0;
+	wbc_ordered.range_start = 0;
+	wbc_ordered.range_end = LLONG_MAX;
+
+	ret = write_cache_pages(mapping, &wbc_ordered, j4fs_writepages_fill, &run);
+	err = j4fs_flush_run(&run);
+
+	wbc->nr_to_write = wbc_ordered.nr_to_write;
+	wbc->pages_skipped = wbc_ordered.pages_skipped;
+	wbc->encountered_congestion = wbc_ordered.encountered_congestion;
+
+	kfree(run.buffer);
+
+	return ret ? ret : err;
+}
+#endif
+
 #if (J4FS_USE_WRITE_BEGIN_END > 0)
 int j4fs_write_begin(struct file *filp, struct address_space *mapping,
 				loff_t pos, unsigned len, unsigned flags,
@@ -326,6 +497,30 @@ int j4fs_write_end(struct file *filp, struct address_space *mapping,
 		return -ENOSPC;
 	}
 
+#ifdef CONFIG_SAMSUNG_J4FS_WRITEBACK
+	/* only dirty the page, j4fs_writepages puts it on flash */
+	if (!PageUptodate(pg)) {
+		if (copied < len)
+			copied = 0;
+		else
+			SetPageUptodate(pg);
+	}
+
+	if (copied) {
+		struct inode *inode = mapping->host;
+
+		if (pos + copied > inode->i_size) {
+			i_size_write(inode, pos + copied);
+			inode->i_blocks = (pos + copied + 511) >> 9;
+		}
+		set_page_dirty(pg);
+	}
+
+	unlock_page(pg);
+	page_cache_release(pg);
+	return copied;
+#endif
+
 	kva = kmap(pg);
 	addr = kva + offset_into_page;
 
@@ -878,6 +1073,9 @@ struct inode *j4fs_new_inode(struct inode *dir, struct dentry *dentry, int mode)
 		return NULL;
 	}
 
+	// a new j4fs_header is linked to the list below
+	fsd_invalidate_rw_index();
+
 	T(J4FS_TRACE_FS,("%s %d\n",__FUNCTION__,__LINE__));
 
 	// allocate new inode
@@ -1306,6 +1504,9 @@ int j4fs_fill_super(struct super_block *sb, void *data, int silent)
    		goto failed;
 	}
 
+	// index the RW area once, so reads do not walk the j4fs_header list on flash
+	fsd_build_rw_index();
+
 	return 0;
 
 failed:
@@ -1474,6 +1675,10 @@ module_exit(exit_j4fs_fs)
 const struct address_space_operations j4fs_aops = {
 	.readpage		= j4fs_readpage,
 	.writepage		= j4fs_writepage,
+#ifdef CONFIG_SAMSUNG_J4FS_WRITEBACK
+	.writepages		= j4fs_writepages,
+	.set_page_dirty	= __set_page_dirty_nobuffers,
+#endif
 #if (J4FS_USE_WRITE_BEGIN_END > 0)
 	.write_begin = j4fs_write_begin,
 	.write_end = j4fs_write_end,
@@ -242,6 +242,8 @@ struct fsr_dev
 	struct gendisk		*gd;
 	int			dev_id;
 	struct scatterlist	*sg;
+	struct task_struct	*thread;
+	u32			first_vpn;
 };
 #else
 /* Kernel 2.4 */
@@ -20,6 +20,8 @@
 #include <linux/fs.h>
 #include <linux/version.h>
 #include <linux/proc_fs.h>
+#include <linux/kthread.h>
+#include <linux/scatterlist.h>
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 15)
 #include <linux/platform_device.h>
 #else
@@ -52,6 +54,190 @@ EXPORT_SYMBOL(bml_module_resume);
 
 #endif /* end of CONFIG_PM */
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 31)
+/**
+ * read a run of sectors which is contiguous on the device and in memory
+ * @param dev           : fsr block device
+ * @param sector        : first sector of the run, relative to the partition
+ * @param nsect         : number of sectors in the run
+ * @param buf           : destination buffer
+ * @return              0 on success, -EIO on failure
+ *
+ * The whole run is handed to the BML in one call, so the LLD can use
+ * its multi-page (and multi-plane) read for it.
+ */
+static int bml_read_run(struct fsr_dev *dev, unsigned long sector,
+		unsigned long nsect, char *buf)
+{
+	FSRVolSpec *vs;
+	u32 volume, spp_shift, spp_mask;
+	int ret;
+
+	volume = fsr_vol(dev->gd->first_minor);
+	vs = fsr_get_vol_spec(volume);
+	spp_shift = ffs(vs->nSctsPerPg) - 1;
+	spp_mask = vs->nSctsPerPg - 1;
+
+	/*
+	 * If sector and nsect are aligned with vs->nSctsPerPg,
+	 * you have to use a FSR_BML_Read() function using page unit,
+	 * If not, use a FSR_BML_ReadScts() function using sector unit.
+	 */
+	if (!(sector & spp_mask) && !(nsect & spp_mask))
+	{
+		ret = FSR_BML_Read(volume, dev->first_vpn + (sector >> spp_shift),
+				nsect >> spp_shift, buf, NULL, FSR_BML_FLAG_ECC_ON);
+	}
+	else
+	{
+		ret = FSR_BML_ReadScts(volume, dev->first_vpn + (sector >> spp_shift),
+				sector & spp_mask, nsect, buf, NULL, FSR_BML_FLAG_ECC_ON);
+	}
+
+	if (ret != FSR_BML_SUCCESS)
+	{
+		ERRPRINTK("TINY: transfer error = %X\n", ret);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/**
+ * transfer a whole request from BML to buffer cache
+ * @param dev           : fsr block device
+ * @param req           : request description
+ * @return              0 on success, otherwise on failure
+ *
+ * The request is mapped to a scatterlist and segments which follow
+ * each other in memory are merged, so each BML call covers the longest
+ * possible run instead of one bio segment.
+ */
+static int bml_transfer(struct fsr_dev *dev, struct request *req)
+{
+	struct scatterlist *sg;
+	unsigned long sector, nsect = 0;
+	char *buf = NULL;
+	int nents, i, ret;
+
+	if (!blk_fs_request(req))
+	{
+		return -EIO;
+	}
+
+	if (rq_data_dir(req) != READ)
+	{
+		ERRPRINTK("Unknown request 0x%x\n", (u32) rq_data_dir(req));
+		return -EINVAL;
+	}
+
+	sector = blk_rq_pos(req);
+	nents = blk_rq_map_sg(dev->queue, req, dev->sg);
+
+	for_each_sg(dev->sg, sg, nents, i)
+	{
+		if (buf && buf + (nsect << SECTOR_BITS) == sg_virt(sg))
+		{
+			nsect += sg->length >> SECTOR_BITS;
+			continue;
+		}
+
+		if (buf)
+		{
+			ret = bml_read_run(dev, sector, nsect, buf);
+			if (ret)
+			{
+				return ret;
+			}
+			sector += nsect;
+		}
+
+		buf = sg_virt(sg);
+		nsect = sg->length >> SECTOR_BITS;
+	}
+
+	if (buf)
+	{
+		return bml_read_run(dev, sector, nsect, buf);
+	}
+
+	return 0;
+}
+
+/**
+ * per-device I/O thread which serves the request queue
+ * @param arg           : fsr block device
+ * @return              0
+ *
+ * BML reads poll the OneNAND, so they are done here rather than in the
+ * request function, which runs in the context of the submitter.
+ */
+static int bml_io_thread(void *arg)
+{
+	struct fsr_dev *dev = arg;
+	struct request_queue *rq = dev->queue;
+	struct request *req;
+	int error;
+
+	spin_lock_irq(rq->queue_lock);
+
+	while (1)
+	{
+		/* set before the checks, or a wakeup in between is lost */
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (kthread_should_stop())
+			break;
+
+		req = blk_fetch_request(rq);
+		if (!req)
+		{
+			spin_unlock_irq(rq->queue_lock);
+			schedule();
+			spin_lock_irq(rq->queue_lock);
+			continue;
+		}
+
+		__set_current_state(TASK_RUNNING);
+		spin_unlock_irq(rq->queue_lock);
+
+		DEBUG(DL3,"TINY[I]: minor(%d)\n", dev->gd->first_minor);
+		error = bml_transfer(dev, req);
+		DEBUG(DL3,"TINY[O]: minor(%d)\n", dev->gd->first_minor);
+
+		spin_lock_irq(rq->queue_lock);
+		__blk_end_request_all(req, error);
+	}
+
+	__set_current_state(TASK_RUNNING);
+	spin_unlock_irq(rq->queue_lock);
+
+	return 0;
+}
+
+/**
+ * request function, it only kicks the I/O thread
+ * @param rq    : request queue which is created by blk_init_queue()
+ * @return              none
+ */
+static void bml_request(struct request_queue *rq)
+{
+	struct fsr_dev *dev;
+	struct request *req;
+
+	dev = rq->queuedata;
+
+	if (!dev->thread)
+	{
+		while ((req = blk_fetch_request(rq)) != NULL)
+		{
+			__blk_end_request_all(req, -ENODEV);
+		}
+		return;
+	}
+
+	wake_up_process(dev->thread);
+}
+#else
 /**
  * transger data from BML to buffer cache
  * @param volume        : device number
@@ -61,11 +247,7 @@ EXPORT_SYMBOL(bml_module_resume);
  *
  * It will erase a block before it do write the data
  */
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 31)
-static int bml_transfer(u32 volume, u32 partno, const struct request *req, u32 data_len)
-#else
 static int bml_transfer(u32 volume, u32 partno, const struct request *req)
-#endif
 {
 	unsigned long sector, nsect;
 	char *buf;
@@ -81,13 +263,8 @@ static int bml_transfer(u32 volume, u32 partno, const struct request *req)
 		return 0;
 	}
 
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 31)
-	sector = blk_rq_pos(req);
-	nsect = data_len >> 9;
-#else
 	sector = req->sector;
 	nsect = req->current_nr_sectors;
-#endif
 	buf = req->buffer;
 	
 	vs = fsr_get_vol_spec(volume);
@@ -156,10 +333,6 @@ static void bml_request(struct request_queue *rq)
 	int ret;
 #endif
 	int trans_ret;
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 31)
-	int error = 0;
-	u32 len = 0;
-#endif
 
 	FSRVolSpec *vs;
 
@@ -169,11 +342,7 @@ static void bml_request(struct request_queue *rq)
 	if (dev->req)
 		return;
 
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 31)
-	while ((dev->req = req = blk_peek_request(rq)) != NULL)
-#else
 	while ((dev->req = req = elv_next_request(rq)) != NULL) 
-#endif
 	{
 		spin_unlock_irq(rq->queue_lock);
 		
@@ -185,23 +354,6 @@ static void bml_request(struct request_queue *rq)
 		
 		DEBUG(DL3,"TINY[I]: volume(%d), partno(%d)\n", volume, partno);
 
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 31)
-		len = blk_rq_cur_bytes(req);
-		if (!( blk_rq_pos(req) & spp_mask) && ( blk_rq_cur_sectors(req) != blk_rq_sectors(req)))
-		{
-			blk_rq_map_sg(rq, req, dev->sg);
-			if (!((dev->sg->length >> SECTOR_BITS) & 0x7))
-			{
-				len = dev->sg->length;
-			}
-			if (len > blk_rq_bytes(req))
-			{
-				len = blk_rq_bytes(req);
-			}
-
-		}
-		trans_ret = bml_transfer(volume, partno, req, len);
-#else
 		if (!(req->sector & spp_mask) && (req->current_nr_sectors != req->nr_sectors))
 		{
 			blk_rq_map_sg(rq, req, dev->sg);
@@ -215,23 +367,9 @@ static void bml_request(struct request_queue *rq)
 			}
 		}
 		trans_ret = bml_transfer(volume, partno, req);
-#endif
 		
 		spin_lock_irq(rq->queue_lock);
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 31)
-		if (trans_ret)
-		{
-			error = 0;
-		} else
-		{
-			error = -EIO;
-		}
-		/* don't need to check if request is finished */
-		if (blk_rq_sectors(req) <= (len >> 9))
-			list_del_init(&req->queuelist);
-		__blk_end_request(req, error, len);
-
-#elif LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 25)
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 25)
 		req->hard_cur_sectors = req->current_nr_sectors;
 		end_request(req, trans_ret);
 #else	
@@ -253,6 +391,7 @@ static void bml_request(struct request_queue *rq)
 
 	DEBUG(DL3,"TINY[O]\n");
 }
+#endif /* LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 31) */
 
 /**
  * add each partitions as disk
@@ -263,7 +402,7 @@ static void bml_request(struct request_queue *rq)
  */
 static int bml_add_disk(u32 volume, u32 partno)
 {
-	u32 minor, sectors;
+	u32 minor, sectors, nPgsPerUnit;
 	struct fsr_dev *dev;
 	FSRPartI *pi;
 	
@@ -334,6 +473,42 @@ static int bml_add_disk(u32 volume, u32 partno)
 	dev->gd->queue = dev->queue;
 	
 	pi = fsr_get_part_spec(volume);
+
+	/* the partition table is fixed, look up its first page only once */
+	if (!fsr_is_whole_dev(partno))
+	{
+		if (FSR_BML_GetVirUnitInfo(volume, fsr_part_start(pi, partno),
+			&dev->first_vpn, &nPgsPerUnit) != FSR_BML_SUCCESS)
+		{
+			/* no valid first_vpn, don't expose this partition */
+			ERRPRINTK("FSR_BML_GetVirUnitInfo FAIL\n");
+			put_disk(dev->gd);
+			kfree(dev->sg);
+			blk_cleanup_queue(dev->queue);
+			down(&bml_list_mutex);
+			list_del(&dev->list);
+			up(&bml_list_mutex);
+			kfree(dev);
+			return -EIO;
+		}
+	}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 31)
+	dev->thread = kthread_run(bml_io_thread, dev, "%s%d", DEVICE_NAME, minor);
+	if (IS_ERR(dev->thread))
+	{
+		ERRPRINTK("Can't create I/O thread for %s%d\n", DEVICE_NAME, minor);
+		dev->thread = NULL;
+		put_disk(dev->gd);
+		kfree(dev->sg);
+		blk_cleanup_queue(dev->queue);
+		down(&bml_list_mutex);
+		list_del(&dev->list);
+		up(&bml_list_mutex);
+		kfree(dev);
+		return -ENOMEM;
+	}
+#endif
 	
 	/* check minor number whether it is used for chip */
 	if (minor & PARTITION_MASK) 
@@ -374,6 +549,22 @@ static void bml_del_disk(struct fsr_dev *dev)
 	if (dev->gd) 
 	{
 		del_gendisk(dev->gd);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 31)
+		if (dev->thread)
+		{
+			struct task_struct *thread = dev->thread;
+
+			spin_lock_irq(&dev->lock);
+			dev->thread = NULL;
+			spin_unlock_irq(&dev->lock);
+			kthread_stop(thread);
+
+			/* fail whatever was queued after the thread has gone */
+			spin_lock_irq(&dev->lock);
+			bml_request(dev->queue);
+			spin_unlock_irq(&dev->lock);
+		}
+#endif
 		put_disk(dev->gd);
 	}
 
@@ -0,0 +1,622 @@
+/*
+ * ra-bench: replay PVR resource allocator traces on the host
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+/*
+ * The allocator in drivers/gpu/pvr/ra.c is linked in as is (see
+ * ra_host.h), and the trace is replayed through RA_Alloc and RA_Free.
+ * Reported are the time per call and how fragmented the free space is:
+ * the largest free span against all free space, at the end and at the
+ * worst point seen while replaying.
+ *
+ * A trace is the kernel log of a DEBUG driver with message output on
+ * (echo 8 > /proc/pvr/debug_level). Only these lines are used, other
+ * text around and between them is skipped:
+ *
+ *   RA_Alloc: arena='<name>', size=0x<n>(0x<n>), alignment=0x<n>, offset=0x<n>
+ *   RA_Alloc: name='<name>', size=0x<n>, *base=0x<n> = <ok>
+ *   RA_Free: name='<name>', base=0x<n>
+ *
+ * Each arena is replayed in a heap of its own. Unless -s is given, that
+ * heap covers the addresses the trace used in it. Addresses only serve
+ * to pair frees with their allocation, so failed allocations and frees
+ * of blocks allocated before the log starts are left out.
+ *
+ * -g writes a synthetic trace in the same format, made with the linked
+ * allocator. Replay one trace with ra-bench built against each ra.c to
+ * compare them (see the Makefile).
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ra.h"
+
+#define MAX_ARENAS	32
+#define LIVE_HASH_SIZE	65536
+
+struct arena {
+	char		name[64];
+	IMG_UINTPTR_T	lo, hi;		/* addresses seen in the trace */
+	IMG_UINTPTR_T	base;
+	IMG_SIZE_T	size;
+	unsigned long	align, offset;	/* from the last request line */
+	RA_ARENA	*ra;
+
+	/* fragmentation, per replay */
+	IMG_SIZE_T	worst_free, worst_largest;
+	unsigned long	worst_op;
+};
+
+struct op {
+	unsigned char	is_free;
+	unsigned char	ok;
+	unsigned short	arena;
+	unsigned long	size;		/* alloc */
+	unsigned long	align;
+	unsigned long	offset;
+	unsigned long	alloc;		/* free: index of its alloc op */
+	IMG_UINTPTR_T	base;		/* alloc: replayed address */
+};
+
+struct live {
+	struct live	*next;
+	unsigned short	arena;
+	unsigned long	base;		/* recorded address */
+	unsigned long	op;
+};
+
+struct timing {
+	unsigned long long	total_ns;
+	unsigned long long	max_ns;
+	unsigned long		count;
+};
+
+static struct arena arenas[MAX_ARENAS];
+static unsigned num_arenas;
+
+static struct op *ops;
+static unsigned long num_ops, max_ops;
+
+static struct live *live_hash[LIVE_HASH_SIZE];
+
+static unsigned long dropped_allocs, unmatched_frees, lost_frees;
+
+static unsigned long quantum = 0x1000;
+static unsigned long arena_size;
+static unsigned long sample_interval = 1024;
+static unsigned long long timer_overhead_ns;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* cost of the two clock reads around each call, taken off every sample */
+static void calibrate_timer(void)
+{
+	unsigned long long t0, best = ~0ULL;
+	int i;
+
+	for (i = 0; i < 100000; i++) {
+		t0 = now_ns();
+		t0 = now_ns() - t0;
+		if (t0 < best)
+			best = t0;
+	}
+	timer_overhead_ns = best;
+}
+
+static void account(struct timing *t, unsigned long long ns)
+{
+	ns = ns > timer_overhead_ns ? ns - timer_overhead_ns : 0;
+	t->total_ns += ns;
+	t->count++;
+	if (ns > t->max_ns)
+		t->max_ns = ns;
+}
+
+static struct arena *find_arena(const char *name)
+{
+	unsigned i;
+
+	for (i = 0; i < num_arenas; i++)
+		if (!strcmp(arenas[i].name, name))
+			return &arenas[i];
+
+	if (num_arenas == MAX_ARENAS) {
+		fprintf(stderr, "more than %d arenas, '%s' skipped\n",
+			MAX_ARENAS, name);
+		return NULL;
+	}
+
+	snprintf(arenas[num_arenas].name, sizeof(arenas[0].name), "%s", name);
+	arenas[num_arenas].lo = ~(IMG_UINTPTR_T)0;
+	return &arenas[num_arenas++];
+}
+
+static struct op *new_op(void)
+{
+	if (num_ops == max_ops) {
+		max_ops = max_ops ? max_ops * 2 : 4096;
+		ops = realloc(ops, max_ops * sizeof(*ops));
+		if (!ops) {
+			perror("realloc");
+			exit(1);
+		}
+	}
+
+	memset(&ops[num_ops], 0, sizeof(*ops));
+	return &ops[num_ops++];
+}
+
+static struct live **live_slot(unsigned short arena, unsigned long base)
+{
+	struct live **pp;
+
+	pp = &live_hash[(base / quantum ^ arena) & (LIVE_HASH_SIZE - 1)];
+	while (*pp && ((*pp)->arena != arena || (*pp)->base != base))
+		pp = &(*pp)->next;
+	return pp;
+}
+
+static void parse_line(const char *line)
+{
+	char name[64];
+	unsigned long size, req, align, offset, base;
+	struct arena *a;
+	struct live **pp, *l;
+	struct op *op;
+	const char *p;
+	int ok;
+
+	if ((p = strstr(line, "RA_Alloc: arena='")) &&
+	    sscanf(p, "RA_Alloc: arena='%63[^']', size=0x%lx(0x%lx), "
+		   "alignment=0x%lx, offset=0x%lx",
+		   name, &size, &req, &align, &offset) == 5) {
+		a = find_arena(name);
+		if (a) {
+			a->align = align;
+			a->offset = offset;
+		}
+		return;
+	}
+
+	if ((p = strstr(line, "RA_Alloc: name='")) &&
+	    sscanf(p, "RA_Alloc: name='%63[^']', size=0x%lx, *base=0x%lx = %d",
+		   name, &size, &base, &ok) == 4) {
+		a = find_arena(name);
+		if (!a)
+			return;
+		if (!ok) {
+			dropped_allocs++;
+			return;
+		}
+
+		if (base < a->lo)
+			a->lo = base;
+		if (base + size > a->hi)
+			a->hi = base + size;
+
+		op = new_op();
+		op->arena = a - arenas;
+		op->size = size;
+		op->align = a->align;
+		op->offset = a->offset;
+
+		pp = live_slot(op->arena, base);
+		if (*pp) {
+			/* its free is not in the log */
+			lost_frees++;
+		} else {
+			*pp = calloc(1, sizeof(**pp));
+			if (!*pp) {
+				perror("calloc");
+				exit(1);
+			}
+			(*pp)->arena = op->arena;
+			(*pp)->base = base;
+		}
+		(*pp)->op = op - ops;
+		return;
+	}
+
+	if ((p = strstr(line, "RA_Free: name='")) &&
+	    sscanf(p, "RA_Free: name='%63[^']', base=0x%lx", name, &base) == 2) {
+		a = find_arena(name);
+		if (!a)
+			return;
+
+		pp = live_slot(a - arenas, base);
+		if (!*pp) {
+			unmatched_frees++;
+			return;
+		}
+
+		op = new_op();
+		op->is_free = 1;
+		op->arena = a - arenas;
+		op->alloc = (*pp)->op;
+
+		l = *pp;
+		*pp = l->next;
+		free(l);
+	}
+}
+
+static void read_trace(FILE *f)
+{
+	char line[512];
+
+	while (fgets(line, sizeof(line), f))
+		parse_line(line);
+}
+
+/* free space by walking the live segments, which come in address order */
+static void arena_free_space(struct arena *a, IMG_SIZE_T *total,
+			     IMG_SIZE_T *largest)
+{
+	RA_SEGMENT_DETAILS seg;
+	IMG_UINTPTR_T pos = a->base;
+	IMG_SIZE_T gap;
+
+	*total = 0;
+	*largest = 0;
+
+	seg.hSegment = IMG_NULL;
+	while (RA_GetNextLiveSegment(a->ra, &seg)) {
+		gap = seg.sCpuPhyAddr.uiAddr - pos;
+		*total += gap;
+		if (gap > *largest)
+			*largest = gap;
+		pos = seg.sCpuPhyAddr.uiAddr + seg.uiSize;
+
+		/* the last segment hands back NULL, which means start over */
+		if (!seg.hSegment)
+			break;
+	}
+
+	gap = a->base + a->size - pos;
+	*total += gap;
+	if (gap > *largest)
+		*largest = gap;
+}
+
+static void sample_fragmentation(struct arena *a, unsigned long i)
+{
+	IMG_SIZE_T total, largest;
+
+	arena_free_space(a, &total, &largest);
+	if (!total)
+		return;
+
+	/* compare largest/total without dividing */
+	if (!a->worst_free ||
+	    (unsigned long long)largest * a->worst_free <
+	    (unsigned long long)a->worst_largest * total) {
+		a->worst_free = total;
+		a->worst_largest = largest;
+		a->worst_op = i;
+	}
+}
+
+static double percent(IMG_SIZE_T part, IMG_SIZE_T whole)
+{
+	return whole ? 100.0 * part / whole : 100.0;
+}
+
+static int create_arenas(void)
+{
+	struct arena *a;
+	unsigned i;
+
+	for (i = 0; i < num_arenas; i++) {
+		a = &arenas[i];
+		if (a->hi <= a->lo) {
+			a->ra = NULL;
+			continue;
+		}
+
+		a->base = a->lo & ~(quantum - 1);
+		a->size = arena_size ? arena_size :
+			((a->hi - a->base + quantum - 1) & ~(quantum - 1));
+		a->worst_free = 0;
+		a->worst_largest = 0;
+		a->worst_op = 0;
+
+		a->ra = RA_Create(a->name, a->base, a->size, IMG_NULL, quantum,
+				  IMG_NULL, IMG_NULL, IMG_NULL, IMG_NULL);
+		if (!a->ra) {
+			fprintf(stderr, "can't create arena '%s'\n", a->name);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void destroy_arenas(void)
+{
+	unsigned long i;
+
+	/* what the trace left allocated, RA_Delete wants it all free */
+	for (i = 0; i < num_ops; i++) {
+		if (!ops[i].is_free && ops[i].ok) {
+			RA_Free(arenas[ops[i].arena].ra, ops[i].base, IMG_FALSE);
+			ops[i].ok = 0;
+		}
+	}
+
+	for (i = 0; i < num_arenas; i++) {
+		if (arenas[i].ra)
+			RA_Delete(arenas[i].ra);
+		arenas[i].ra = NULL;
+	}
+}
+
+static int replay(struct timing *alloc_t, struct timing *free_t,
+		  unsigned long *failed)
+{
+	unsigned long long t0, t1;
+	struct op *op, *alloc;
+	struct arena *a;
+	unsigned long i;
+
+	if (create_arenas())
+		return -1;
+
+	for (i = 0; i < num_ops; i++) {
+		op = &ops[i];
+		a = &arenas[op->arena];
+
+		if (!op->is_free) {
+			t0 = now_ns();
+			op->ok = RA_Alloc(a->ra, op->size, IMG_NULL, IMG_NULL,
+					  0, op->align, op->offset, &op->base);
+			t1 = now_ns();
+			account(alloc_t, t1 - t0);
+			if (!op->ok)
+				(*failed)++;
+		} else {
+			alloc = &ops[op->alloc];
+			if (!alloc->ok)
+				continue;
+
+			t0 = now_ns();
+			RA_Free(a->ra, alloc->base, IMG_FALSE);
+			t1 = now_ns();
+			account(free_t, t1 - t0);
+			alloc->ok = 0;
+		}
+
+		if (sample_interval && i % sample_interval == 0)
+			sample_fragmentation(a, i);
+	}
+
+	return 0;
+}
+
+static void report_arenas(void)
+{
+	IMG_SIZE_T total, largest;
+	struct arena *a;
+	unsigned i;
+
+	for (i = 0; i < num_arenas; i++) {
+		a = &arenas[i];
+		if (!a->ra)
+			continue;
+
+		sample_fragmentation(a, num_ops);
+		arena_free_space(a, &total, &largest);
+
+		printf("arena '%s': base 0x%lx size 0x%lx\n", a->name,
+		       (unsigned long)a->base, (unsigned long)a->size);
+		printf("  end:   free 0x%lx, largest span 0x%lx (%.1f%%)\n",
+		       (unsigned long)total, (unsigned long)largest,
+		       percent(largest, total));
+		printf("  worst: free 0x%lx, largest span 0x%lx (%.1f%%) "
+		       "at op %lu\n",
+		       (unsigned long)a->worst_free,
+		       (unsigned long)a->worst_largest,
+		       percent(a->worst_largest, a->worst_free), a->worst_op);
+	}
+}
+
+static void report_timing(const char *what, struct timing *t)
+{
+	if (!t->count) {
+		printf("%s: none\n", what);
+		return;
+	}
+
+	printf("%s: %lu calls, avg %.1f ns, max %llu ns\n", what, t->count,
+	       (double)t->total_ns / t->count, t->max_ns);
+}
+
+static unsigned long rand_range(unsigned long lo, unsigned long hi)
+{
+	return lo + (unsigned long)rand() % (hi - lo + 1);
+}
+
+/*
+ * Mostly small buffers with some texture sized ones, the heap kept
+ * around three quarters full.
+ */
+static int generate(unsigned long count, unsigned seed)
+{
+	IMG_UINTPTR_T base = 0x10000000, addr;
+	IMG_SIZE_T size = arena_size ? arena_size : 64 << 20;
+	IMG_SIZE_T used = 0;
+	IMG_UINTPTR_T *live_addr;
+	IMG_SIZE_T *live_size;
+	unsigned long num_live = 0, i, n, r, align;
+	RA_ARENA *ra;
+	IMG_BOOL ok;
+
+	live_addr = calloc(count, sizeof(*live_addr));
+	live_size = calloc(count, sizeof(*live_size));
+	ra = RA_Create("bench", base, size, IMG_NULL, quantum,
+		       IMG_NULL, IMG_NULL, IMG_NULL, IMG_NULL);
+	if (!live_addr || !live_size || !ra) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	srand(seed);
+
+	for (i = 0; i < count; i++) {
+		r = rand() % 100;
+		if (num_live && (used > size / 4 * 3 ? r < 70 : r < 40)) {
+			n = rand() % num_live;
+			printf("RA_Free: name='bench', base=0x%lx\n",
+			       (unsigned long)live_addr[n]);
+			RA_Free(ra, live_addr[n], IMG_FALSE);
+			used -= live_size[n];
+			num_live--;
+			live_addr[n] = live_addr[num_live];
+			live_size[n] = live_size[num_live];
+			continue;
+		}
+
+		r = rand() % 100;
+		if (r < 70)
+			n = rand_range(1, 16) * 0x1000;
+		else if (r < 95)
+			n = rand_range(16, 128) * 0x1000;
+		else
+			n = rand_range(128, 1024) * 0x1000;
+		align = rand() % 5 ? 0x1000 : 0x10000;
+
+		addr = 0;
+		ok = RA_Alloc(ra, n, IMG_NULL, IMG_NULL, 0, align, 0, &addr);
+		printf("RA_Alloc: arena='bench', size=0x%lx(0x%lx), "
+		       "alignment=0x%lx, offset=0x0\n", n, n, align);
+		printf("RA_Alloc: name='bench', size=0x%lx, *base=0x%lx = %d\n",
+		       n, (unsigned long)addr, ok);
+		if (ok) {
+			live_addr[num_live] = addr;
+			live_size[num_live] = n;
+			num_live++;
+			used += n;
+		}
+	}
+
+	while (num_live--)
+		RA_Free(ra, live_addr[num_live], IMG_FALSE);
+	RA_Delete(ra);
+	free(live_addr);
+	free(live_size);
+
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options] [trace]\n"
+		"  -q <bytes>  arena quantum (default 0x1000)\n"
+		"  -s <bytes>  heap size for each arena (default: as traced)\n"
+		"  -r <n>      replay the trace n times (default 1)\n"
+		"  -i <n>      sample fragmentation every n ops, 0 for never\n"
+		"              (default 1024)\n"
+		"  -g <n>      write a synthetic trace of n ops to stdout\n"
+		"  -S <seed>   seed for -g (default 1)\n"
+		"Without a trace file the trace is read from stdin.\n",
+		prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct timing alloc_t = { 0 }, free_t = { 0 };
+	unsigned long repeat = 1, gen = 0, failed = 0, allocs = 0, i;
+	unsigned seed = 1;
+	FILE *f = stdin;
+	int c;
+
+	while ((c = getopt(argc, argv, "q:s:r:i:g:S:h")) != -1) {
+		switch (c) {
+		case 'q':
+			quantum = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			arena_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			repeat = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			sample_interval = strtoul(optarg, NULL, 0);
+			break;
+		case 'g':
+			gen = strtoul(optarg, NULL, 0);
+			break;
+		case 'S':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (!quantum || (quantum & (quantum - 1))) {
+		fprintf(stderr, "quantum must be a power of two\n");
+		return 1;
+	}
+
+	if (gen)
+		return generate(gen, seed);
+
+	if (optind < argc) {
+		f = fopen(argv[optind], "r");
+		if (!f) {
+			fprintf(stderr, "%s: %s\n", argv[optind],
+				strerror(errno));
+			return 1;
+		}
+	}
+
+	read_trace(f);
+	if (f != stdin)
+		fclose(f);
+
+	for (i = 0; i < num_ops; i++)
+		allocs += !ops[i].is_free;
+
+	printf("trace: %lu allocs, %lu frees, %u arenas\n",
+	       allocs, num_ops - allocs, num_arenas);
+	if (dropped_allocs || unmatched_frees || lost_frees)
+		printf("left out: %lu failed allocs, %lu frees of blocks "
+		       "allocated before the log, %lu blocks without a free\n",
+		       dropped_allocs, unmatched_frees, lost_frees);
+	if (!num_ops)
+		return 1;
+
+	calibrate_timer();
+
+	for (i = 0; i < repeat; i++) {
+		if (replay(&alloc_t, &free_t, &failed))
+			return 1;
+		if (i == repeat - 1)
+			report_arenas();
+		destroy_arenas();
+	}
+
+	printf("replayed %lu times, timer overhead %llu ns taken off\n",
+	       repeat, timer_overhead_ns);
+	report_timing("RA_Alloc", &alloc_t);
+	report_timing("RA_Free", &free_t);
+	printf("failed allocs: %lu\n", failed / repeat);
+
+	return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * Host build environment for drivers/gpu/pvr/ra.c and hash.c
+ *
+ * Forced in front of both files with -include. It keeps the services
+ * headers out through their include guards and supplies the few types
+ * and OS calls the allocator uses.
+ *
+ * IMG_UINTPTR_T is pointer sized here: ra.c stores BT pointers in its
+ * segment hash, which only works in the driver because ARM is 32 bit.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#ifndef RA_HOST_H
+#define RA_HOST_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define __IMG_TYPES_H__
+#define __IMG_DEFS_H__
+#define SERVICES_HEADERS_H
+#define __SERVICES_H__
+#define __SERVICESINT_H__
+#define __PVR_DEBUG_H__
+#define __OSFUNC_H__
+#define _BUFFER_MANAGER_H_
+#define __SERVICES_PROC_H__
+
+typedef void		IMG_VOID, *IMG_PVOID;
+typedef void		*IMG_HANDLE;
+typedef unsigned char	IMG_BYTE;
+typedef char		IMG_CHAR;
+typedef int		IMG_INT;
+typedef unsigned int	IMG_UINT;
+typedef int32_t		IMG_INT32;
+typedef uint32_t	IMG_UINT32;
+typedef uint64_t	IMG_UINT64;
+typedef uintptr_t	IMG_UINTPTR_T;
+typedef size_t		IMG_SIZE_T;
+
+typedef enum tag_img_bool
+{
+	IMG_FALSE	= 0,
+	IMG_TRUE	= 1,
+} IMG_BOOL;
+
+typedef struct _IMG_CPU_PHYADDR
+{
+	IMG_UINTPTR_T uiAddr;
+} IMG_CPU_PHYADDR;
+
+#define IMG_NULL	0
+#define IMG_UNDEF	(~(IMG_UINTPTR_T)0)
+#define IMG_CALLCONV
+#define IMG_INTERNAL
+#define IMG_EXPORT
+#define IMG_IMPORT
+
+typedef enum _PVRSRV_ERROR_
+{
+	PVRSRV_OK = 0,
+	PVRSRV_ERROR_OUT_OF_MEMORY,
+	PVRSRV_ERROR_INVALID_PARAMS,
+} PVRSRV_ERROR;
+
+/* only imported spans carry a mapping, and the benchmark imports none */
+typedef struct _BM_MAPPING_
+{
+	IMG_UINT32 ui32Flags;
+} BM_MAPPING;
+
+#define PVR_DPF(x)
+#define PVR_TRACE(x)
+#define PVR_ASSERT(x)			assert(x)
+#define PVR_DBG_BREAK			abort()
+#define PVR_UNREFERENCED_PARAMETER(x)	((void)(x))
+
+#define PVRSRV_OS_PAGEABLE_HEAP	0
+#define PVRSRV_PAGEABLE_SELECT	0
+
+static inline PVRSRV_ERROR OSAllocMem(IMG_UINT32 ui32Flags, IMG_SIZE_T uSize,
+				      IMG_PVOID *ppvLinAddr,
+				      IMG_HANDLE *phBlockAlloc,
+				      const IMG_CHAR *pszName)
+{
+	(void)ui32Flags;
+	(void)phBlockAlloc;
+	(void)pszName;
+
+	*ppvLinAddr = malloc(uSize);
+	return *ppvLinAddr ? PVRSRV_OK : PVRSRV_ERROR_OUT_OF_MEMORY;
+}
+
+static inline PVRSRV_ERROR OSFreeMem(IMG_UINT32 ui32Flags, IMG_SIZE_T uSize,
+				     IMG_PVOID pvLinAddr,
+				     IMG_HANDLE hBlockAlloc)
+{
+	(void)ui32Flags;
+	(void)uSize;
+	(void)hBlockAlloc;
+
+	free(pvLinAddr);
+	return PVRSRV_OK;
+}
+
+#define OSMemSet(p, c, n)	memset(p, c, n)
+#define OSMemCopy(d, s, n)	memcpy(d, s, n)
+#define OSSNPrintf		snprintf
+
+#endif /* RA_HOST_H */